@@ -0,0 +1,112 @@
+//
+// Copyright (c) 2024 Julian Hinxlage. All rights reserved.
+//
+
+#include "common/Log.h"
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <filesystem>
+
+using namespace baseline;
+
+class Result {
+public:
+	//calls per second seen by the logging threads
+	double callRate = 0;
+	//calls per second until everything is written
+	double writeRate = 0;
+	uint64_t dropped = 0;
+};
+
+static Result run(int threadCount, int messages) {
+	Result result;
+	uint64_t droppedBefore = Log::getDroppedCount();
+	std::vector<std::thread> threads;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < threadCount; i++) {
+		threads.emplace_back([i, messages]() {
+			for (int j = 0; j < messages; j++) {
+				Log::info("thread %d message %d value %f name %s", i, j, j * 0.5, "benchmark");
+			}
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	double callSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	Log::flush();
+	double writeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	double calls = (double)threadCount * messages;
+	result.callRate = calls / callSeconds;
+	result.writeRate = calls / writeSeconds;
+	result.dropped = Log::getDroppedCount() - droppedBefore;
+	return result;
+}
+
+static void print(const char* name, const Result& result) {
+	printf("%-14s %16.0f %16.0f %12llu\n", name, result.callRate, result.writeRate, (unsigned long long)result.dropped);
+}
+
+//the file is only written by the sink that is added for the run
+static Result runSink(const std::string& file, bool binary, int threadCount, int messages, double& bytesPerRecord) {
+	std::error_code error;
+	std::filesystem::remove(file, error);
+	if (binary) {
+		Log::addBinaryLogFile(file, LogLevel::INFO, 0, 1);
+	}
+	else {
+		Log::addLogFile(file, LogLevel::INFO);
+	}
+	Result result = run(threadCount, messages);
+	Log::removeLogFile(file);
+	bytesPerRecord = (double)std::filesystem::file_size(file, error) / ((double)threadCount * messages);
+	std::filesystem::remove(file, error);
+	return result;
+}
+
+//usage: logBenchmark [messages per thread] [threads]
+int main(int argc, char* argv[]) {
+	int messages = argc > 1 ? atoi(argv[1]) : 100000;
+	int threadCount = argc > 2 ? atoi(argv[2]) : 16;
+
+	std::string textFile = (std::filesystem::temp_directory_path() / "logBenchmark.log").string();
+	std::string binaryFile = (std::filesystem::temp_directory_path() / "logBenchmark.blog").string();
+	Log::setConsoleLogLevel(LogLevel::FATAL);
+	double bytesPerRecord = 0;
+
+	printf("%d threads, %d messages per thread, text log file %s\n", threadCount, messages, textFile.c_str());
+	printf("%-14s %16s %16s %12s\n", "mode", "calls/s", "written/s", "dropped");
+
+	print("sync", runSink(textFile, false, threadCount, messages, bytesPerRecord));
+
+	const char* names[] = { "async BLOCK", "async DROP", "async COUNT" };
+	LogOverflow modes[] = { LogOverflow::BLOCK, LogOverflow::DROP, LogOverflow::COUNT };
+	for (int i = 0; i < 3; i++) {
+		Log::setAsync(true, modes[i]);
+		print(names[i], runSink(textFile, false, threadCount, messages, bytesPerRecord));
+		Log::setAsync(false);
+	}
+
+	//the binary sink writes the format string once and the packed arguments for every record
+	printf("\ntext and binary log file, nothing is dropped\n");
+	printf("%-20s %16s %16s %12s\n", "sink", "calls/s", "written/s", "bytes/record");
+	for (int async = 0; async < 2; async++) {
+		if (async) {
+			Log::setAsync(true, LogOverflow::BLOCK);
+		}
+		for (int binary = 0; binary < 2; binary++) {
+			Result result = runSink(binary ? binaryFile : textFile, binary, threadCount, messages, bytesPerRecord);
+			std::string name = std::string(binary ? "binary" : "text") + (async ? " async BLOCK" : " sync");
+			printf("%-20s %16.0f %16.0f %12.1f\n", name.c_str(), result.callRate, result.writeRate, bytesPerRecord);
+		}
+		if (async) {
+			Log::setAsync(false);
+		}
+	}
+	return 0;
+}
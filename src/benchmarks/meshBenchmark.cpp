@@ -0,0 +1,73 @@
+//
+// Copyright (c) 2024 Julian Hinxlage. All rights reserved.
+//
+
+#include "render/Mesh.h"
+#include "render/RenderContext.h"
+#include "common/Log.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+using namespace baseline;
+
+//uv sphere with a bumpy surface in the default layout (position, normal, texture coordinates)
+static void generateSphere(int segments, std::vector<float>& vertices, std::vector<int>& indices) {
+	const float pi = 3.14159265f;
+	int rings = segments / 2;
+	for (int ring = 0; ring <= rings; ring++) {
+		float theta = pi * ring / rings;
+		for (int segment = 0; segment <= segments; segment++) {
+			float phi = 2 * pi * segment / segments;
+			float radius = 1.0f + 0.05f * std::sin(theta * 7) * std::sin(phi * 5);
+			glm::vec3 normal(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+			glm::vec3 position = normal * radius;
+			vertices.insert(vertices.end(), { position.x, position.y, position.z, normal.x, normal.y, normal.z, (float)segment / segments, (float)ring / rings });
+		}
+	}
+	for (int ring = 0; ring < rings; ring++) {
+		for (int segment = 0; segment < segments; segment++) {
+			int a = ring * (segments + 1) + segment;
+			int b = a + segments + 1;
+			indices.insert(indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+		}
+	}
+}
+
+//usage: meshBenchmark [segments] [lod count] [runs]
+int main(int argc, char* argv[]) {
+	int segments = argc > 1 ? atoi(argv[1]) : 400;
+	int lodCount = argc > 2 ? atoi(argv[2]) : 6;
+	int runs = argc > 3 ? atoi(argv[3]) : 3;
+
+	//generateLods traces every lod it generates
+	Log::setConsoleLogLevel(LogLevel::INFO);
+	//generateLods uploads the index buffer
+	RenderContext::create();
+
+	std::vector<float> vertices;
+	std::vector<int> indices;
+	generateSphere(segments, vertices, indices);
+	Mesh mesh;
+	mesh.create(vertices.data(), (int)vertices.size(), indices.data(), (int)indices.size(), { {Type::FLOAT, 3}, {Type::FLOAT, 3}, {Type::FLOAT, 2} }, true);
+
+	//every run simplifies the full mesh again
+	double best = 1e9;
+	for (int run = 0; run < runs; run++) {
+		auto begin = std::chrono::steady_clock::now();
+		mesh.generateLods(lodCount);
+		best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+	}
+
+	auto& lods = mesh.getLods();
+	int triangles = lods[0].indexCount / 3;
+	printf("%d vertices, %d triangles, %d lods in %.1f ms (best of %d runs)\n", (int)vertices.size() / 8, triangles, (int)lods.size() - 1, best, runs);
+	printf("%4s %12s %10s %12s\n", "lod", "triangles", "of lod 0", "error");
+	for (int i = 0; i < lods.size(); i++) {
+		printf("%4d %12d %9.1f%% %12.6f\n", i, lods[i].indexCount / 3, 100.0 * lods[i].indexCount / 3 / triangles, lods[i].error);
+	}
+	return lods.size() > 1 ? 0 : 1;
+}
@@ -0,0 +1,88 @@
+//
+// Copyright (c) 2024 Julian Hinxlage. All rights reserved.
+//
+
+#include "core/Singleton.h"
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <mutex>
+
+using namespace baseline;
+
+static std::atomic<int> constructCount = 0;
+
+class Counter {
+public:
+	int value = 1;
+
+	Counter() {
+		constructCount++;
+		//widens the window in which threads race for the first construction
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+};
+
+//registry lookup under a mutex on every call, a thread safe version of the previous Singleton::get
+class LockedRegistry {
+public:
+	template<typename Class>
+	static Class* get() {
+		static std::mutex mutex;
+		static std::unordered_map<size_t, void*> instances;
+		std::unique_lock<std::mutex> lock(mutex);
+		void*& instance = instances[typeid(Class).hash_code()];
+		if (instance == nullptr) {
+			instance = new Class();
+		}
+		return (Class*)instance;
+	}
+};
+
+template<typename Func>
+static double run(int threadCount, int iterations, Func func) {
+	std::vector<std::thread> threads;
+	std::atomic<long long> sum = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < threadCount; i++) {
+		threads.emplace_back([&]() {
+			long long local = 0;
+			for (int j = 0; j < iterations; j++) {
+				local += func();
+			}
+			sum += local;
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (sum != (long long)threadCount * iterations) {
+		printf("wrong sum %lld\n", sum.load());
+	}
+	return seconds * 1e9 / ((double)threadCount * iterations);
+}
+
+//usage: singletonBenchmark [iterations per thread]
+int main(int argc, char* argv[]) {
+	int iterations = argc > 1 ? atoi(argv[1]) : 10000000;
+	int maxThreads = std::max(std::thread::hardware_concurrency(), 1u) * 2;
+
+	//all threads race for the first construction, the measured runs only use existing instances
+	run(maxThreads, 1, []() { return Singleton::get<Counter>()->value; });
+	run(maxThreads, 1, []() { return LockedRegistry::get<Counter>()->value; });
+
+	printf("%d gets per thread, %d hardware threads\n", iterations, std::thread::hardware_concurrency());
+	printf("%8s %18s %18s\n", "threads", "Singleton ns/get", "locked ns/get");
+	for (int threads = 1; threads <= maxThreads; threads *= 2) {
+		double lockFree = run(threads, iterations, []() { return Singleton::get<Counter>()->value; });
+		double locked = run(threads, iterations, []() { return LockedRegistry::get<Counter>()->value; });
+		printf("%8d %18.2f %18.2f\n", threads, lockFree, locked);
+	}
+
+	//one construction by each of the two registries
+	printf("constructed %d times, expected 2\n", constructCount.load());
+	return constructCount == 2 ? 0 : 1;
+}
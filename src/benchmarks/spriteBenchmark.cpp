@@ -0,0 +1,85 @@
+//
+// Copyright (c) 2024 Julian Hinxlage. All rights reserved.
+//
+
+#include "render/Renderer2D.h"
+#include "render/RenderContext.h"
+#include "core/TaskManager.h"
+#include <GL/glew.h>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+using namespace baseline;
+
+static double milliseconds(std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end) {
+	return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+//usage: spriteBenchmark [sprites per frame] [frames per thread count]
+int main(int argc, char* argv[]) {
+	int spriteCount = argc > 1 ? atoi(argv[1]) : 400000;
+	int frames = argc > 2 ? atoi(argv[2]) : 8;
+	int maxThreads = std::max(std::thread::hardware_concurrency(), 1u) * 2;
+
+	RenderContext::create();
+	Renderer2D renderer;
+	renderer.init(true, 256, 256);
+
+	//a few textures and layers, so sorting and batching have work to do
+	std::vector<std::shared_ptr<Texture>> textures;
+	for (int i = 0; i < 8; i++) {
+		auto texture = std::make_shared<Texture>();
+		texture->create(1, 1);
+		Color color(i * 30, 255 - i * 30, 0);
+		texture->setData(&color, 1);
+		textures.push_back(texture);
+	}
+
+	printf("%d sprites per frame, best of %d frames, %d hardware threads\n", spriteCount, frames, std::thread::hardware_concurrency());
+	printf("%8s %12s %14s %12s %8s\n", "threads", "submit ms", "sprites/ms", "end ms", "draws");
+	for (int threads = 1; threads <= maxThreads; threads *= 2) {
+		TaskManager taskManager;
+		taskManager.start(threads);
+		double bestSubmit = 1e9;
+		double bestEnd = 1e9;
+		for (int frame = 0; frame < frames; frame++) {
+			renderer.begin(glm::ortho(0.0f, 256.0f, 0.0f, 256.0f));
+			auto begin = std::chrono::steady_clock::now();
+			std::vector<int> tasks;
+			for (int t = 0; t < threads; t++) {
+				tasks.push_back(taskManager.addTask([&, t]() {
+					Renderer2D::Context& context = renderer.getContext();
+					int first = (int)((int64_t)spriteCount * t / threads);
+					int last = (int)((int64_t)spriteCount * (t + 1) / threads);
+					for (int i = first; i < last; i++) {
+						float x = (float)(i % 256);
+						float y = (float)(i / 256 % 256);
+						context.submitQuad(glm::vec2(x, y), glm::vec2(1, 1), x * 0.01f, textures[(i >> 6) & 7].get(), color::white, (i >> 12) & 3);
+					}
+				}));
+			}
+			for (int task : tasks) {
+				taskManager.joinTask(task);
+			}
+			auto submitted = std::chrono::steady_clock::now();
+			renderer.end();
+			glFinish();
+			auto finished = std::chrono::steady_clock::now();
+			bestSubmit = std::min(bestSubmit, milliseconds(begin, submitted));
+			bestEnd = std::min(bestEnd, milliseconds(submitted, finished));
+		}
+		taskManager.stop();
+
+		auto& stats = renderer.getStats();
+		if (stats.instances != spriteCount) {
+			printf("drew %d of %d sprites\n", stats.instances, spriteCount);
+			return 1;
+		}
+		printf("%8d %12.2f %14.0f %12.2f %8d\n", threads, bestSubmit, spriteCount / bestSubmit, bestEnd, stats.drawCalls);
+	}
+	return 0;
+}
@@ -0,0 +1,232 @@
+//
+// Copyright (c) 2024 Julian Hinxlage. All rights reserved.
+//
+
+#include "common/strutil.h"
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+
+using namespace baseline;
+
+//the byte by byte implementations strutil had before findString
+namespace previous {
+
+	std::vector<std::string> split(const std::string& string, const std::string& delimiter, bool includeEmpty) {
+		std::vector<std::string> parts;
+		std::string token;
+		int delimiterIndex = 0;
+		for (char c : string) {
+			if ((int)delimiter.size() == 0) {
+				parts.push_back({ c, 1 });
+			}
+			else if (c == delimiter[delimiterIndex]) {
+				delimiterIndex++;
+				if (delimiterIndex == delimiter.size()) {
+					if (includeEmpty || (int)token.size() != 0) {
+						parts.push_back(token);
+					}
+					token.clear();
+					delimiterIndex = 0;
+				}
+			}
+			else {
+				token += delimiter.substr(0, delimiterIndex);
+				token.push_back(c);
+				delimiterIndex = 0;
+			}
+		}
+		token += delimiter.substr(0, delimiterIndex);
+		if (includeEmpty || (int)token.size() != 0) {
+			parts.push_back(token);
+		}
+		return parts;
+	}
+
+	std::string join(const std::vector<std::string>& strings, const std::string& delimiter) {
+		std::string result;
+		for (int i = 0; i < strings.size(); i++) {
+			result += strings[i];
+			if (i != strings.size() - 1) {
+				result += delimiter;
+			}
+		}
+		return result;
+	}
+
+	std::string replace(const std::string& string, const std::string& search, const std::string& replacement) {
+		return join(split(string, search, true), replacement);
+	}
+
+	bool stringContains(const std::string& string, const std::string& subString) {
+		int matchIndex = 0;
+		for (int i = 0; i < string.size(); i++) {
+			char c = string[i];
+			if (c == subString[matchIndex]) {
+				matchIndex++;
+				if (matchIndex == subString.size()) {
+					return true;
+				}
+			}
+			else {
+				matchIndex = 0;
+			}
+		}
+		return false;
+	}
+
+	std::string toLower(const std::string& string) {
+		std::string result;
+		for (char c : string) {
+			if (c >= 'A' && c <= 'Z') {
+				result.push_back(c - 'A' + 'a');
+			}
+			else {
+				result.push_back(c);
+			}
+		}
+		return result;
+	}
+
+	std::string toUpper(const std::string& string) {
+		std::string result;
+		for (char c : string) {
+			if (c >= 'a' && c <= 'z') {
+				result.push_back(c - 'a' + 'A');
+			}
+			else {
+				result.push_back(c);
+			}
+		}
+		return result;
+	}
+
+}
+
+//std::string::find based results the new implementations are checked against
+namespace reference {
+
+	std::vector<std::string> split(const std::string& string, const std::string& delimiter, bool includeEmpty) {
+		std::vector<std::string> parts;
+		size_t begin = 0;
+		while (true) {
+			size_t end = string.find(delimiter, begin);
+			std::string part = string.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+			if (includeEmpty || !part.empty()) {
+				parts.push_back(part);
+			}
+			if (end == std::string::npos) {
+				break;
+			}
+			begin = end + delimiter.size();
+		}
+		return parts;
+	}
+
+}
+
+static size_t sink = 0;
+
+//milliseconds per call
+template<typename Func>
+static double measure(int iterations, Func func) {
+	func();
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++) {
+		func();
+	}
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+}
+
+static void print(const char* name, double previousTime, double time) {
+	if (previousTime > 0) {
+		printf("%-24s %10.3f ms %10.3f ms %8.1fx\n", name, previousTime, time, previousTime / time);
+	}
+	else {
+		printf("%-24s %13s %10.3f ms\n", name, "-", time);
+	}
+}
+
+static bool checkCorrectness(int count) {
+	std::mt19937 random(1);
+	const char alphabet[] = "ab,\n";
+	for (int i = 0; i < count; i++) {
+		std::string string;
+		int length = random() % 200;
+		for (int j = 0; j < length; j++) {
+			string.push_back(alphabet[random() % 4]);
+		}
+		std::string delimiter;
+		int delimiterLength = 1 + random() % 4;
+		for (int j = 0; j < delimiterLength; j++) {
+			delimiter.push_back(alphabet[random() % 4]);
+		}
+		bool includeEmpty = random() % 2;
+		size_t offset = random() % (length + 2);
+
+		if (split(string, delimiter, includeEmpty) != reference::split(string, delimiter, includeEmpty)) {
+			printf("split differs for \"%s\" \"%s\"\n", string.c_str(), delimiter.c_str());
+			return false;
+		}
+		if (findString(string, delimiter, offset) != string.find(delimiter, offset)) {
+			printf("findString differs for \"%s\" \"%s\" %zu\n", string.c_str(), delimiter.c_str(), offset);
+			return false;
+		}
+
+		std::string bytes;
+		for (int j = 0; j < length; j++) {
+			bytes.push_back((char)(random() % 256));
+		}
+		if (toLower(bytes) != previous::toLower(bytes) || toUpper(bytes) != previous::toUpper(bytes)) {
+			printf("case conversion differs\n");
+			return false;
+		}
+	}
+	return true;
+}
+
+//usage: strutilBenchmark [iterations]
+int main(int argc, char* argv[]) {
+	int iterations = argc > 1 ? atoi(argv[1]) : 20;
+
+	if (!checkCorrectness(200000)) {
+		return 1;
+	}
+	printf("results match std::string::find on 200000 random inputs\n");
+
+	std::string config;
+	std::string log;
+	for (int i = 0; i < 20000; i++) {
+		config += "set var" + std::to_string(i) + " \"value with spaces " + std::to_string(i * 7) + "\"\n";
+		log += "[2024-05-01 12:00:00.123] [info] [main] Module loaded successfully in 12.5 ms, id=" + std::to_string(i) + "\n";
+	}
+	printf("config %zu KB, log %zu KB, %d iterations\n\n", config.size() / 1024, log.size() / 1024, iterations);
+	printf("%-24s %13s %13s %9s\n", "", "previous", "current", "speedup");
+
+	print("split lines (config)",
+		measure(iterations, [&]() { sink += previous::split(config, "\n", false).size(); }),
+		measure(iterations, [&]() { sink += split(config, "\n", false).size(); }));
+	print("split lines (log)",
+		measure(iterations, [&]() { sink += previous::split(log, "\n", false).size(); }),
+		measure(iterations, [&]() { sink += split(log, "\n", false).size(); }));
+	print("splitView lines (log)", 0,
+		measure(iterations, [&]() { for (auto part : splitView(log, "\n")) { sink += part.size(); } }));
+	print("split \"] [\" (log)",
+		measure(iterations, [&]() { sink += previous::split(log, "] [", false).size(); }),
+		measure(iterations, [&]() { sink += split(log, "] [", false).size(); }));
+	print("replace (log)",
+		measure(iterations, [&]() { sink += previous::replace(log, "info", "warning").size(); }),
+		measure(iterations, [&]() { sink += replace(log, "info", "warning").size(); }));
+	print("stringContains miss",
+		measure(iterations, [&]() { sink += previous::stringContains(log, "fatal error"); }),
+		measure(iterations, [&]() { sink += stringContains(log, "fatal error"); }));
+	print("toLower (log)",
+		measure(iterations, [&]() { sink += previous::toLower(log).size(); }),
+		measure(iterations, [&]() { sink += toLower(log).size(); }));
+	print("toUpper (log)",
+		measure(iterations, [&]() { sink += previous::toUpper(log).size(); }),
+		measure(iterations, [&]() { sink += toUpper(log).size(); }));
+
+	return sink == 0;
+}
@@ -0,0 +1,313 @@
+//
+// Copyright (c) 2024 Julian Hinxlage. All rights reserved.
+//
+
+#include "common/xml.h"
+#include "common/strutil.h"
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+using namespace baseline;
+
+//the substring based XmlNode that was used before XmlDocument
+namespace previous {
+
+	class XmlNode {
+	public:
+		std::string attributes;
+		std::string content;
+		int contentRootOffset = 0;
+
+		XmlNode(const std::string& text = "") {
+			this->content = text;
+		}
+
+		std::string value() {
+			return content;
+		}
+
+		std::string attribute(const std::string& name) {
+			auto parts = split(attributes, name, true);
+			if (parts.size() > 1) {
+				std::string str = parts[1];
+				std::string result = "";
+				bool in = false;
+				for (char c : str) {
+					if (c == '\"') {
+						if (in) {
+							break;
+						}
+						in = !in;
+					}
+					else if (in) {
+						result.push_back(c);
+					}
+				}
+				return result;
+			}
+			return "";
+		}
+
+		static bool isCharackter(char c) {
+			return (c >= 'a' && c <= 'z') ||
+				(c >= 'A' && c <= 'Z') ||
+				(c >= '0' && c <= '9');
+		}
+
+		std::string readIdentifier(const std::string& str, int offset) {
+			std::string identifier = "";
+			for (int i = offset; i < content.size(); i++) {
+				char c = content[i];
+				if (isCharackter(c)) {
+					identifier.push_back(c);
+				}
+				else {
+					break;
+				}
+			}
+			return identifier;
+		}
+
+		std::vector<XmlNode> childs(const std::string& name, bool justFirst = false) {
+			bool inTag = false;
+			bool inNode = false;
+			bool inQuotes = false;
+			bool inComment = false;
+			int depth = 0;
+			int beginTagIndex = 0;
+			int beginOpenIndex = 0;
+			int beginCloseIndex = 0;
+
+			std::vector<XmlNode> nodes;
+			XmlNode node;
+
+			for (int i = 0; i < content.size(); i++) {
+				char c = content[i];
+
+				if (content.substr(i, 4) == "<!--") {
+					inComment = true;
+					i += 3;
+					continue;
+				}
+				if (content.substr(i, 3) == "-->") {
+					inComment = false;
+					i += 2;
+					continue;
+				}
+				if (inComment) {
+					continue;
+				}
+
+				if (!inNode) {
+					if (c == '<') {
+						beginOpenIndex = i;
+						std::string ident = readIdentifier(content, i + 1);
+						if (ident == name) {
+							i += ident.size();
+							inTag = true;
+							inNode = true;
+							depth = 1;
+							beginTagIndex = i + 1;
+						}
+					}
+				}
+				else {
+					if (c == '<' && !inQuotes) {
+						beginOpenIndex = i;
+						depth++;
+					}
+					if (c == '>' && !inQuotes) {
+						if (inTag) {
+							node.attributes = content.substr(beginTagIndex, i - beginTagIndex);
+							beginCloseIndex = i;
+						}
+						inTag = false;
+						depth--;
+					}
+					if (c == '\"') {
+						inQuotes = !inQuotes;
+					}
+					if (c == '/' && !inQuotes) {
+						if (inTag) {
+							node.attributes = content.substr(beginTagIndex, i - beginTagIndex);
+							node.contentRootOffset = i + contentRootOffset;
+							nodes.push_back(node);
+							node = XmlNode();
+							inNode = false;
+							inTag = false;
+							depth = 0;
+							beginTagIndex = 0;
+							beginOpenIndex = 0;
+							beginCloseIndex = 0;
+							if (justFirst) {
+								break;
+							}
+						}
+						else {
+							if (depth == 1) {
+								std::string ident = readIdentifier(content, i + 1);
+								if (ident == name) {
+									node.content = content.substr(beginCloseIndex + 1, beginOpenIndex - (beginCloseIndex + 1));
+									node.contentRootOffset = beginCloseIndex + 1 + contentRootOffset;
+									nodes.push_back(node);
+									node = XmlNode();
+									inNode = false;
+									inTag = false;
+									depth = 0;
+									beginTagIndex = 0;
+									beginOpenIndex = 0;
+									beginCloseIndex = 0;
+									if (justFirst) {
+										break;
+									}
+								}
+							}
+						}
+					}
+				}
+
+			}
+			return nodes;
+		}
+
+		XmlNode child(const std::string& name) {
+			auto nodes = childs(name, true);
+			if (nodes.size() > 0) {
+				return nodes[0];
+			}
+			else {
+				return XmlNode();
+			}
+		}
+	};
+
+}
+
+//what each parser extracts from the document, has to be the same for all of them
+class Result {
+public:
+	size_t items = 0;
+	size_t idSum = 0;
+	size_t valueBytes = 0;
+	double time = 0;
+
+	bool operator==(const Result& other) const {
+		return items == other.items && idSum == other.idSum && valueBytes == other.valueBytes;
+	}
+};
+
+static std::string generate(size_t size) {
+	std::string text = "<?xml version=\"1.0\"?>\n<root>\n";
+	for (int i = 0; text.size() < size; i++) {
+		text += "\t<item id=\"" + std::to_string(i) + "\" name=\"item " + std::to_string(i) + "\">";
+		text += "<v>value " + std::to_string(i * 7) + "</v>";
+		if (i % 16 == 0) {
+			text += "<!-- comment -->";
+		}
+		text += "</item>\n";
+	}
+	text += "</root>\n";
+	return text;
+}
+
+template<typename Func>
+static Result measure(Func func) {
+	auto start = std::chrono::steady_clock::now();
+	Result result = func();
+	result.time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return result;
+}
+
+static Result parsePrevious(const std::string& text) {
+	Result result;
+	previous::XmlNode root(text);
+	for (auto& item : root.child("root").childs("item")) {
+		result.items++;
+		result.idSum += fromString<int>(item.attribute("id"));
+		result.valueBytes += item.child("v").value().size();
+	}
+	return result;
+}
+
+static Result parseDocument(const std::string& text) {
+	Result result;
+	XmlNode root(std::string(text.data(), text.size()));
+	for (auto& item : root.child("root").childs("item")) {
+		result.items++;
+		result.idSum += fromString<int>(std::string(item.attributeView("id")));
+		result.valueBytes += item.child("v").valueView().size();
+	}
+	return result;
+}
+
+static Result parseReader(const std::string& text) {
+	Result result;
+	bool inValue = false;
+	XmlReader reader;
+	reader.callback = [&](const XmlEvent& event) {
+		if (event.type == XmlEventType::START && event.name == "item") {
+			result.items++;
+		}
+		else if (event.type == XmlEventType::ATTRIBUTE && event.name == "id") {
+			result.idSum += fromString<int>(std::string(event.value));
+		}
+		else if (event.type == XmlEventType::START && event.name == "v") {
+			inValue = true;
+		}
+		else if (event.type == XmlEventType::END && event.name == "v") {
+			inValue = false;
+		}
+		else if (event.type == XmlEventType::TEXT && inValue) {
+			result.valueBytes += event.value.size();
+		}
+	};
+	//the chunk size of XmlReader::readFile
+	const size_t chunkSize = 64 * 1024;
+	for (size_t offset = 0; offset < text.size(); offset += chunkSize) {
+		reader.feed(text.data() + offset, std::min(chunkSize, text.size() - offset));
+	}
+	reader.finish();
+	return result;
+}
+
+static void print(size_t megabytes, const char* name, const Result& result, double previousTime) {
+	double throughput = (double)megabytes / (result.time / 1000.0);
+	if (previousTime > 0) {
+		printf("%6zu MB %-12s %12.1f ms %10.1f MB/s %8.1fx\n", megabytes, name, result.time, throughput, previousTime / result.time);
+	}
+	else {
+		printf("%6zu MB %-12s %12.1f ms %10.1f MB/s %9s\n", megabytes, name, result.time, throughput, "-");
+	}
+}
+
+//usage: xmlBenchmark [largest size in MB] [largest size in MB for the previous parser]
+int main(int argc, char* argv[]) {
+	size_t maxMegabytes = argc > 1 ? atoi(argv[1]) : 100;
+	//the previous parser copies every matched subtree and is only run on the smaller documents by default
+	size_t maxPreviousMegabytes = argc > 2 ? atoi(argv[2]) : 10;
+
+	printf("%9s %-12s %15s %15s %9s\n", "size", "parser", "time", "throughput", "speedup");
+	for (size_t megabytes = 1; megabytes <= maxMegabytes; megabytes *= 10) {
+		std::string text = generate(megabytes * 1024 * 1024);
+
+		Result previousResult;
+		if (megabytes <= maxPreviousMegabytes) {
+			previousResult = measure([&]() { return parsePrevious(text); });
+			print(megabytes, "previous", previousResult, 0);
+		}
+		Result document = measure([&]() { return parseDocument(text); });
+		print(megabytes, "XmlDocument", document, previousResult.time);
+		Result reader = measure([&]() { return parseReader(text); });
+		print(megabytes, "XmlReader", reader, previousResult.time);
+
+		if (!(document == reader) || (previousResult.items != 0 && !(previousResult == document))) {
+			printf("results differ: %zu %zu %zu items\n", previousResult.items, document.items, reader.items);
+			return 1;
+		}
+	}
+	return 0;
+}
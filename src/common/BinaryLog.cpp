@@ -0,0 +1,219 @@
+//
+// Copyright (c) 2024 Julian Hinxlage. All rights reserved.
+//
+
+#include "BinaryLog.h"
+#include "LogArgs.h"
+#include "strutil.h"
+#include <filesystem>
+#include <cstring>
+
+namespace baseline {
+
+	static const char binaryLogMagic[8] = { 'B', 'L', 'L', 'O', 'G', 0, 0, 0 };
+
+	enum BinaryLogRecordType : uint8_t {
+		FORMAT = 1,
+		MESSAGE = 2,
+	};
+
+	static void writeVarInt(std::string& out, uint64_t value) {
+		while (value >= 0x80) {
+			out.push_back((char)(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back((char)value);
+	}
+
+	static uint64_t zigZag(int64_t value) {
+		return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+	}
+
+	static int64_t unZigZag(uint64_t value) {
+		return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+	}
+
+	bool BinaryLogWriter::open(const std::string& file, uint64_t maxFileSize, int maxFileCount) {
+		close();
+		this->file = file;
+		this->maxFileSize = maxFileSize;
+		this->maxFileCount = maxFileCount;
+		//the log of the previous run is kept as file.1 instead of being overwritten, unless it has no messages
+		std::error_code error;
+		uint64_t previousSize = std::filesystem::file_size(file, error);
+		if (!error && previousSize > sizeof(binaryLogMagic) + sizeof(uint32_t)) {
+			shiftFiles();
+		}
+		return openFile();
+	}
+
+	void BinaryLogWriter::close() {
+		if (stream.is_open()) {
+			stream.close();
+		}
+		formatIds.clear();
+		formatCount = 0;
+		fileSize = 0;
+		lastTime = 0;
+	}
+
+	bool BinaryLogWriter::openFile() {
+		try {
+			if (!std::filesystem::exists(std::filesystem::path(file).parent_path())) {
+				std::filesystem::create_directories(std::filesystem::path(file).parent_path());
+			}
+		}
+		catch (...) {}
+
+		stream.open(file, std::ios::binary | std::ios::trunc);
+		if (!stream.is_open()) {
+			return false;
+		}
+
+		//every file starts with its own format table and base time, so rotated files decode on their own
+		formatIds.clear();
+		formatCount = 0;
+		lastTime = 0;
+
+		uint32_t v = version;
+		stream.write(binaryLogMagic, sizeof(binaryLogMagic));
+		stream.write((const char*)&v, sizeof(v));
+		fileSize = sizeof(binaryLogMagic) + sizeof(v);
+		return true;
+	}
+
+	void BinaryLogWriter::rotate() {
+		stream.close();
+		shiftFiles();
+		openFile();
+	}
+
+	void BinaryLogWriter::shiftFiles() {
+		try {
+			for (int i = maxFileCount - 1; i >= 1; i--) {
+				std::string from = i == 1 ? file : file + "." + std::to_string(i - 1);
+				std::string to = file + "." + std::to_string(i);
+				if (std::filesystem::exists(from)) {
+					std::filesystem::rename(from, to);
+				}
+			}
+		}
+		catch (...) {}
+	}
+
+	void BinaryLogWriter::write(LogLevel level, uint64_t time, const char* fmt, const uint8_t* args, int argsSize) {
+		if (!stream.is_open()) {
+			return;
+		}
+		if (maxFileSize != 0 && fileSize >= maxFileSize) {
+			rotate();
+		}
+
+		buffer.clear();
+
+		uint32_t id = 0;
+		auto entry = formatIds.find(fmt);
+		if (entry != formatIds.end()) {
+			id = entry->second;
+		}
+		else {
+			id = formatCount++;
+			formatIds[fmt] = id;
+			size_t length = strlen(fmt);
+			buffer.push_back((char)(FORMAT << 4));
+			writeVarInt(buffer, id);
+			writeVarInt(buffer, length);
+			buffer.append(fmt, length);
+		}
+
+		uint64_t micro = time / 1000;
+		buffer.push_back((char)((MESSAGE << 4) | (int)level));
+		writeVarInt(buffer, id);
+		writeVarInt(buffer, zigZag((int64_t)(micro - lastTime)));
+		writeVarInt(buffer, argsSize);
+		buffer.append((const char*)args, argsSize);
+		lastTime = micro;
+
+		stream.write(buffer.data(), buffer.size());
+		fileSize += buffer.size();
+	}
+
+	void BinaryLogWriter::flush() {
+		stream.flush();
+	}
+
+	void BinaryLogWriter::forgetFormats() {
+		formatIds.clear();
+	}
+
+	uint64_t BinaryLogWriter::getFileSize() {
+		return fileSize;
+	}
+
+	bool BinaryLogReader::open(const std::string& file) {
+		data = readFile(file, true);
+		index = 0;
+		lastTime = 0;
+		formats.clear();
+
+		uint32_t v = 0;
+		if (data.size() < sizeof(binaryLogMagic) + sizeof(v) || memcmp(data.data(), binaryLogMagic, sizeof(binaryLogMagic)) != 0) {
+			return false;
+		}
+		memcpy(&v, data.data() + sizeof(binaryLogMagic), sizeof(v));
+		if (v != BinaryLogWriter::version) {
+			return false;
+		}
+		index = sizeof(binaryLogMagic) + sizeof(v);
+		return true;
+	}
+
+	bool BinaryLogReader::readVarInt(uint64_t& value) {
+		value = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			if (index >= data.size()) {
+				return false;
+			}
+			uint8_t byte = data[index++];
+			value |= (uint64_t)(byte & 0x7f) << shift;
+			if (!(byte & 0x80)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool BinaryLogReader::next(LogLevel& level, uint64_t& time, std::string& message) {
+		while (index < data.size()) {
+			uint8_t type = data[index++];
+			uint64_t id = 0;
+			uint64_t size = 0;
+
+			if ((type >> 4) == FORMAT) {
+				if (!readVarInt(id) || !readVarInt(size) || index + size > data.size() || id != formats.size()) {
+					return false;
+				}
+				formats.push_back(data.substr(index, size));
+				index += size;
+			}
+			else if ((type >> 4) == MESSAGE) {
+				uint64_t delta = 0;
+				if (!readVarInt(id) || !readVarInt(delta) || !readVarInt(size) || index + size > data.size() || id >= formats.size()) {
+					return false;
+				}
+				lastTime += unZigZag(delta);
+				time = lastTime * 1000;
+				level = (LogLevel)(type & 0x0f);
+				message.clear();
+				LogArgs::format(formats[id].c_str(), (const uint8_t*)data.data() + index, (int)size, message);
+				index += size;
+				return true;
+			}
+			else {
+				return false;
+			}
+		}
+		return false;
+	}
+
+}
@@ -0,0 +1,64 @@
+//
+// Copyright (c) 2024 Julian Hinxlage. All rights reserved.
+//
+
+#pragma once
+
+#include "Log.h"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <unordered_map>
+
+namespace baseline {
+
+	//compact log file: every format string is written once per file,
+	//messages are stored as format id, level, time delta and the packed arguments (see LogArgs)
+	class BinaryLogWriter {
+	public:
+		static constexpr uint32_t version = 1;
+
+		//rotates to file.1, file.2, ... when maxFileSize (bytes) is exceeded, 0 disables rotation
+		//an existing file is rotated on open as well, with a maxFileCount of 1 it is overwritten
+		bool open(const std::string& file, uint64_t maxFileSize = 0, int maxFileCount = 5);
+		void close();
+		void write(LogLevel level, uint64_t time, const char* fmt, const uint8_t* args, int argsSize);
+		void flush();
+		uint64_t getFileSize();
+		//format ids are cached by pointer, has to be called when code that contained format strings was unloaded
+		//the address can be reused by another string, the next write of a pointer writes its format again
+		void forgetFormats();
+
+	private:
+		std::string file;
+		std::ofstream stream;
+		uint64_t maxFileSize = 0;
+		int maxFileCount = 0;
+		uint64_t fileSize = 0;
+		uint64_t lastTime = 0;
+		std::unordered_map<const char*, uint32_t> formatIds;
+		uint32_t formatCount = 0;
+		std::string buffer;
+
+		bool openFile();
+		void rotate();
+		//renames file to file.1, file.1 to file.2, ... and drops the last one
+		void shiftFiles();
+	};
+
+	class BinaryLogReader {
+	public:
+		bool open(const std::string& file);
+		//time in nanoseconds since epoch (microsecond precision)
+		bool next(LogLevel& level, uint64_t& time, std::string& message);
+
+	private:
+		std::string data;
+		uint64_t index = 0;
+		uint64_t lastTime = 0;
+		std::vector<std::string> formats;
+
+		bool readVarInt(uint64_t& value);
+	};
+
+}
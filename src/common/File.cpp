@@ -0,0 +1,302 @@
+//
+// Copyright (c) 2024 Julian Hinxlage. All rights reserved.
+//
+
+#include "File.h"
+#include <utility>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+
+#if WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace baseline {
+
+	FileView::FileView() {
+		mapping = nullptr;
+		mappingSize = 0;
+		opened = false;
+#if WIN32
+		fileHandle = nullptr;
+		mappingHandle = nullptr;
+#endif
+	}
+
+	FileView::~FileView() {
+		close();
+	}
+
+	FileView::FileView(FileView&& view) noexcept : FileView() {
+		*this = std::move(view);
+	}
+
+	FileView& FileView::operator=(FileView&& view) noexcept {
+		if (this != &view) {
+			close();
+			std::swap(mapping, view.mapping);
+			std::swap(mappingSize, view.mappingSize);
+			std::swap(opened, view.opened);
+#if WIN32
+			std::swap(fileHandle, view.fileHandle);
+			std::swap(mappingHandle, view.mappingHandle);
+#endif
+		}
+		return *this;
+	}
+
+	bool FileView::open(const std::string& file, bool copyOnWrite) {
+		close();
+
+#if WIN32
+		//FILE_SHARE_DELETE lets replaceFile move the file away while it is mapped
+		HANDLE handle = CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (handle == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		LARGE_INTEGER size;
+		GetFileSizeEx(handle, &size);
+		fileHandle = (void*)handle;
+		mappingSize = size.QuadPart;
+		if (mappingSize > 0) {
+			mappingHandle = (void*)CreateFileMappingA(handle, nullptr, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+			if (mappingHandle) {
+				mapping = (uint8_t*)MapViewOfFile((HANDLE)mappingHandle, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+			}
+			if (!mapping) {
+				close();
+				return false;
+			}
+		}
+#else
+		int fd = ::open(file.c_str(), O_RDONLY);
+		if (fd == -1) {
+			return false;
+		}
+		struct stat info;
+		if (fstat(fd, &info) != 0) {
+			::close(fd);
+			return false;
+		}
+		mappingSize = info.st_size;
+		if (mappingSize > 0) {
+			void* ptr = mmap(nullptr, mappingSize, copyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0);
+			if (ptr == MAP_FAILED) {
+				::close(fd);
+				mappingSize = 0;
+				return false;
+			}
+			mapping = (uint8_t*)ptr;
+		}
+		//the mapping keeps the file alive
+		::close(fd);
+#endif
+
+		opened = true;
+		return true;
+	}
+
+	void FileView::close() {
+#if WIN32
+		if (mapping) {
+			UnmapViewOfFile(mapping);
+		}
+		if (mappingHandle) {
+			CloseHandle((HANDLE)mappingHandle);
+		}
+		if (fileHandle) {
+			CloseHandle((HANDLE)fileHandle);
+		}
+		mappingHandle = nullptr;
+		fileHandle = nullptr;
+#else
+		if (mapping) {
+			munmap(mapping, mappingSize);
+		}
+#endif
+		mapping = nullptr;
+		mappingSize = 0;
+		opened = false;
+	}
+
+	bool FileView::isOpen() const {
+		return opened;
+	}
+
+	uint8_t* FileView::data() const {
+		return mapping;
+	}
+
+	uint64_t FileView::size() const {
+		return mappingSize;
+	}
+
+	std::string_view FileView::view() const {
+		return std::string_view((const char*)mapping, mapping ? mappingSize : 0);
+	}
+
+	FileReader::FileReader() {
+		alignedBuffer = nullptr;
+		chunkSize = 0;
+		fileSize = 0;
+		filePosition = 0;
+#if WIN32
+		fileHandle = nullptr;
+#else
+		fd = -1;
+#endif
+	}
+
+	FileReader::~FileReader() {
+		close();
+	}
+
+	bool FileReader::open(const std::string& file, size_t chunkSize, bool direct) {
+		close();
+		this->chunkSize = (std::max(chunkSize, (size_t)1) + alignment - 1) / alignment * alignment;
+
+#if WIN32
+		DWORD flags = FILE_FLAG_SEQUENTIAL_SCAN;
+		HANDLE handle = INVALID_HANDLE_VALUE;
+		if (direct) {
+			handle = CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, flags | FILE_FLAG_NO_BUFFERING, nullptr);
+		}
+		if (handle == INVALID_HANDLE_VALUE) {
+			handle = CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, flags, nullptr);
+		}
+		if (handle == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		LARGE_INTEGER size;
+		GetFileSizeEx(handle, &size);
+		fileHandle = (void*)handle;
+		fileSize = size.QuadPart;
+#else
+		fd = -1;
+#ifdef O_DIRECT
+		if (direct) {
+			fd = ::open(file.c_str(), O_RDONLY | O_DIRECT);
+		}
+#endif
+		if (fd == -1) {
+			fd = ::open(file.c_str(), O_RDONLY);
+		}
+		if (fd == -1) {
+			return false;
+		}
+		struct stat info;
+		fstat(fd, &info);
+		fileSize = info.st_size;
+#ifdef POSIX_FADV_SEQUENTIAL
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+#endif
+
+		//unbuffered reads need the buffer, the size and the file offset aligned
+		buffer.resize(this->chunkSize + alignment);
+		uintptr_t address = (uintptr_t)buffer.data();
+		alignedBuffer = (uint8_t*)((address + alignment - 1) / alignment * alignment);
+		filePosition = 0;
+		return true;
+	}
+
+	void FileReader::close() {
+#if WIN32
+		if (fileHandle) {
+			CloseHandle((HANDLE)fileHandle);
+		}
+		fileHandle = nullptr;
+#else
+		if (fd != -1) {
+			::close(fd);
+		}
+		fd = -1;
+#endif
+		buffer.clear();
+		buffer.shrink_to_fit();
+		alignedBuffer = nullptr;
+		fileSize = 0;
+		filePosition = 0;
+	}
+
+	bool FileReader::isOpen() const {
+#if WIN32
+		return fileHandle != nullptr;
+#else
+		return fd != -1;
+#endif
+	}
+
+	std::string_view FileReader::read() {
+		if (!isOpen() || filePosition >= fileSize) {
+			return std::string_view();
+		}
+
+		size_t bytes = 0;
+#if WIN32
+		DWORD result = 0;
+		if (ReadFile((HANDLE)fileHandle, alignedBuffer, (DWORD)chunkSize, &result, nullptr)) {
+			bytes = result;
+		}
+#else
+		while (true) {
+			ssize_t result = ::read(fd, alignedBuffer, chunkSize);
+			if (result < 0 && errno == EINTR) {
+				continue;
+			}
+			bytes = result > 0 ? (size_t)result : 0;
+			break;
+		}
+#endif
+
+		filePosition += bytes;
+		return std::string_view((const char*)alignedBuffer, bytes);
+	}
+
+	uint64_t FileReader::size() const {
+		return fileSize;
+	}
+
+	uint64_t FileReader::position() const {
+		return filePosition;
+	}
+
+	bool replaceFile(const std::string& source, const std::string& target) {
+#if WIN32
+		if (MoveFileExA(source.c_str(), target.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+			return true;
+		}
+		DWORD error = GetLastError();
+		if (error != ERROR_ACCESS_DENIED && error != ERROR_SHARING_VIOLATION && error != ERROR_USER_MAPPED_FILE) {
+			return false;
+		}
+
+		//a file with a mapped view can not be deleted, which replacing it would do, but it can be renamed
+		//the old file is deleted once it is no longer mapped, the next replace retries leftovers
+		for (int i = 0; i < 16; i++) {
+			std::string old = target + ".old" + std::to_string(i);
+			DeleteFileA(old.c_str());
+			if (!MoveFileExA(target.c_str(), old.c_str(), 0)) {
+				continue;
+			}
+			if (!MoveFileExA(source.c_str(), target.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+				MoveFileExA(old.c_str(), target.c_str(), 0);
+				return false;
+			}
+			DeleteFileA(old.c_str());
+			return true;
+		}
+		return false;
+#else
+		//the inode of a replaced file stays alive as long as it is mapped
+		return ::rename(source.c_str(), target.c_str()) == 0;
+#endif
+	}
+
+}
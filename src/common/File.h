@@ -0,0 +1,82 @@
+//
+// Copyright (c) 2024 Julian Hinxlage. All rights reserved.
+//
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace baseline {
+
+	//memory mapped view of a whole file, pages are only read when they are accessed
+	class FileView {
+	public:
+		FileView();
+		~FileView();
+		FileView(const FileView&) = delete;
+		FileView& operator=(const FileView&) = delete;
+		FileView(FileView&& view) noexcept;
+		FileView& operator=(FileView&& view) noexcept;
+
+		//with copyOnWrite the view can be written to, changes are private and never reach the file
+		bool open(const std::string& file, bool copyOnWrite = false);
+		void close();
+		bool isOpen() const;
+
+		//nullptr for empty files
+		uint8_t* data() const;
+		uint64_t size() const;
+		std::string_view view() const;
+
+	private:
+		uint8_t* mapping;
+		uint64_t mappingSize;
+		bool opened;
+#if WIN32
+		void* fileHandle;
+		void* mappingHandle;
+#endif
+	};
+
+	//reads a file front to back in large aligned chunks, without mapping or copying the whole file
+	class FileReader {
+	public:
+		static constexpr size_t alignment = 4096;
+
+		FileReader();
+		~FileReader();
+		FileReader(const FileReader&) = delete;
+		FileReader& operator=(const FileReader&) = delete;
+
+		//chunkSize is rounded up to the alignment
+		//direct bypasses the os page cache (O_DIRECT / FILE_FLAG_NO_BUFFERING) and falls back to buffered reads if not supported
+		bool open(const std::string& file, size_t chunkSize = 1024 * 1024, bool direct = false);
+		void close();
+		bool isOpen() const;
+
+		//the next chunk, valid until the next call, empty at the end of the file or on error
+		std::string_view read();
+		uint64_t size() const;
+		uint64_t position() const;
+
+	private:
+		std::vector<uint8_t> buffer;
+		uint8_t* alignedBuffer;
+		size_t chunkSize;
+		uint64_t fileSize;
+		uint64_t filePosition;
+#if WIN32
+		void* fileHandle;
+#else
+		int fd;
+#endif
+	};
+
+	//renames source to target and replaces target if it exists, also while target is opened by a FileView or FileReader
+	//views of the replaced file keep the old content
+	bool replaceFile(const std::string& source, const std::string& target);
+
+}
@@ -3,9 +3,18 @@
 //
 
 #include "Log.h"
+#include "LogArgs.h"
+#include "BinaryLog.h"
 #include "DateTime.h"
 #include <cstdarg>
+#include <cstring>
 #include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <chrono>
+#include <algorithm>
 #include <fstream>
 #include <filesystem>
 
@@ -40,10 +49,150 @@ namespace baseline {
 		std::ofstream stream;
 	};
 	std::vector<LogFile> logFiles;
+	class BinaryLogFile {
+	public:
+		std::string filename;
+		LogLevel level;
+		std::shared_ptr<BinaryLogWriter> writer;
+	};
+	std::vector<BinaryLogFile> binaryLogFiles;
 	std::function<void(LogLevel level, const std::string& message)> logCallback = nullptr;
 
+	//a captured message, followed by the packed arguments
+	class LogRecord {
+	public:
+		uint32_t size;
+		uint32_t argsSize;
+		uint64_t time;
+		const char* fmt;
+		LogLevel level;
+	};
+
+	//single producer single consumer ring of log records
+	class LogRing {
+	public:
+		static constexpr uint32_t wrapMarker = 0xffffffff;
+
+		std::vector<uint8_t> data;
+		std::atomic<uint64_t> head = 0;
+		std::atomic<uint64_t> tail = 0;
+		std::atomic_bool exited = false;
+
+		bool write(const LogRecord& header, const std::string& args) {
+			uint64_t capacity = data.size();
+			uint32_t size = (sizeof(LogRecord) + args.size() + 7) & ~7;
+			uint64_t h = head.load(std::memory_order_relaxed);
+			uint64_t t = tail.load(std::memory_order_acquire);
+
+			uint64_t offset = h % capacity;
+			uint64_t contiguous = capacity - offset;
+			uint64_t needed = size > contiguous ? size + contiguous : size;
+			if (capacity - (h - t) < needed) {
+				return false;
+			}
+			if (size > contiguous) {
+				*(uint32_t*)(data.data() + offset) = wrapMarker;
+				h += contiguous;
+				offset = 0;
+			}
+
+			LogRecord* record = (LogRecord*)(data.data() + offset);
+			*record = header;
+			record->size = size;
+			record->argsSize = args.size();
+			memcpy(record + 1, args.data(), args.size());
+			head.store(h + size, std::memory_order_release);
+			return true;
+		}
+	};
+
+	class AsyncLog {
+	public:
+		std::atomic_bool enabled = false;
+		LogOverflow overflow = LogOverflow::COUNT;
+		int ringSize = 1024 * 1024;
+		double flushInterval = 1;
+		std::atomic<uint64_t> dropped = 0;
+		uint64_t reportedDropped = 0;
+
+		std::vector<std::shared_ptr<LogRing>> rings;
+		std::mutex ringsMutex;
+		std::thread* thread = nullptr;
+		std::atomic_bool running = false;
+		std::mutex wakeupMutex;
+		std::condition_variable wakeup;
+		std::condition_variable flushed;
+		uint64_t flushRequests = 0;
+		uint64_t flushDone = 0;
+
+		~AsyncLog();
+		void start();
+		void stop();
+		void flush();
+		bool log(LogLevel level, const char* fmt, va_list args);
+		LogRing* getRing();
+		void run();
+		bool drain();
+	};
+	AsyncLog asyncLog;
+
+	class LogRingHolder {
+	public:
+		std::shared_ptr<LogRing> ring;
+
+		~LogRingHolder() {
+			if (ring) {
+				ring->exited = true;
+			}
+		}
+	};
+	thread_local LogRingHolder ringHolder;
+	thread_local bool isLogThread = false;
+
+	static uint64_t nowNano() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+
+	//date and time only change once per second, so the prefix is cached
+	void Log::appendPrefix(std::string& out, uint64_t time, LogLevel level) {
+		thread_local uint64_t cachedSecond = -1;
+		thread_local char cachedPrefix[64];
+		thread_local int cachedLength = 0;
+
+		uint64_t second = time / 1000 / 1000 / 1000;
+		if (second != cachedSecond) {
+			DateTime dateTime;
+			dateTime.fromTimeStamp((uint32_t)second);
+			cachedLength = snprintf(cachedPrefix, sizeof(cachedPrefix), "[%02d.%02d.%04d] [%02d:%02d:%02d] ",
+				dateTime.day, dateTime.month, dateTime.year, dateTime.hour, dateTime.minute, dateTime.second);
+			cachedSecond = second;
+		}
+		out.append(cachedPrefix, cachedLength);
+		out.push_back('[');
+		out.append(logLevelName(level));
+		out.append("] ");
+	}
+
+	std::atomic<int> Log::minimumLevel = (int)LogLevel::TRACE;
+
+	void Log::updateMinimumLevel() {
+		int level = (int)consoleLevel;
+		for (auto& f : logFiles) {
+			level = std::min(level, (int)f.level);
+		}
+		for (auto& f : binaryLogFiles) {
+			level = std::min(level, (int)f.level);
+		}
+		if (logCallback) {
+			level = (int)LogLevel::TRACE;
+		}
+		minimumLevel = level;
+	}
+
 	void Log::setConsoleLogLevel(LogLevel level) {
+		std::unique_lock<std::mutex> lock(mutex);
 		consoleLevel = level;
+		updateMinimumLevel();
 	}
 
 	void Log::addLogFile(const std::string& file, LogLevel level) {
@@ -61,13 +210,32 @@ namespace baseline {
 		std::unique_lock<std::mutex> lock(mutex);
 		logFiles.push_back({ file, level });
 		logFiles.back().stream.open(file, std::ios_base::app);
+		updateMinimumLevel();
+	}
+
+	void Log::addBinaryLogFile(const std::string& file, LogLevel level, uint64_t maxFileSize, int maxFileCount) {
+		if (file.empty()) {
+			return;
+		}
+
+		auto writer = std::make_shared<BinaryLogWriter>();
+		if (!writer->open(file, maxFileSize, maxFileCount)) {
+			return;
+		}
+
+		std::unique_lock<std::mutex> lock(mutex);
+		binaryLogFiles.push_back({ file, level, writer });
+		updateMinimumLevel();
 	}
 
 	void Log::setLogCallback(const std::function<void(LogLevel level, const std::string& message)>& callback) {
+		std::unique_lock<std::mutex> lock(mutex);
 		logCallback = callback;
+		updateMinimumLevel();
 	}
 
 	void Log::removeLogFile(const std::string& file) {
+		flush();
 		std::unique_lock<std::mutex> lock(mutex);
 		for (int i = 0; i < logFiles.size(); i++) {
 			if (logFiles[i].filename == file) {
@@ -76,80 +244,369 @@ namespace baseline {
 				i--;
 			}
 		}
+		for (int i = 0; i < binaryLogFiles.size(); i++) {
+			if (binaryLogFiles[i].filename == file) {
+				binaryLogFiles.erase(binaryLogFiles.begin() + i);
+				i--;
+			}
+		}
+		updateMinimumLevel();
 	}
 
 	void Log::removeAllLogFiles() {
+		flush();
 		std::unique_lock<std::mutex> lock(mutex);
 		for (int i = 0; i < logFiles.size(); i++) {
 			logFiles[i].stream.close();
 			logFiles.erase(logFiles.begin() + i);
 			i--;
 		}
+		binaryLogFiles.clear();
+		updateMinimumLevel();
 	}
 
-	void Log::log(LogLevel level, const char* fmt, va_list args) {
+	void Log::setAsync(bool enabled, LogOverflow overflow, int threadBufferSize) {
+		if (enabled) {
+			asyncLog.overflow = overflow;
+			asyncLog.ringSize = std::max(threadBufferSize / 8 * 8, 4096);
+			asyncLog.start();
+			asyncLog.enabled = true;
+		}
+		else {
+			asyncLog.enabled = false;
+			asyncLog.stop();
+		}
+	}
+
+	bool Log::isAsync() {
+		return asyncLog.enabled;
+	}
+
+	void Log::setFlushInterval(double seconds) {
+		asyncLog.flushInterval = seconds;
+	}
+
+	void Log::flush() {
+		asyncLog.flush();
+	}
+
+	uint64_t Log::getDroppedCount() {
+		return asyncLog.dropped;
+	}
+
+	void Log::forgetFormats() {
 		std::unique_lock<std::mutex> lock(mutex);
+		for (auto& f : binaryLogFiles) {
+			f.writer->forgetFormats();
+		}
+	}
+
+	void Log::write(LogLevel level, const std::string& message) {
+		log(level, "%s", message.c_str());
+	}
+
+	void Log::log(LogLevel level, const char* fmt, va_list args) {
+		if (!isEnabled(level)) {
+			return;
+		}
+		if (asyncLog.enabled && !isLogThread) {
+			if (asyncLog.log(level, fmt, args)) {
+				return;
+			}
+		}
+
+		std::string message;
+		va_list list;
+		va_copy(list, args);
+		int length = vsnprintf(nullptr, 0, fmt, list);
+		va_end(list);
+		if (length < 0) {
+			message = "<output truncated>";
+		}
+		else {
+			message.resize(length + 1);
+			va_copy(list, args);
+			vsnprintf(message.data(), message.size(), fmt, list);
+			va_end(list);
+			message.resize(length);
+		}
 
-		DateTime time;
-		time = DateTime::now();
+		std::unique_lock<std::mutex> lock(mutex);
+		uint64_t time = nowNano();
+		std::string line;
+		appendPrefix(line, time, level);
+		line.append(message);
+		line.push_back('\n');
 
 		for (auto& f : logFiles) {
 			if (level >= f.level) {
-				f.stream << "[" << time.toStringDate() << "] ";
-				f.stream << "[" << time.toStringTime() << "] ";
-				f.stream << "[" << logLevelName(level) << "] ";
-				char buf[102400];
-				try {
-					int i = _vsprintf_p(buf, 102400, fmt, args);
-					if (i == -1 && i < 102400) {
-						buf[0] = '\0';
-						f.stream << "<output truncated>";
-					}
-					else {
-						buf[i] = '\0';
-					}
-				}
-				catch (...) {
-					buf[0] = '\0';
-					f.stream << "<output truncated>";
-				}
-				f.stream << (const char*)buf << "\n";
+				f.stream.write(line.data(), line.size());
 				f.stream.flush();
 			}
 		}
 
+		if (!binaryLogFiles.empty()) {
+			thread_local std::string packed;
+			LogArgs::pack(fmt, args, packed);
+			for (auto& f : binaryLogFiles) {
+				if (level >= f.level) {
+					f.writer->write(level, time, fmt, (const uint8_t*)packed.data(), packed.size());
+					f.writer->flush();
+				}
+			}
+		}
+
 		if (logCallback) {
-			std::stringstream s;
-			s << "[" << time.toStringDate() << "] ";
-			s << "[" << time.toStringTime() << "] ";
-			s << "[" << logLevelName(level) << "] ";
-			char buf[102400];
-			try {
-				int i = _vsprintf_p(buf, 102400, fmt, args);
-				if (i == -1 && i < 102400) {
-					buf[0] = '\0';
-					s << "<output truncated>";
+			logCallback(level, line);
+		}
+
+		if (level >= consoleLevel) {
+			fwrite(line.data(), 1, line.size(), stdout);
+		}
+	}
+
+	AsyncLog::~AsyncLog() {
+		enabled = false;
+		stop();
+	}
+
+	void AsyncLog::start() {
+		if (thread) {
+			return;
+		}
+		running = true;
+		thread = new std::thread([this]() {
+			run();
+		});
+	}
+
+	void AsyncLog::stop() {
+		if (thread) {
+			{
+				std::unique_lock<std::mutex> lock(wakeupMutex);
+				running = false;
+			}
+			wakeup.notify_all();
+			thread->join();
+			delete thread;
+			thread = nullptr;
+		}
+	}
+
+	void AsyncLog::flush() {
+		if (!thread || isLogThread) {
+			return;
+		}
+		std::unique_lock<std::mutex> lock(wakeupMutex);
+		uint64_t request = ++flushRequests;
+		wakeup.notify_all();
+		flushed.wait(lock, [&]() {
+			return flushDone >= request || !running;
+		});
+	}
+
+	bool AsyncLog::log(LogLevel level, const char* fmt, va_list args) {
+		thread_local std::string packed;
+		LogArgs::pack(fmt, args, packed);
+
+		LogRecord record;
+		record.size = 0;
+		record.argsSize = 0;
+		record.time = nowNano();
+		record.fmt = fmt;
+		record.level = level;
+
+		LogRing* ring = getRing();
+		if (sizeof(LogRecord) + packed.size() > ring->data.size() / 4) {
+			//too large for the ring, keep the order and write it synchronously
+			flush();
+			return false;
+		}
+
+		while (!ring->write(record, packed)) {
+			if (overflow == LogOverflow::BLOCK && running) {
+				wakeup.notify_all();
+				std::this_thread::yield();
+			}
+			else {
+				dropped++;
+				return true;
+			}
+		}
+
+		if (level == LogLevel::FATAL) {
+			flush();
+		}
+		return true;
+	}
+
+	LogRing* AsyncLog::getRing() {
+		if (!ringHolder.ring) {
+			auto ring = std::make_shared<LogRing>();
+			ring->data.resize(ringSize);
+			std::unique_lock<std::mutex> lock(ringsMutex);
+			rings.push_back(ring);
+			ringHolder.ring = ring;
+		}
+		return ringHolder.ring.get();
+	}
+
+	void AsyncLog::run() {
+		isLogThread = true;
+		uint64_t lastFlush = nowNano();
+		while (true) {
+			uint64_t request = 0;
+			bool flushRequested = false;
+			{
+				std::unique_lock<std::mutex> lock(wakeupMutex);
+				wakeup.wait_for(lock, std::chrono::milliseconds(10), [&]() {
+					return flushRequests != flushDone || !running;
+				});
+				request = flushRequests;
+				flushRequested = flushRequests != flushDone;
+			}
+			bool stopping = !running;
+
+			bool fatal = drain();
+
+			uint64_t now = nowNano();
+			if (fatal || stopping || flushRequested || (double)(now - lastFlush) / 1000.0 / 1000.0 / 1000.0 >= flushInterval) {
+				std::unique_lock<std::mutex> lock(mutex);
+				for (auto& f : logFiles) {
+					f.stream.flush();
 				}
-				else {
-					buf[i] = '\0';
+				for (auto& f : binaryLogFiles) {
+					f.writer->flush();
 				}
+				fflush(stdout);
+				lastFlush = now;
 			}
-			catch (...) {
-				buf[0] = '\0';
-				s << "<output truncated>";
+
+			{
+				std::unique_lock<std::mutex> lock(wakeupMutex);
+				flushDone = request;
 			}
-			s << (const char*)buf << "\n";
+			flushed.notify_all();
 
-			logCallback(level, s.str());
+			if (stopping) {
+				break;
+			}
 		}
+	}
 
-		if (level >= consoleLevel) {
-			printf("[%s] ", time.toStringDate().c_str());
-			printf("[%s] ", time.toStringTime().c_str());
-			printf("[%s] ", logLevelName(level));
-			vprintf(fmt, args);
-			printf("\n");
+	//writes all captured records in time order, returns true if a fatal message was written
+	bool AsyncLog::drain() {
+		std::vector<std::shared_ptr<LogRing>> list;
+		{
+			std::unique_lock<std::mutex> lock(ringsMutex);
+			list = rings;
+		}
+
+		std::vector<LogRecord*> records;
+		std::vector<uint64_t> ends(list.size());
+		for (int i = 0; i < list.size(); i++) {
+			LogRing* ring = list[i].get();
+			uint64_t capacity = ring->data.size();
+			uint64_t t = ring->tail.load(std::memory_order_relaxed);
+			uint64_t h = ring->head.load(std::memory_order_acquire);
+			while (t < h) {
+				uint64_t offset = t % capacity;
+				uint32_t size = *(uint32_t*)(ring->data.data() + offset);
+				if (size == LogRing::wrapMarker) {
+					t += capacity - offset;
+					continue;
+				}
+				records.push_back((LogRecord*)(ring->data.data() + offset));
+				t += size;
+			}
+			ends[i] = t;
+		}
+
+		std::stable_sort(records.begin(), records.end(), [](LogRecord* a, LogRecord* b) {
+			return a->time < b->time;
+		});
+
+		bool fatal = false;
+		uint64_t droppedCount = dropped;
+		if (records.size() > 0 || (overflow == LogOverflow::COUNT && droppedCount != reportedDropped)) {
+			std::unique_lock<std::mutex> lock(mutex);
+			std::vector<std::string> fileBatches(logFiles.size());
+			std::string consoleBatch;
+			std::string line;
+			std::string message;
+
+			auto write = [&](LogLevel level, uint64_t time, const std::string& message) {
+				line.clear();
+				Log::appendPrefix(line, time, level);
+				line.append(message);
+				line.push_back('\n');
+				for (int i = 0; i < logFiles.size(); i++) {
+					if (level >= logFiles[i].level) {
+						fileBatches[i].append(line);
+					}
+				}
+				if (logCallback) {
+					logCallback(level, line);
+				}
+				if (level >= consoleLevel) {
+					consoleBatch.append(line);
+				}
+			};
+
+			for (auto* record : records) {
+				for (auto& f : binaryLogFiles) {
+					if (record->level >= f.level) {
+						f.writer->write(record->level, record->time, record->fmt, (const uint8_t*)(record + 1), record->argsSize);
+					}
+				}
+
+				bool needsText = logCallback || record->level >= consoleLevel;
+				for (auto& f : logFiles) {
+					needsText |= record->level >= f.level;
+				}
+				if (!needsText) {
+					if (record->level == LogLevel::FATAL) {
+						fatal = true;
+					}
+					continue;
+				}
+				message.clear();
+				LogArgs::format(record->fmt, (const uint8_t*)(record + 1), record->argsSize, message);
+				write(record->level, record->time, message);
+				if (record->level == LogLevel::FATAL) {
+					fatal = true;
+				}
+			}
+
+			if (overflow == LogOverflow::COUNT && droppedCount != reportedDropped) {
+				message = std::to_string(droppedCount - reportedDropped) + " log messages dropped";
+				write(LogLevel::WARNING, nowNano(), message);
+				reportedDropped = droppedCount;
+			}
+
+			for (int i = 0; i < logFiles.size(); i++) {
+				if (!fileBatches[i].empty()) {
+					logFiles[i].stream.write(fileBatches[i].data(), fileBatches[i].size());
+				}
+			}
+			if (!consoleBatch.empty()) {
+				fwrite(consoleBatch.data(), 1, consoleBatch.size(), stdout);
+			}
+		}
+
+		for (int i = 0; i < list.size(); i++) {
+			list[i]->tail.store(ends[i], std::memory_order_release);
+		}
+
+		std::unique_lock<std::mutex> lock(ringsMutex);
+		for (int i = 0; i < rings.size(); i++) {
+			auto& ring = rings[i];
+			if (ring->exited && ring->tail.load() == ring->head.load()) {
+				rings.erase(rings.begin() + i);
+				i--;
+			}
 		}
+		return fatal;
 	}
 
 	void Log::log(LogLevel level, const char* fmt, ...) {
@@ -6,9 +6,28 @@
 
 #include <string>
 #include <functional>
+#include <cstdarg>
+#include <cstdint>
+#include <atomic>
+#if __has_include(<version>)
+#include <version>
+#endif
+//the header can exist without std::format being implemented, so the feature macro is checked
+#if defined(__cpp_lib_format)
+#include <format>
+#define BL_LOG_STD_FORMAT 1
+#else
+#define BL_LOG_STD_FORMAT 0
+#endif
 
 #undef ERROR
 
+//levels below this are compiled out of the BL_LOG macros (0 = TRACE ... 5 = FATAL)
+//set with the cmake variable BASELINE_LOG_MIN_LEVEL
+#ifndef BL_LOG_MIN_LEVEL
+#define BL_LOG_MIN_LEVEL 0
+#endif
+
 namespace baseline {
 
 	enum class LogLevel {
@@ -20,14 +39,53 @@ namespace baseline {
 		FATAL,
 	};
 
+	//what a thread does when its log buffer is full in async mode
+	enum class LogOverflow {
+		BLOCK,
+		DROP,
+		//drop and report the number of dropped messages in the log
+		COUNT,
+	};
+
 	class Log {
 	public:
 		static void setConsoleLogLevel(LogLevel level);
 		static void addLogFile(const std::string& file, LogLevel level);
+		//binary log file (see BinaryLogWriter), decoded to text with the logDecoder tool
+		//format strings are identified by their pointer, so they have to be literals or otherwise never change
+		static void addBinaryLogFile(const std::string& file, LogLevel level, uint64_t maxFileSize = 0, int maxFileCount = 5);
 		static void setLogCallback(const std::function<void(LogLevel level, const std::string &message)>& callback);
 		static void removeLogFile(const std::string& file);
 		static void removeAllLogFiles();
 
+		//in async mode messages are captured into per thread buffers and written by a background thread
+		//format strings are stored by pointer and have to outlive the next flush
+		static void setAsync(bool enabled, LogOverflow overflow = LogOverflow::COUNT, int threadBufferSize = 1024 * 1024);
+		static bool isAsync();
+		static void setFlushInterval(double seconds);
+		static void flush();
+		static uint64_t getDroppedCount();
+		//binary log files cache format strings by pointer, called by the ModuleManager after a library was closed
+		static void forgetFormats();
+
+		//true if any sink (console, file or callback) accepts the level
+		static bool isEnabled(LogLevel level) {
+			return (int)level >= minimumLevel.load(std::memory_order_relaxed);
+		}
+
+#if BL_LOG_STD_FORMAT
+		//std::format style, the format string is checked at compile time
+		template<typename... Args>
+		static void print(LogLevel level, std::format_string<Args...> fmt, Args&&... args) {
+			if (isEnabled(level)) {
+				write(level, std::format(fmt, std::forward<Args>(args)...));
+			}
+		}
+#endif
+		static void write(LogLevel level, const std::string& message);
+		//the "[date] [time] [level] " prefix of a text log line, time in nanoseconds since epoch
+		static void appendPrefix(std::string& out, uint64_t time, LogLevel level);
+
 		static void log(LogLevel level, const char* fmt, va_list args);
 		static void log(LogLevel level, const char* fmt, ...);
 		static void trace(const char *fmt, ...);
@@ -36,6 +94,26 @@ namespace baseline {
 		static void warning(const char* fmt, ...);
 		static void error(const char *fmt, ...);
 		static void fatal(const char *fmt, ...);
+
+	private:
+		static std::atomic<int> minimumLevel;
+		static void updateMinimumLevel();
 	};
 
 }
+
+#if BL_LOG_STD_FORMAT
+#define BL_LOG_PRINT(level, ...) baseline::Log::print(level, __VA_ARGS__)
+#else
+//without std::format the macros take printf style formats like Log::log
+#define BL_LOG_PRINT(level, ...) baseline::Log::log(level, __VA_ARGS__)
+#endif
+
+//the arguments are only evaluated if the level is enabled
+#define BL_LOG(level, ...) do { if constexpr ((int)(level) >= BL_LOG_MIN_LEVEL) { if (baseline::Log::isEnabled(level)) { BL_LOG_PRINT(level, __VA_ARGS__); } } } while (0)
+#define BL_TRACE(...) BL_LOG(baseline::LogLevel::TRACE, __VA_ARGS__)
+#define BL_DEBUG(...) BL_LOG(baseline::LogLevel::DEBUG, __VA_ARGS__)
+#define BL_INFO(...) BL_LOG(baseline::LogLevel::INFO, __VA_ARGS__)
+#define BL_WARNING(...) BL_LOG(baseline::LogLevel::WARNING, __VA_ARGS__)
+#define BL_ERROR(...) BL_LOG(baseline::LogLevel::ERROR, __VA_ARGS__)
+#define BL_FATAL(...) BL_LOG(baseline::LogLevel::FATAL, __VA_ARGS__)
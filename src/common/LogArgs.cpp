@@ -0,0 +1,396 @@
+//
+// Copyright (c) 2024 Julian Hinxlage. All rights reserved.
+//
+
+#include "LogArgs.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cwchar>
+#include <cstddef>
+#include <algorithm>
+
+namespace baseline {
+
+	class FormatSpec {
+	public:
+		const char* flags = nullptr;
+		int flagsLength = 0;
+		const char* width = nullptr;
+		int widthLength = 0;
+		const char* precision = nullptr;
+		int precisionLength = 0;
+		bool hasPrecision = false;
+		char lengthModifier[4] = {};
+		char conversion = 0;
+	};
+
+	//parses the conversion specification after a '%', returns the number of characters consumed
+	static int parseSpec(const char* begin, FormatSpec& spec) {
+		const char* p = begin;
+
+		spec.flags = p;
+		while (*p && strchr("-+ #0'", *p)) {
+			p++;
+		}
+		spec.flagsLength = (int)(p - spec.flags);
+
+		spec.width = p;
+		if (*p == '*') {
+			p++;
+		}
+		else {
+			while (*p >= '0' && *p <= '9') {
+				p++;
+			}
+		}
+		spec.widthLength = (int)(p - spec.width);
+
+		if (*p == '.') {
+			p++;
+			spec.hasPrecision = true;
+			spec.precision = p;
+			if (*p == '*') {
+				p++;
+			}
+			else {
+				while (*p >= '0' && *p <= '9') {
+					p++;
+				}
+			}
+			spec.precisionLength = (int)(p - spec.precision);
+		}
+
+		int length = 0;
+		if (strncmp(p, "hh", 2) == 0 || strncmp(p, "ll", 2) == 0) {
+			length = 2;
+		}
+		else if (strncmp(p, "I64", 3) == 0 || strncmp(p, "I32", 3) == 0) {
+			length = 3;
+		}
+		else if (*p && strchr("hljztLI", *p)) {
+			length = 1;
+		}
+		memcpy(spec.lengthModifier, p, length);
+		spec.lengthModifier[length] = '\0';
+		p += length;
+
+		spec.conversion = *p;
+		if (*p) {
+			p++;
+		}
+		return (int)(p - begin);
+	}
+
+	template<typename T>
+	static void packValue(std::string& out, LogArgs::Tag tag, T value) {
+		out.push_back((char)tag);
+		out.append((const char*)&value, sizeof(value));
+	}
+
+	static void packString(std::string& out, const char* str, int length) {
+		out.push_back((char)LogArgs::STRING);
+		uint32_t size = length;
+		out.append((const char*)&size, sizeof(size));
+		out.append(str, length);
+	}
+
+	void LogArgs::pack(const char* fmt, va_list args, std::string& out) {
+		out.clear();
+		va_list list;
+		va_copy(list, args);
+
+		for (const char* p = fmt; *p; p++) {
+			if (*p != '%') {
+				continue;
+			}
+			if (p[1] == '%') {
+				p++;
+				continue;
+			}
+
+			FormatSpec spec;
+			p += parseSpec(p + 1, spec);
+			if (spec.widthLength == 1 && spec.width[0] == '*') {
+				packValue(out, INT, (int64_t)va_arg(list, int));
+			}
+			//a negative precision is the same as none
+			int precision = -1;
+			if (spec.hasPrecision && spec.precisionLength == 1 && spec.precision[0] == '*') {
+				precision = va_arg(list, int);
+				packValue(out, INT, (int64_t)precision);
+			}
+			else if (spec.hasPrecision) {
+				//stops at the length modifier or conversion, "%.s" is a precision of 0
+				precision = atoi(spec.precision);
+			}
+
+			std::string length = spec.lengthModifier;
+			switch (spec.conversion) {
+			case 'd':
+			case 'i':
+				if (length == "l") {
+					packValue(out, INT, (int64_t)va_arg(list, long));
+				}
+				else if (length == "ll" || length == "I64" || length == "j") {
+					packValue(out, INT, (int64_t)va_arg(list, long long));
+				}
+				else if (length == "z" || length == "t" || length == "I") {
+					packValue(out, INT, (int64_t)va_arg(list, ptrdiff_t));
+				}
+				//format always prints 64 bit values, so the value is truncated to the length here
+				else if (length == "hh") {
+					packValue(out, INT, (int64_t)(signed char)va_arg(list, int));
+				}
+				else if (length == "h") {
+					packValue(out, INT, (int64_t)(short)va_arg(list, int));
+				}
+				else {
+					packValue(out, INT, (int64_t)va_arg(list, int));
+				}
+				break;
+			case 'o':
+			case 'u':
+			case 'x':
+			case 'X':
+				if (length == "l") {
+					packValue(out, UINT, (uint64_t)va_arg(list, unsigned long));
+				}
+				else if (length == "ll" || length == "I64" || length == "j") {
+					packValue(out, UINT, (uint64_t)va_arg(list, unsigned long long));
+				}
+				else if (length == "z" || length == "t" || length == "I") {
+					packValue(out, UINT, (uint64_t)va_arg(list, size_t));
+				}
+				else if (length == "hh") {
+					packValue(out, UINT, (uint64_t)(unsigned char)va_arg(list, unsigned int));
+				}
+				else if (length == "h") {
+					packValue(out, UINT, (uint64_t)(unsigned short)va_arg(list, unsigned int));
+				}
+				else {
+					packValue(out, UINT, (uint64_t)va_arg(list, unsigned int));
+				}
+				break;
+			case 'c':
+				packValue(out, INT, (int64_t)va_arg(list, int));
+				break;
+			case 'f':
+			case 'F':
+			case 'e':
+			case 'E':
+			case 'g':
+			case 'G':
+			case 'a':
+			case 'A':
+				if (length == "L") {
+					packValue(out, DOUBLE, (double)va_arg(list, long double));
+				}
+				else {
+					packValue(out, DOUBLE, va_arg(list, double));
+				}
+				break;
+			case 's':
+			case 'S':
+				if (length == "l" || spec.conversion == 'S') {
+					const wchar_t* str = va_arg(list, const wchar_t*);
+					std::string narrow;
+					for (; str && *str && (precision < 0 || narrow.size() < precision); str++) {
+						narrow.push_back(*str < 128 ? (char)*str : '?');
+					}
+					packString(out, narrow.data(), (int)narrow.size());
+				}
+				else {
+					const char* str = va_arg(list, const char*);
+					if (!str) {
+						str = "(null)";
+					}
+					//with a precision the string does not need to be terminated, only that many characters are read
+					packString(out, str, (int)(precision < 0 ? strlen(str) : strnlen(str, precision)));
+				}
+				break;
+			case 'p':
+				packValue(out, POINTER, (uint64_t)(uintptr_t)va_arg(list, void*));
+				break;
+			case 'n':
+				va_arg(list, void*);
+				break;
+			default:
+				va_end(list);
+				return;
+			}
+		}
+		va_end(list);
+	}
+
+	class ArgReader {
+	public:
+		const uint8_t* data;
+		int size;
+		int index = 0;
+		bool valid = true;
+
+		template<typename T>
+		T read(LogArgs::Tag tag) {
+			T value = T();
+			if (index + 1 + (int)sizeof(T) > size || data[index] != tag) {
+				valid = false;
+				return value;
+			}
+			memcpy(&value, data + index + 1, sizeof(T));
+			index += 1 + sizeof(T);
+			return value;
+		}
+
+		const char* readString(uint32_t& length) {
+			length = read<uint32_t>(LogArgs::STRING);
+			if (!valid || index + (int)length > size) {
+				valid = false;
+				length = 0;
+				return "";
+			}
+			const char* str = (const char*)data + index;
+			index += length;
+			return str;
+		}
+
+		int64_t readInt() {
+			if (index < size && data[index] == LogArgs::UINT) {
+				return (int64_t)read<uint64_t>(LogArgs::UINT);
+			}
+			return read<int64_t>(LogArgs::INT);
+		}
+	};
+
+	template<typename... Args>
+	static void appendFormat(std::string& out, const char* spec, Args... args) {
+		char buffer[256];
+		int length = snprintf(buffer, sizeof(buffer), spec, args...);
+		if (length < 0) {
+			return;
+		}
+		if (length < (int)sizeof(buffer)) {
+			out.append(buffer, length);
+		}
+		else {
+			size_t offset = out.size();
+			out.resize(offset + length + 1);
+			snprintf(out.data() + offset, length + 1, spec, args...);
+			out.resize(offset + length);
+		}
+	}
+
+	void LogArgs::format(const char* fmt, const uint8_t* data, int size, std::string& out) {
+		ArgReader reader;
+		reader.data = data;
+		reader.size = size;
+
+		const char* literal = fmt;
+		for (const char* p = fmt; *p; p++) {
+			if (*p != '%') {
+				continue;
+			}
+			out.append(literal, p - literal);
+			if (p[1] == '%') {
+				out.push_back('%');
+				p++;
+				literal = p + 1;
+				continue;
+			}
+
+			FormatSpec spec;
+			int specLength = parseSpec(p + 1, spec);
+			p += specLength;
+			literal = p + 1;
+
+			char specString[64];
+			int index = 0;
+			specString[index++] = '%';
+			memcpy(specString + index, spec.flags, std::min(spec.flagsLength, 8));
+			index += std::min(spec.flagsLength, 8);
+			if (spec.widthLength == 1 && spec.width[0] == '*') {
+				index += snprintf(specString + index, 16, "%d", (int)reader.readInt());
+			}
+			else {
+				memcpy(specString + index, spec.width, std::min(spec.widthLength, 8));
+				index += std::min(spec.widthLength, 8);
+			}
+			if (spec.hasPrecision) {
+				specString[index++] = '.';
+				if (spec.precisionLength == 1 && spec.precision[0] == '*') {
+					index += snprintf(specString + index, 16, "%d", (int)reader.readInt());
+				}
+				else {
+					memcpy(specString + index, spec.precision, std::min(spec.precisionLength, 8));
+					index += std::min(spec.precisionLength, 8);
+				}
+			}
+
+			switch (spec.conversion) {
+			case 'd':
+			case 'i':
+			case 'o':
+			case 'u':
+			case 'x':
+			case 'X':
+				specString[index++] = 'l';
+				specString[index++] = 'l';
+				specString[index++] = spec.conversion;
+				specString[index] = '\0';
+				if (spec.conversion == 'd' || spec.conversion == 'i') {
+					appendFormat(out, specString, (long long)reader.read<int64_t>(INT));
+				}
+				else {
+					appendFormat(out, specString, (unsigned long long)reader.read<uint64_t>(UINT));
+				}
+				break;
+			case 'c':
+				specString[index++] = 'c';
+				specString[index] = '\0';
+				appendFormat(out, specString, (int)reader.read<int64_t>(INT));
+				break;
+			case 'f':
+			case 'F':
+			case 'e':
+			case 'E':
+			case 'g':
+			case 'G':
+			case 'a':
+			case 'A':
+				specString[index++] = spec.conversion;
+				specString[index] = '\0';
+				appendFormat(out, specString, reader.read<double>(DOUBLE));
+				break;
+			case 's':
+			case 'S': {
+				uint32_t length = 0;
+				const char* str = reader.readString(length);
+				if (spec.widthLength == 0 && !spec.hasPrecision) {
+					out.append(str, length);
+				}
+				else {
+					specString[index++] = 's';
+					specString[index] = '\0';
+					appendFormat(out, specString, std::string(str, length).c_str());
+				}
+				break;
+			}
+			case 'p':
+				appendFormat(out, "%p", (void*)(uintptr_t)reader.read<uint64_t>(POINTER));
+				break;
+			case 'n':
+				break;
+			default:
+				reader.valid = false;
+				break;
+			}
+
+			if (!reader.valid) {
+				out.append("<invalid arguments>");
+				return;
+			}
+		}
+		out.append(literal);
+	}
+
+}
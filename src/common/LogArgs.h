@@ -0,0 +1,29 @@
+//
+// Copyright (c) 2024 Julian Hinxlage. All rights reserved.
+//
+
+#pragma once
+
+#include <string>
+#include <cstdarg>
+#include <cstdint>
+
+namespace baseline {
+
+	//packs printf style arguments into bytes, so a message can be formatted later or on another thread
+	//every argument is stored as a tag byte followed by its value, strings are copied
+	class LogArgs {
+	public:
+		enum Tag : uint8_t {
+			INT = 1,
+			UINT = 2,
+			DOUBLE = 3,
+			STRING = 4,
+			POINTER = 5,
+		};
+
+		static void pack(const char* fmt, va_list args, std::string& out);
+		static void format(const char* fmt, const uint8_t* data, int size, std::string& out);
+	};
+
+}
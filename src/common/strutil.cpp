@@ -3,76 +3,321 @@
 //
 
 #include "strutil.h"
+#include "File.h"
 #include <fstream>
+#include <cstring>
+#include <filesystem>
+
+#if WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define BL_STRUTIL_X64
+#include <immintrin.h>
+#if WIN32
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(_MSC_VER)
+#define BL_TARGET_AVX2
+#else
+#define BL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
 
 namespace baseline {
 
 	std::string readFile(const std::string& file, bool binary) {
 		FILE *f = fopen(file.c_str(), binary ? "rb" : "r");
-		if (f) {
-			try {
-				fseek(f, 0, SEEK_END);
-				int size = ftell(f);
-				fseek(f, 0, SEEK_SET);
-				std::string text;
-				text.resize(size);
-				int bytes = fread(text.data(), 1, text.size(), f);
-				text.resize(bytes);
-				fclose(f);
-				return text;
+		if (!f) {
+			return "";
+		}
+
+		std::error_code error;
+		uint64_t size = std::filesystem::file_size(file, error);
+		std::string text;
+		if (!error) {
+			text.resize(size);
+			size_t bytes = fread(text.data(), 1, text.size(), f);
+			text.resize(bytes);
+		}
+		//files without a known size, text mode reads can also be shorter than the file size
+		char chunk[4096];
+		size_t bytes = 0;
+		while ((bytes = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+			text.append(chunk, bytes);
+		}
+		fclose(f);
+		return text;
+	}
+
+	bool writeFile(const std::string& file, const std::string& text, bool binary) {
+		//written to a temporary file first and renamed, so readers never see a partially written file
+		std::string tmpFile = file + ".tmp";
+		FILE* f = fopen(tmpFile.c_str(), binary ? "wb" : "w");
+		if (!f) {
+			return false;
+		}
+		size_t res = fwrite(text.data(), 1, text.size(), f);
+		bool success = res == text.size() && fflush(f) == 0;
+		if (success) {
+#if WIN32
+			_commit(_fileno(f));
+#else
+			fsync(fileno(f));
+#endif
+		}
+		fclose(f);
+
+		std::error_code error;
+		if (success) {
+			success = replaceFile(tmpFile, file);
+		}
+		if (!success) {
+			std::filesystem::remove(tmpFile, error);
+		}
+		return success;
+	}
+
+#ifdef BL_STRUTIL_X64
+	static bool detectAvx2() {
+#if WIN32
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7) {
+			return false;
+		}
+		__cpuid(info, 1);
+		//the os has to save the ymm registers
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		if (!osxsave || (_xgetbv(0) & 6) != 6) {
+			return false;
+		}
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+
+	static const bool hasAvx2 = detectAvx2();
+
+	static int countTrailingZeros(uint32_t mask) {
+#if WIN32
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return (int)index;
+#else
+		return __builtin_ctz(mask);
+#endif
+	}
+
+	//compares the first and last byte of the search string at every position of a block at once,
+	//only candidates where both match are verified with memcmp
+	BL_TARGET_AVX2 static size_t findAvx2(const char* data, size_t size, const char* search, size_t length) {
+		const __m256i first = _mm256_set1_epi8(search[0]);
+		const __m256i last = _mm256_set1_epi8(search[length - 1]);
+		size_t i = 0;
+		for (; i + length - 1 + 32 <= size; i += 32) {
+			__m256i blockFirst = _mm256_loadu_si256((const __m256i*)(data + i));
+			__m256i blockLast = _mm256_loadu_si256((const __m256i*)(data + i + length - 1));
+			uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, blockFirst), _mm256_cmpeq_epi8(last, blockLast)));
+			while (mask != 0) {
+				int bit = countTrailingZeros(mask);
+				if (length <= 2 || memcmp(data + i + bit + 1, search + 1, length - 2) == 0) {
+					return i + bit;
+				}
+				mask &= mask - 1;
 			}
-			catch (...) {
-				return "";
+		}
+		size_t index = std::string_view(data + i, size - i).find(std::string_view(search, length));
+		return index == std::string_view::npos ? index : i + index;
+	}
+
+	static size_t findSse2(const char* data, size_t size, const char* search, size_t length) {
+		const __m128i first = _mm_set1_epi8(search[0]);
+		const __m128i last = _mm_set1_epi8(search[length - 1]);
+		size_t i = 0;
+		for (; i + length - 1 + 16 <= size; i += 16) {
+			__m128i blockFirst = _mm_loadu_si128((const __m128i*)(data + i));
+			__m128i blockLast = _mm_loadu_si128((const __m128i*)(data + i + length - 1));
+			uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, blockFirst), _mm_cmpeq_epi8(last, blockLast)));
+			while (mask != 0) {
+				int bit = countTrailingZeros(mask);
+				if (length <= 2 || memcmp(data + i + bit + 1, search + 1, length - 2) == 0) {
+					return i + bit;
+				}
+				mask &= mask - 1;
 			}
 		}
+		size_t index = std::string_view(data + i, size - i).find(std::string_view(search, length));
+		return index == std::string_view::npos ? index : i + index;
+	}
+
+	//flips bit 5 of every byte in [min, max], signed compares reject bytes >= 0x80
+	BL_TARGET_AVX2 static size_t convertCaseAvx2(char* data, size_t size, char min, char max) {
+		const __m256i low = _mm256_set1_epi8(min - 1);
+		const __m256i high = _mm256_set1_epi8(max + 1);
+		const __m256i flip = _mm256_set1_epi8(0x20);
+		size_t i = 0;
+		for (; i + 32 <= size; i += 32) {
+			__m256i block = _mm256_loadu_si256((const __m256i*)(data + i));
+			__m256i mask = _mm256_and_si256(_mm256_cmpgt_epi8(block, low), _mm256_cmpgt_epi8(high, block));
+			_mm256_storeu_si256((__m256i*)(data + i), _mm256_xor_si256(block, _mm256_and_si256(mask, flip)));
+		}
+		return i;
+	}
+
+	static size_t convertCaseSse2(char* data, size_t size, char min, char max) {
+		const __m128i low = _mm_set1_epi8(min - 1);
+		const __m128i high = _mm_set1_epi8(max + 1);
+		const __m128i flip = _mm_set1_epi8(0x20);
+		size_t i = 0;
+		for (; i + 16 <= size; i += 16) {
+			__m128i block = _mm_loadu_si128((const __m128i*)(data + i));
+			__m128i mask = _mm_and_si128(_mm_cmpgt_epi8(block, low), _mm_cmpgt_epi8(high, block));
+			_mm_storeu_si128((__m128i*)(data + i), _mm_xor_si128(block, _mm_and_si128(mask, flip)));
+		}
+		return i;
+	}
+#endif
+
+	size_t findString(std::string_view string, std::string_view search, size_t offset) {
+		if (offset > string.size()) {
+			return std::string::npos;
+		}
+		if (search.empty()) {
+			return offset;
+		}
+		const char* data = string.data() + offset;
+		size_t size = string.size() - offset;
+		if (search.size() > size) {
+			return std::string::npos;
+		}
+		size_t index = std::string::npos;
+#ifdef BL_STRUTIL_X64
+		if (hasAvx2) {
+			index = findAvx2(data, size, search.data(), search.size());
+		}
 		else {
-			return "";
+			index = findSse2(data, size, search.data(), search.size());
 		}
+#else
+		index = std::string_view(data, size).find(search);
+#endif
+		return index == std::string::npos ? index : index + offset;
 	}
 
-	bool writeFile(const std::string& file, const std::string& text, bool binary) {
-		FILE* f = fopen(file.c_str(), binary ? "wb" : "w");
-		if (f) {
-			int res = fwrite(text.data(), 1, text.size(), f);
-			if (res != text.size()) {
-				fclose(f);
-				return false;
-			}
-			fclose(f);
-			return true;
+	static void convertCase(char* data, size_t size, char min, char max) {
+		size_t i = 0;
+#ifdef BL_STRUTIL_X64
+		if (hasAvx2) {
+			i = convertCaseAvx2(data, size, min, max);
 		}
 		else {
-			return false;
+			i = convertCaseSse2(data, size, min, max);
+		}
+#endif
+		for (; i < size; i++) {
+			if (data[i] >= min && data[i] <= max) {
+				data[i] ^= 0x20;
+			}
 		}
 	}
 
-	std::vector<std::string> split(const std::string& string, const std::string& delimiter, bool includeEmpty) {
-		std::vector<std::string> parts;
-		std::string token;
-		int delimiterIndex = 0;
-		for (char c : string) {
-			if ((int)delimiter.size() == 0) {
-				parts.push_back({ c, 1 });
+	SplitIterator::SplitIterator() {}
+
+	SplitIterator::SplitIterator(std::string_view string, std::string_view delimiter, bool includeEmpty) {
+		this->string = string;
+		this->delimiter = delimiter;
+		this->includeEmpty = includeEmpty;
+		this->done = false;
+		this->next = 0;
+		find();
+	}
+
+	void SplitIterator::find() {
+		while (true) {
+			if (next > string.size()) {
+				done = true;
+				return;
 			}
-			else if (c == delimiter[delimiterIndex]) {
-				delimiterIndex++;
-				if (delimiterIndex == delimiter.size()) {
-					if (includeEmpty || (int)token.size() != 0) {
-						parts.push_back(token);
-					}
-					token.clear();
-					delimiterIndex = 0;
+			begin = next;
+			if (delimiter.empty()) {
+				if (begin >= string.size()) {
+					done = true;
+					return;
 				}
+				end = begin + 1;
+				next = end;
+				return;
+			}
+
+			size_t index = findString(string, delimiter, begin);
+			if (index == std::string::npos) {
+				end = string.size();
+				next = string.size() + 1;
 			}
 			else {
-				token += delimiter.substr(0, delimiterIndex);
-				token.push_back(c);
-				delimiterIndex = 0;
+				end = index;
+				next = index + delimiter.size();
+			}
+			if (includeEmpty || end != begin) {
+				return;
 			}
 		}
-		token += delimiter.substr(0, delimiterIndex);
-		if (includeEmpty || (int)token.size() != 0) {
-			parts.push_back(token);
+	}
+
+	std::string_view SplitIterator::operator*() const {
+		return string.substr(begin, end - begin);
+	}
+
+	SplitIterator& SplitIterator::operator++() {
+		find();
+		return *this;
+	}
+
+	SplitIterator SplitIterator::operator++(int) {
+		SplitIterator iterator = *this;
+		find();
+		return iterator;
+	}
+
+	bool SplitIterator::operator==(const SplitIterator& iterator) const {
+		if (done || iterator.done) {
+			return done == iterator.done;
+		}
+		return string.data() == iterator.string.data() && begin == iterator.begin;
+	}
+
+	bool SplitIterator::operator!=(const SplitIterator& iterator) const {
+		return !(*this == iterator);
+	}
+
+	SplitIterator SplitRange::begin() const {
+		return SplitIterator(string, delimiter, includeEmpty);
+	}
+
+	SplitIterator SplitRange::end() const {
+		return SplitIterator();
+	}
+
+	SplitRange splitView(std::string_view string, std::string_view delimiter, bool includeEmpty) {
+		SplitRange range;
+		range.string = string;
+		range.delimiter = delimiter;
+		range.includeEmpty = includeEmpty;
+		return range;
+	}
+
+	std::vector<std::string> split(const std::string& string, const std::string& delimiter, bool includeEmpty) {
+		std::vector<std::string> parts;
+		for (std::string_view part : splitView(string, delimiter, includeEmpty)) {
+			parts.emplace_back(part);
 		}
 		return parts;
 	}
@@ -99,7 +344,20 @@ namespace baseline {
 	}
 
 	std::string replace(const std::string& string, const std::string& search, const std::string& replacement) {
-		return join(split(string, search, true), replacement);
+		if (search.empty()) {
+			return string;
+		}
+		std::string result;
+		size_t begin = 0;
+		size_t index = findString(string, search);
+		while (index != std::string::npos) {
+			result.append(string, begin, index - begin);
+			result.append(replacement);
+			begin = index + search.size();
+			index = findString(string, search, begin);
+		}
+		result.append(string, begin);
+		return result;
 	}
 
 	int match(const std::string& string1, const std::string& string2) {
@@ -216,70 +474,49 @@ namespace baseline {
 	}
 
 	bool stringContains(const std::string& string, const std::string& subString) {
-		int matchIndex = 0;
-		for (int i = 0; i < string.size(); i++) {
-			char c = string[i];
-			if (c == subString[matchIndex]) {
-				matchIndex++;
-				if (matchIndex == subString.size()) {
-					return true;
-				}
-			}
-			else {
-				matchIndex = 0;
-			}
-		}
-		return false;
+		return !subString.empty() && findString(string, subString) != std::string::npos;
 	}
 
 	std::string toLower(const std::string& string) {
-		std::string result;
-		for (char c : string) {
-			if (c >= 'A' && c <= 'Z') {
-				result.push_back(c - 'A' + 'a');
-			}
-			else {
-				result.push_back(c);
-			}
-		}
+		std::string result = string;
+		toLower(result.data(), result.size());
 		return result;
 	}
 
 	std::string toUpper(const std::string& string) {
-		std::string result;
-		for (char c : string) {
-			if (c >= 'a' && c <= 'z') {
-				result.push_back(c - 'a' + 'A');
-			}
-			else {
-				result.push_back(c);
-			}
-		}
+		std::string result = string;
+		toUpper(result.data(), result.size());
 		return result;
 	}
 
+	void toLower(char* data, size_t size) {
+		convertCase(data, size, 'A', 'Z');
+	}
+
+	void toUpper(char* data, size_t size) {
+		convertCase(data, size, 'a', 'z');
+	}
+
 	int toInt(const std::string& str, int defaultValue) {
-		try {
-			int value = std::stoi(str);
+		int value = 0;
+		if (parseNumber(str, value)) {
 			return value;
 		}
-		catch (...) {
-			return defaultValue;
-		}
 		return defaultValue;
 	}
 
 	float toFloat(std::string str, float defaultValue, bool allowCommaAsPoint) {
 		if (allowCommaAsPoint) {
-			str = replace(str, ",", ".");
+			for (char& c : str) {
+				if (c == ',') {
+					c = '.';
+				}
+			}
 		}
-		try {
-			float value = std::stof(str);
+		float value = 0;
+		if (parseNumber(str, value)) {
 			return value;
 		}
-		catch (...) {
-			return defaultValue;
-		}
 		return defaultValue;
 	}
 
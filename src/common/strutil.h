@@ -5,7 +5,11 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <iterator>
+#include <charconv>
+#include <type_traits>
 
 namespace baseline {
 
@@ -13,6 +17,52 @@ namespace baseline {
 
 	bool writeFile(const std::string& file, const std::string& text, bool binary = false);
 
+	//position of the first occurrence of search at or after offset, std::string::npos if there is none
+	//uses AVX2 or SSE2 when available
+	size_t findString(std::string_view string, std::string_view search, size_t offset = 0);
+
+	//iterates over the parts of a string without copying, an empty delimiter yields every character on its own
+	class SplitIterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = std::string_view;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const std::string_view*;
+		using reference = std::string_view;
+
+		SplitIterator();
+		SplitIterator(std::string_view string, std::string_view delimiter, bool includeEmpty);
+
+		std::string_view operator*() const;
+		SplitIterator& operator++();
+		SplitIterator operator++(int);
+		bool operator==(const SplitIterator& iterator) const;
+		bool operator!=(const SplitIterator& iterator) const;
+
+	private:
+		std::string_view string;
+		std::string_view delimiter;
+		bool includeEmpty = false;
+		bool done = true;
+		size_t begin = 0;
+		size_t end = 0;
+		size_t next = 0;
+
+		void find();
+	};
+
+	class SplitRange {
+	public:
+		std::string_view string;
+		std::string_view delimiter;
+		bool includeEmpty = false;
+
+		SplitIterator begin() const;
+		SplitIterator end() const;
+	};
+
+	SplitRange splitView(std::string_view string, std::string_view delimiter, bool includeEmpty = false);
+
 	std::vector<std::string> split(const std::string& string, const std::string& delimiter, bool includeEmpty = false);
 
 	std::vector<std::string> split(const std::vector<std::string>& strings, const std::string& delimiter, bool includeEmpty = false);
@@ -39,6 +89,11 @@ namespace baseline {
 	
 	std::string toUpper(const std::string& string);
 
+	//ascii only, converts in place
+	void toLower(char* data, size_t size);
+
+	void toUpper(char* data, size_t size);
+
 	int toInt(const std::string& str, int defaultValue = -1);
 
 	float toFloat(std::string str, float defaultValue = 0, bool allowCommaAsPoint = false);
@@ -53,38 +108,55 @@ namespace baseline {
 
 	bool isNumber(const std::string& str);
 
+	//parses a number at the start of the string like std::stoi/std::stof, but without exceptions and independent of the locale
 	template<typename T>
-	static T fromString(const std::string& string, T defaultValue = T()) {
-		if (std::is_same<T, int>()) {
-			try {
-				return std::stoi(string);
-			}
-			catch (...) {}
+	bool parseNumber(std::string_view string, T& value) {
+		size_t i = 0;
+		while (i < string.size() && (string[i] == ' ' || string[i] == '\t' || string[i] == '\r' || string[i] == '\n')) {
+			i++;
+		}
+		if (i < string.size() && string[i] == '+') {
+			i++;
 		}
-		else if (std::is_same<T, float>()) {
-			try {
-				return std::stof(string);
+		auto result = std::from_chars(string.data() + i, string.data() + string.size(), value);
+		return result.ec == std::errc();
+	}
+
+	//writes the shortest representation that parses back to the same value,
+	//returns the number of characters written or 0 if the buffer is too small
+	template<typename T>
+	int toChars(T value, char* buffer, int size) {
+		if constexpr (std::is_same<T, bool>()) {
+			return toChars((int)value, buffer, size);
+		}
+		else {
+			auto result = std::to_chars(buffer, buffer + size, value);
+			if (result.ec != std::errc()) {
+				return 0;
 			}
-			catch (...) {}
+			return (int)(result.ptr - buffer);
 		}
-		else if (std::is_same<T, double>()) {
-			try {
-				return std::stod(string);
+	}
+
+	template<typename T>
+	static T fromString(const std::string& string, T defaultValue = T()) {
+		if constexpr (std::is_same<T, bool>()) {
+			if (string == "true") {
+				return true;
+			}
+			else if (string == "false") {
+				return false;
+			}
+			int value = 0;
+			if (parseNumber(string, value)) {
+				return value != 0;
 			}
-			catch (...) {}
 		}
-		else if (std::is_same<T, bool>()) {
-			try {
-				if (string == "true") {
-					return true;
-				}else if(string == "false") {
-					return false;
-				}
-				else {
-					return std::stoi(string);
-				}
+		else if constexpr (std::is_arithmetic<T>()) {
+			T value = T();
+			if (parseNumber(string, value)) {
+				return value;
 			}
-			catch (...) {}
 		}
 		return defaultValue;
 	}
@@ -96,7 +168,13 @@ namespace baseline {
 
 	template<typename T>
 	static std::string toString(T value) {
-		return std::to_string(value);
+		if constexpr (std::is_arithmetic<T>()) {
+			char buffer[64];
+			return std::string(buffer, toChars(value, buffer, sizeof(buffer)));
+		}
+		else {
+			return std::to_string(value);
+		}
 	}
 
 	template<>
@@ -104,4 +182,19 @@ namespace baseline {
 		return value;
 	}
 
+	//appends to an existing string instead of creating a temporary one
+	template<typename T>
+	void appendString(std::string& out, const T& value) {
+		if constexpr (std::is_arithmetic<T>()) {
+			char buffer[64];
+			out.append(buffer, toChars(value, buffer, sizeof(buffer)));
+		}
+		else if constexpr (std::is_convertible<T, std::string_view>()) {
+			out.append(std::string_view(value));
+		}
+		else {
+			out.append(toString(value));
+		}
+	}
+
 }
@@ -3,172 +3,731 @@
 //
 
 #include "xml.h"
-#include "strutil.h"
+#include "Log.h"
+#include "File.h"
 #include <string>
 #include <vector>
+#include <cstring>
+#include <algorithm>
 
 namespace baseline {
 
-	XmlNode::XmlNode(const std::string& text) {
-		this->content = text;
+	static bool isNameCharacter(char c) {
+		return (c >= 'a' && c <= 'z') ||
+			(c >= 'A' && c <= 'Z') ||
+			(c >= '0' && c <= '9') ||
+			c == '_' || c == ':' || c == '.' || c == '-';
 	}
 
-	std::string XmlNode::value() {
-		return content;
+	static bool isWhitespace(char c) {
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r';
 	}
 
-	std::string XmlNode::attribute(const std::string& name) {
-		auto parts = split(attributes, name, true);
-		if (parts.size() > 1) {
-			std::string str = parts[1];
-			std::string result = "";
-			bool in = false;
-			for (char c : str) {
-				if (c == '\"') {
-					if (in) {
+	//returns the index of the first occurrence of pattern at or after offset, or size if there is none
+	static size_t find(const char* data, size_t size, size_t offset, const char* pattern, size_t length) {
+		while (offset + length <= size) {
+			const char* p = (const char*)memchr(data + offset, pattern[0], size - offset);
+			if (!p) {
+				break;
+			}
+			offset = p - data;
+			if (offset + length <= size && memcmp(p, pattern, length) == 0) {
+				return offset;
+			}
+			offset++;
+		}
+		return size;
+	}
+
+	void XmlDocument::parse(std::string&& text) {
+		buffer = std::move(text);
+		nodes.clear();
+		attributes.clear();
+
+		//offsets are 32 bit to keep the index small
+		if (buffer.size() >= UINT32_MAX) {
+			Log::warning("xml document is too large (%zu bytes)", buffer.size());
+			buffer.clear();
+		}
+
+		const char* data = buffer.data();
+		size_t size = buffer.size();
+		nodes.reserve(size / 64 + 1);
+
+		//node 0 is a virtual root that spans the whole text
+		Node root;
+		root.contentLength = (uint32_t)size;
+		nodes.push_back(root);
+
+		std::vector<uint32_t> stack;
+		size_t i = 0;
+		while (i < size) {
+			const char* open = (const char*)memchr(data + i, '<', size - i);
+			if (!open) {
+				break;
+			}
+			i = open - data;
+			if (i + 1 >= size) {
+				break;
+			}
+			char c = data[i + 1];
+
+			//comments, cdata, doctype and processing instructions are skipped
+			if (c == '!') {
+				if (size - i >= 4 && memcmp(data + i, "<!--", 4) == 0) {
+					i = find(data, size, i + 4, "-->", 3) + 3;
+				}
+				else if (size - i >= 9 && memcmp(data + i, "<![CDATA[", 9) == 0) {
+					i = find(data, size, i + 9, "]]>", 3) + 3;
+				}
+				else {
+					i = find(data, size, i + 2, ">", 1) + 1;
+				}
+				continue;
+			}
+			if (c == '?') {
+				i = find(data, size, i + 2, "?>", 2) + 2;
+				continue;
+			}
+
+			if (c == '/') {
+				size_t nameBegin = i + 2;
+				size_t nameEnd = nameBegin;
+				while (nameEnd < size && isNameCharacter(data[nameEnd])) {
+					nameEnd++;
+				}
+				std::string_view name(data + nameBegin, nameEnd - nameBegin);
+
+				//unclosed nodes inside the matching one are closed with it, unmatched end tags are ignored
+				for (int s = (int)stack.size() - 1; s >= 0; s--) {
+					if (view(nodes[stack[s]].nameBegin, nodes[stack[s]].nameLength) == name) {
+						for (int k = (int)stack.size() - 1; k >= s; k--) {
+							Node& node = nodes[stack[k]];
+							node.contentLength = (uint32_t)(i - node.contentBegin);
+							node.end = (uint32_t)nodes.size();
+						}
+						stack.resize(s);
 						break;
 					}
-					in = !in;
 				}
-				else if (in) {
-					result.push_back(c);
+				i = find(data, size, nameEnd, ">", 1) + 1;
+				continue;
+			}
+
+			if (!isNameCharacter(c)) {
+				i++;
+				continue;
+			}
+
+			Node node;
+			size_t p = i + 1;
+			node.nameBegin = (uint32_t)p;
+			while (p < size && isNameCharacter(data[p])) {
+				p++;
+			}
+			node.nameLength = (uint32_t)(p - node.nameBegin);
+			node.attributesBegin = (uint32_t)p;
+			node.firstAttribute = (uint32_t)attributes.size();
+
+			bool selfClosing = false;
+			while (p < size) {
+				while (p < size && isWhitespace(data[p])) {
+					p++;
+				}
+				if (p >= size || data[p] == '>') {
+					break;
+				}
+				if (data[p] == '/') {
+					if (p + 1 < size && data[p + 1] == '>') {
+						selfClosing = true;
+						break;
+					}
+					p++;
+					continue;
+				}
+
+				Attribute attribute;
+				attribute.nameBegin = (uint32_t)p;
+				while (p < size && !isWhitespace(data[p]) && data[p] != '=' && data[p] != '>' && data[p] != '/') {
+					p++;
+				}
+				attribute.nameLength = (uint32_t)(p - attribute.nameBegin);
+				while (p < size && isWhitespace(data[p])) {
+					p++;
 				}
+				if (p < size && data[p] == '=') {
+					p++;
+					while (p < size && isWhitespace(data[p])) {
+						p++;
+					}
+					if (p < size && (data[p] == '"' || data[p] == '\'')) {
+						size_t end = find(data, size, p + 1, &data[p], 1);
+						attribute.valueBegin = (uint32_t)(p + 1);
+						attribute.valueLength = (uint32_t)(end - (p + 1));
+						p = end + 1;
+					}
+					else {
+						attribute.valueBegin = (uint32_t)p;
+						while (p < size && !isWhitespace(data[p]) && data[p] != '>') {
+							p++;
+						}
+						attribute.valueLength = (uint32_t)(p - attribute.valueBegin);
+					}
+				}
+				if (attribute.nameLength == 0) {
+					p++;
+					continue;
+				}
+				attributes.push_back(attribute);
 			}
-			return result;
+			p = std::min(p, size);
+
+			node.attributesLength = (uint32_t)(p - node.attributesBegin);
+			node.attributeCount = (uint32_t)(attributes.size() - node.firstAttribute);
+			uint32_t index = (uint32_t)nodes.size();
+			if (selfClosing) {
+				p += 2;
+				node.contentBegin = (uint32_t)p;
+				node.end = index + 1;
+				nodes.push_back(node);
+			}
+			else {
+				p = std::min(p + 1, size);
+				node.contentBegin = (uint32_t)p;
+				nodes.push_back(node);
+				stack.push_back(index);
+			}
+			i = p;
+		}
+
+		//nodes that are never closed extend to the end of the text
+		for (uint32_t index : stack) {
+			nodes[index].contentLength = (uint32_t)(size - nodes[index].contentBegin);
+			nodes[index].end = (uint32_t)nodes.size();
 		}
-		return "";
+		nodes[0].end = (uint32_t)nodes.size();
 	}
 
-	static bool isCharackter(char c) {
-		return (c >= 'a' && c <= 'z') ||
-			(c >= 'A' && c <= 'Z') ||
-			(c >= '0' && c <= '9');
+	std::string_view XmlDocument::view(uint32_t begin, uint32_t length) const {
+		return std::string_view(buffer.data() + begin, length);
+	}
+
+	XmlNode::XmlNode(const std::string& text) {
+		if (!text.empty()) {
+			auto doc = std::make_shared<XmlDocument>();
+			doc->parse(std::string(text));
+			document = doc;
+		}
+	}
+
+	XmlNode::XmlNode(std::string&& text) {
+		if (!text.empty()) {
+			auto doc = std::make_shared<XmlDocument>();
+			doc->parse(std::move(text));
+			document = doc;
+		}
+	}
+
+	XmlNode::XmlNode(const std::shared_ptr<const XmlDocument>& document, uint32_t index) {
+		this->document = document;
+		this->index = index;
+	}
+
+	const XmlDocument::Node* XmlNode::node() const {
+		if (document && index < document->nodes.size()) {
+			return &document->nodes[index];
+		}
+		return nullptr;
+	}
+
+	bool XmlNode::isValid() const {
+		return node() != nullptr;
+	}
+
+	std::string_view XmlNode::name() const {
+		if (auto* n = node()) {
+			return document->view(n->nameBegin, n->nameLength);
+		}
+		return std::string_view();
+	}
+
+	std::string XmlNode::value() const {
+		return std::string(valueView());
+	}
+
+	std::string_view XmlNode::valueView() const {
+		if (auto* n = node()) {
+			return document->view(n->contentBegin, n->contentLength);
+		}
+		return std::string_view();
+	}
+
+	std::string XmlNode::attribute(const std::string& name) const {
+		return std::string(attributeView(name));
+	}
+
+	std::string_view XmlNode::attributeView(std::string_view name) const {
+		if (auto* n = node()) {
+			for (uint32_t i = 0; i < n->attributeCount; i++) {
+				auto& attribute = document->attributes[n->firstAttribute + i];
+				if (document->view(attribute.nameBegin, attribute.nameLength) == name) {
+					return document->view(attribute.valueBegin, attribute.valueLength);
+				}
+			}
+		}
+		return std::string_view();
+	}
+
+	std::string_view XmlNode::attributesView() const {
+		if (auto* n = node()) {
+			return document->view(n->attributesBegin, n->attributesLength);
+		}
+		return std::string_view();
 	}
 
-	std::string XmlNode::readIdentifier(const std::string& str, int offset) {
-		std::string identifier = "";
-		for (int i = offset; i < content.size(); i++) {
-			char c = content[i];
-			if (isCharackter(c)) {
-				identifier.push_back(c);
+	std::vector<XmlNode> XmlNode::childs(const std::string& name, bool justFirst) const {
+		std::vector<XmlNode> result;
+		auto* n = node();
+		if (!n) {
+			return result;
+		}
+
+		//jumps over the subtree of a match, so nested nodes with the same name are not returned
+		uint32_t i = index + 1;
+		while (i < n->end) {
+			auto& child = document->nodes[i];
+			if (document->view(child.nameBegin, child.nameLength) == name) {
+				result.emplace_back(document, i);
+				if (justFirst) {
+					break;
+				}
+				i = child.end;
 			}
 			else {
-				break;
+				i++;
 			}
 		}
-		return identifier;
+		return result;
 	}
 
-	std::vector<XmlNode> XmlNode::childs(const std::string& name, bool justFirst) {
-		bool inTag = false;
-		bool inNode = false;
-		bool inQuotes = false;
-		bool inComment = false;
-		int depth = 0;
-		int beginTagIndex = 0;
-		int beginOpenIndex = 0;
-		int beginCloseIndex = 0;
+	XmlNode XmlNode::child(const std::string& name) const {
+		auto nodes = childs(name, true);
+		if (nodes.size() > 0) {
+			return nodes[0];
+		}
+		else {
+			return XmlNode();
+		}
+	}
 
-		std::vector<XmlNode> nodes;
-		XmlNode node;
+	std::vector<XmlNode> XmlNode::childs() const {
+		std::vector<XmlNode> result;
+		auto* n = node();
+		if (!n) {
+			return result;
+		}
+		for (uint32_t i = index + 1; i < n->end; i = document->nodes[i].end) {
+			result.emplace_back(document, i);
+		}
+		return result;
+	}
 
-		for (int i = 0; i < content.size(); i++) {
-			char c = content[i];
+	int XmlNode::contentRootOffset() const {
+		if (auto* n = node()) {
+			return (int)n->contentBegin;
+		}
+		return 0;
+	}
 
-			if (content.substr(i, 4) == "<!--") {
-				inComment = true;
-				i += 3;
-				continue;
+	static void appendUtf8(std::string& out, uint32_t code) {
+		if (code < 0x80) {
+			out.push_back((char)code);
+		}
+		else if (code < 0x800) {
+			out.push_back((char)(0xc0 | (code >> 6)));
+			out.push_back((char)(0x80 | (code & 0x3f)));
+		}
+		else if (code < 0x10000) {
+			out.push_back((char)(0xe0 | (code >> 12)));
+			out.push_back((char)(0x80 | ((code >> 6) & 0x3f)));
+			out.push_back((char)(0x80 | (code & 0x3f)));
+		}
+		else {
+			out.push_back((char)(0xf0 | (code >> 18)));
+			out.push_back((char)(0x80 | ((code >> 12) & 0x3f)));
+			out.push_back((char)(0x80 | ((code >> 6) & 0x3f)));
+			out.push_back((char)(0x80 | (code & 0x3f)));
+		}
+	}
+
+	//decodes a single entity without the leading '&' and trailing ';', returns false if unknown
+	static bool decodeEntity(std::string_view entity, std::string& out) {
+		if (entity == "lt") { out.push_back('<'); }
+		else if (entity == "gt") { out.push_back('>'); }
+		else if (entity == "amp") { out.push_back('&'); }
+		else if (entity == "quot") { out.push_back('"'); }
+		else if (entity == "apos") { out.push_back('\''); }
+		else if (entity.size() > 1 && entity[0] == '#') {
+			uint32_t code = 0;
+			bool hex = entity[1] == 'x' || entity[1] == 'X';
+			size_t i = hex ? 2 : 1;
+			if (i >= entity.size()) {
+				return false;
 			}
-			if (content.substr(i, 3) == "-->") {
-				inComment = false;
-				i += 2;
-				continue;
+			for (; i < entity.size(); i++) {
+				char c = entity[i];
+				uint32_t digit = 0;
+				if (c >= '0' && c <= '9') {
+					digit = c - '0';
+				}
+				else if (hex && c >= 'a' && c <= 'f') {
+					digit = c - 'a' + 10;
+				}
+				else if (hex && c >= 'A' && c <= 'F') {
+					digit = c - 'A' + 10;
+				}
+				else {
+					return false;
+				}
+				code = code * (hex ? 16 : 10) + digit;
+				if (code > 0x10ffff) {
+					return false;
+				}
+			}
+			appendUtf8(out, code);
+		}
+		else {
+			return false;
+		}
+		return true;
+	}
+
+	void XmlReader::reset() {
+		state = CONTENT;
+		terminator = nullptr;
+		depth = 0;
+		pending.clear();
+		decoded.clear();
+		error.clear();
+	}
+
+	bool XmlReader::feed(const char* data, size_t size) {
+		if (!error.empty()) {
+			return false;
+		}
+
+		//complete the token left over from the last chunk by appending up to the next delimiter at a time
+		size_t offset = 0;
+		while (!pending.empty() && offset < size && error.empty()) {
+			size_t next = offset;
+			while (next < size && data[next] != '>' && data[next] != ';' && data[next] != '<') {
+				next++;
+			}
+			next = std::min(next + 1, size);
+			pending.append(data + offset, next - offset);
+			offset = next;
+
+			size_t used = process(pending.data(), pending.size(), false);
+			pending.erase(0, used);
+			if (pending.size() > maxTokenSize) {
+				error = "xml token exceeds the maximum size";
+			}
+		}
+
+		if (pending.empty() && offset < size && error.empty()) {
+			size_t used = process(data + offset, size - offset, false);
+			pending.assign(data + offset + used, size - offset - used);
+			if (pending.size() > maxTokenSize) {
+				error = "xml token exceeds the maximum size";
+			}
+		}
+		return error.empty();
+	}
+
+	bool XmlReader::finish() {
+		if (!error.empty()) {
+			return false;
+		}
+		if (!pending.empty()) {
+			std::string rest;
+			rest.swap(pending);
+			process(rest.data(), rest.size(), true);
+		}
+		if (error.empty() && state != CONTENT) {
+			error = "unterminated xml comment, cdata or declaration";
+		}
+		if (error.empty() && depth != 0) {
+			error = "unclosed xml element";
+		}
+		return error.empty();
+	}
+
+	bool XmlReader::readFile(const std::string& file, size_t chunkSize) {
+		FileReader reader;
+		if (!reader.open(file, chunkSize)) {
+			error = "could not open " + file;
+			return false;
+		}
+		for (std::string_view chunk = reader.read(); !chunk.empty(); chunk = reader.read()) {
+			if (!feed(chunk.data(), chunk.size())) {
+				return false;
 			}
-			if (inComment) {
+		}
+		return finish();
+	}
+
+	bool XmlReader::hasError() const {
+		return !error.empty();
+	}
+
+	const std::string& XmlReader::getError() const {
+		return error;
+	}
+
+	int XmlReader::getDepth() const {
+		return depth;
+	}
+
+	size_t XmlReader::process(const char* data, size_t size, bool final) {
+		size_t i = 0;
+		while (i < size && error.empty()) {
+			if (state == COMMENT || state == SKIP) {
+				size_t length = strlen(terminator);
+				size_t end = find(data, size, i, terminator, length);
+				if (end == size) {
+					//keep a possibly split terminator
+					return final ? size : size - std::min(size - i, length - 1);
+				}
+				i = end + length;
+				state = CONTENT;
 				continue;
 			}
 
-			if (!inNode) {
-				if (c == '<') {
-					beginOpenIndex = i;
-					std::string ident = readIdentifier(content, i + 1);
-					if (ident == name) {
-						i += ident.size();
-						inTag = true;
-						inNode = true;
-						depth = 1;
-						beginTagIndex = i + 1;
+			if (state == CDATA) {
+				size_t end = find(data, size, i, "]]>", 3);
+				if (end == size) {
+					size_t keep = final ? 0 : std::min(size - i, (size_t)2);
+					if (size - keep > i) {
+						emit(XmlEventType::TEXT, std::string_view(), std::string_view(data + i, size - keep - i));
 					}
+					return size - keep;
 				}
+				if (end > i) {
+					emit(XmlEventType::TEXT, std::string_view(), std::string_view(data + i, end - i));
+				}
+				i = end + 3;
+				state = CONTENT;
+				continue;
 			}
-			else {
-				if (c == '<' && !inQuotes) {
-					beginOpenIndex = i;
-					depth++;
-				}
-				if (c == '>' && !inQuotes) {
-					if (inTag) {
-						node.attributes = content.substr(beginTagIndex, i - beginTagIndex);
-						beginCloseIndex = i;
-					}
-					inTag = false;
-					depth--;
-				}
-				if (c == '\"') {
-					inQuotes = !inQuotes;
-				}
-				if (c == '/' && !inQuotes) {
-					if (inTag) {
-						node.attributes = content.substr(beginTagIndex, i - beginTagIndex);
-						node.contentRootOffset = i + contentRootOffset;
-						nodes.push_back(node);
-						node = XmlNode();
-						inNode = false;
-						inTag = false;
-						depth = 0;
-						beginTagIndex = 0;
-						beginOpenIndex = 0;
-						beginCloseIndex = 0;
-						if (justFirst) {
+
+			if (data[i] != '<') {
+				const char* open = (const char*)memchr(data + i, '<', size - i);
+				size_t end = open ? open - data : size;
+				if (!open && !final) {
+					//hold back an entity that could continue in the next chunk
+					for (size_t k = end; k > i && end - k < 16; k--) {
+						if (data[k - 1] == ';') {
 							break;
 						}
-					}
-					else {
-						if (depth == 1) {
-							std::string ident = readIdentifier(content, i + 1);
-							if (ident == name) {
-								node.content = content.substr(beginCloseIndex + 1, beginOpenIndex - (beginCloseIndex + 1));
-								node.contentRootOffset = beginCloseIndex + 1 + contentRootOffset;
-								nodes.push_back(node);
-								node = XmlNode();
-								inNode = false;
-								inTag = false;
-								depth = 0;
-								beginTagIndex = 0;
-								beginOpenIndex = 0;
-								beginCloseIndex = 0;
-								if (justFirst) {
-									break;
-								}
-							}
+						if (data[k - 1] == '&') {
+							end = k - 1;
+							break;
 						}
 					}
 				}
+				if (end > i) {
+					text(data + i, end - i);
+				}
+				if (!open) {
+					return end;
+				}
+				i = end;
+				continue;
+			}
+
+			size_t left = size - i;
+			if (left < 2) {
+				return final ? size : i;
+			}
+			char c = data[i + 1];
+			if (c == '!') {
+				if (left >= 4 && memcmp(data + i, "<!--", 4) == 0) {
+					state = COMMENT;
+					terminator = "-->";
+					i += 4;
+				}
+				else if (left >= 9 && memcmp(data + i, "<![CDATA[", 9) == 0) {
+					state = CDATA;
+					i += 9;
+				}
+				else if (!final && (memcmp(data + i, "<!--", std::min(left, (size_t)4)) == 0 || memcmp(data + i, "<![CDATA[", std::min(left, (size_t)9)) == 0)) {
+					return i;
+				}
+				else {
+					state = SKIP;
+					terminator = ">";
+					i += 2;
+				}
+				continue;
+			}
+			if (c == '?') {
+				state = SKIP;
+				terminator = "?>";
+				i += 2;
+				continue;
 			}
 
+			//the tag ends at the first '>' outside of quotes
+			char quote = 0;
+			size_t end = i + 1;
+			for (; end < size; end++) {
+				char e = data[end];
+				if (quote) {
+					if (e == quote) {
+						quote = 0;
+					}
+				}
+				else if (e == '"' || e == '\'') {
+					quote = e;
+				}
+				else if (e == '>') {
+					break;
+				}
+			}
+			if (end == size) {
+				if (final) {
+					error = "unterminated xml tag";
+					return size;
+				}
+				return i;
+			}
+			tag(data + i, end + 1 - i);
+			i = end + 1;
 		}
-		return nodes;
+		return i;
 	}
 
-	XmlNode XmlNode::child(const std::string& name) {
-		auto nodes = childs(name, true);
-		if (nodes.size() > 0) {
-			return nodes[0];
+	void XmlReader::tag(const char* data, size_t size) {
+		size_t p = 1;
+		bool closing = data[p] == '/';
+		if (closing) {
+			p++;
+		}
+		size_t nameBegin = p;
+		while (p < size && isNameCharacter(data[p])) {
+			p++;
+		}
+		std::string_view name(data + nameBegin, p - nameBegin);
+		if (name.empty()) {
+			error = "invalid xml tag";
+			return;
+		}
+
+		if (closing) {
+			if (depth == 0) {
+				error = "unexpected xml end tag";
+				return;
+			}
+			depth--;
+			emit(XmlEventType::END, name, std::string_view());
+			return;
+		}
+
+		emit(XmlEventType::START, name, std::string_view());
+		bool selfClosing = false;
+		while (p < size - 1 && error.empty()) {
+			while (p < size - 1 && isWhitespace(data[p])) {
+				p++;
+			}
+			if (p >= size - 1) {
+				break;
+			}
+			if (data[p] == '/') {
+				selfClosing = true;
+				p++;
+				continue;
+			}
+
+			size_t attributeBegin = p;
+			while (p < size - 1 && !isWhitespace(data[p]) && data[p] != '=' && data[p] != '/') {
+				p++;
+			}
+			std::string_view attributeName(data + attributeBegin, p - attributeBegin);
+			while (p < size - 1 && isWhitespace(data[p])) {
+				p++;
+			}
+			std::string_view value;
+			if (p < size - 1 && data[p] == '=') {
+				p++;
+				while (p < size - 1 && isWhitespace(data[p])) {
+					p++;
+				}
+				if (p < size - 1 && (data[p] == '"' || data[p] == '\'')) {
+					size_t end = find(data, size - 1, p + 1, &data[p], 1);
+					value = std::string_view(data + p + 1, end - (p + 1));
+					p = end + 1;
+				}
+				else {
+					size_t valueBegin = p;
+					while (p < size - 1 && !isWhitespace(data[p])) {
+						p++;
+					}
+					value = std::string_view(data + valueBegin, p - valueBegin);
+				}
+			}
+			if (attributeName.empty()) {
+				p++;
+				continue;
+			}
+			emit(XmlEventType::ATTRIBUTE, attributeName, decode(value));
+		}
+
+		if (selfClosing) {
+			emit(XmlEventType::END, name, std::string_view());
 		}
 		else {
-			return XmlNode();
+			depth++;
+		}
+	}
+
+	void XmlReader::text(const char* data, size_t size) {
+		emit(XmlEventType::TEXT, std::string_view(), decode(std::string_view(data, size)));
+	}
+
+	void XmlReader::emit(XmlEventType type, std::string_view name, std::string_view value) {
+		if (callback) {
+			XmlEvent event;
+			event.type = type;
+			event.name = name;
+			event.value = value;
+			event.depth = depth;
+			callback(event);
+		}
+	}
+
+	std::string_view XmlReader::decode(std::string_view str) {
+		size_t amp = str.find('&');
+		if (amp == std::string_view::npos) {
+			return str;
+		}
+
+		//unknown entities are kept as they are
+		decoded.clear();
+		size_t i = 0;
+		while (amp != std::string_view::npos) {
+			decoded.append(str.data() + i, amp - i);
+			size_t semicolon = str.find(';', amp);
+			if (semicolon == std::string_view::npos || semicolon - amp > 12 || !decodeEntity(str.substr(amp + 1, semicolon - amp - 1), decoded)) {
+				decoded.push_back('&');
+				i = amp + 1;
+			}
+			else {
+				i = semicolon + 1;
+			}
+			amp = str.find('&', i);
 		}
+		decoded.append(str.data() + i, str.size() - i);
+		return decoded;
 	}
 
 }
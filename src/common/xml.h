@@ -5,27 +5,140 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <memory>
+#include <cstdint>
+#include <functional>
 
 namespace baseline {
 
-	class XmlNode {
+	//parsed in a single pass into a flat node index over one immutable buffer
+	//nodes are stored in document order, the subtree of a node is the range [index + 1, end)
+	class XmlDocument {
 	public:
-		std::string attributes;
-		std::string content;
-		int contentRootOffset = 0;
+		class Node {
+		public:
+			uint32_t nameBegin = 0;
+			uint32_t nameLength = 0;
+			uint32_t attributesBegin = 0;
+			uint32_t attributesLength = 0;
+			uint32_t contentBegin = 0;
+			uint32_t contentLength = 0;
+			uint32_t firstAttribute = 0;
+			uint32_t attributeCount = 0;
+			uint32_t end = 0;
+		};
+
+		class Attribute {
+		public:
+			uint32_t nameBegin = 0;
+			uint32_t nameLength = 0;
+			uint32_t valueBegin = 0;
+			uint32_t valueLength = 0;
+		};
+
+		std::string buffer;
+		std::vector<Node> nodes;
+		std::vector<Attribute> attributes;
 
+		void parse(std::string&& text);
+		std::string_view view(uint32_t begin, uint32_t length) const;
+	};
+
+	class XmlNode {
+	public:
 		XmlNode(const std::string& text = "");
+		XmlNode(std::string&& text);
+		XmlNode(const std::shared_ptr<const XmlDocument>& document, uint32_t index);
+
+		bool isValid() const;
+		std::string_view name() const;
+
+		//raw content between the start and end tag
+		std::string value() const;
+		std::string_view valueView() const;
+		std::string attribute(const std::string& name) const;
+		std::string_view attributeView(std::string_view name) const;
+		std::string_view attributesView() const;
+
+		//matching descendants in document order, matches are not searched for further matches
+		std::vector<XmlNode> childs(const std::string& name, bool justFirst = false) const;
+		XmlNode child(const std::string& name) const;
+		std::vector<XmlNode> childs() const;
+
+		//offset of the content in the parsed text
+		int contentRootOffset() const;
+
+	private:
+		std::shared_ptr<const XmlDocument> document;
+		uint32_t index = 0;
+
+		const XmlDocument::Node* node() const;
+	};
+
+	enum class XmlEventType {
+		START,
+		END,
+		TEXT,
+		ATTRIBUTE,
+	};
+
+	//views are only valid during the callback, entities are decoded
+	class XmlEvent {
+	public:
+		XmlEventType type;
+		std::string_view name;
+		std::string_view value;
+		int depth = 0;
+	};
+
+	//incremental event based reader, the document is fed in chunks of any size
+	//only an incomplete token is kept between chunks, so memory does not grow with the document
+	//text and cdata can be reported in several consecutive TEXT events, ATTRIBUTE events follow their START event
+	class XmlReader {
+	public:
+		std::function<void(const XmlEvent&)> callback;
+		//a single tag larger than this is an error
+		size_t maxTokenSize = 1024 * 1024;
 
-		std::string value();
+		void reset();
+		bool feed(const char* data, size_t size);
+		//consumes all readable bytes of a network Buffer or anything with data(), size() and skip()
+		template<typename T>
+		bool feed(T& buffer) {
+			bool result = feed((const char*)buffer.data(), (size_t)buffer.size());
+			buffer.skip(buffer.size());
+			return result;
+		}
+		//has to be called after the last chunk
+		bool finish();
+		bool readFile(const std::string& file, size_t chunkSize = 64 * 1024);
 
-		std::string attribute(const std::string& name);
+		bool hasError() const;
+		const std::string& getError() const;
+		int getDepth() const;
 
-		std::string readIdentifier(const std::string& str, int offset);
+	private:
+		enum State {
+			CONTENT,
+			COMMENT,
+			CDATA,
+			SKIP,
+		};
 
-		std::vector<XmlNode> childs(const std::string& name, bool justFirst = false);
+		State state = CONTENT;
+		const char* terminator = nullptr;
+		int depth = 0;
+		std::string pending;
+		std::string decoded;
+		std::string error;
 
-		XmlNode child(const std::string& name);
+		size_t process(const char* data, size_t size, bool final);
+		void tag(const char* data, size_t size);
+		void text(const char* data, size_t size);
+		void emit(XmlEventType type, std::string_view name, std::string_view value);
+		std::string_view decode(std::string_view str);
 	};
 
 }
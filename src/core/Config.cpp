@@ -4,10 +4,28 @@
 
 #include "Config.h"
 #include "common/Log.h"
+#include "common/File.h"
+#include "Singleton.h"
+#include "TaskManager.h"
+#include "FileWatcher.h"
 #include <filesystem>
 
 namespace baseline {
-	
+
+	Config::Config() {
+		addVar("enableConfigReload", &enableLiveReload);
+	}
+
+	Config::~Config() {
+		for (auto* slot : slots) {
+			delete slot->var.load();
+			delete slot;
+		}
+		for (auto* var : retiredVars) {
+			delete var;
+		}
+	}
+
 	void Config::loadFile(const std::string& file) {
 		try {
 			if (!std::filesystem::exists(file)) {
@@ -21,25 +39,114 @@ namespace baseline {
 		}
 
 		Log::info("loading config file %s", file.c_str());
+		FileView view;
+		if (!view.open(file)) {
+			Log::warning("config file %s could not be opened", file.c_str());
+			return;
+		}
+		std::error_code error;
+		std::string path = std::filesystem::absolute(file, error).lexically_normal().string();
+		if (error) {
+			path = file;
+		}
+
+		std::unique_lock<std::recursive_mutex> lock(loadMutex);
 		prevLoadedFile = loadedFile;
 		loadedFile = file;
-		load(readFile(file));
+		LoadedFile& state = loadedFiles[path];
+		load(view.view(), state);
+
+		//a command of a reloaded file can load a file on the watcher thread, so the field is read through its variable
+		if (getValue<bool>("enableConfigReload", true) && !state.watched) {
+			Singleton::get<FileWatcher>()->addFile(path, [this, path]() {
+				reload(path);
+			});
+			state.watched = true;
+		}
+	}
+
+	void Config::reload() {
+		std::unique_lock<std::recursive_mutex> lock(loadMutex);
+		std::vector<std::string> paths;
+		for (auto& file : loadedFiles) {
+			if (!file.first.empty()) {
+				paths.push_back(file.first);
+			}
+		}
+		for (auto& path : paths) {
+			reload(path);
+		}
 	}
 
-	void Config::load(const std::string& text) {
-		vars.clear();
-		auto lines = split(text, "\n");
-		for (auto& line : lines) {
-			for (int i = 0; i < line.size(); i++) {
-				if (line[i] == '#') {
-					line.resize(i);
-					break;
+	void Config::reload(const std::string& path) {
+		std::unique_lock<std::recursive_mutex> lock(loadMutex);
+		if (!getValue<bool>("enableConfigReload", true)) {
+			return;
+		}
+		FileView view;
+		if (!view.open(path)) {
+			Log::warning("config file %s could not be opened", path.c_str());
+			return;
+		}
+		Log::info("reloading config file %s", path.c_str());
+		load(view.view(), loadedFiles[path]);
+	}
+
+	void Config::load(std::string_view text) {
+		std::unique_lock<std::recursive_mutex> lock(loadMutex);
+		load(text, loadedFiles[""]);
+	}
+
+	void Config::update() {
+		std::shared_lock<std::shared_mutex> lock(mutex);
+		for (auto* slot : slots) {
+			if (Var* var = slot->var.load(std::memory_order_acquire)) {
+				var->update();
+			}
+		}
+	}
+
+	void Config::load(std::string_view text, LoadedFile& state) {
+		std::unordered_map<std::string, std::string> values;
+		std::unordered_map<std::string, bool> commandLines;
+
+		for (std::string_view line : splitView(text, "\n")) {
+			size_t comment = line.find('#');
+			if (comment != std::string_view::npos) {
+				line = line.substr(0, comment);
+			}
+			//the file is mapped as it is, so windows line endings are still there
+			if (!line.empty() && line.back() == '\r') {
+				line.remove_suffix(1);
+			}
+			if (line.empty()) {
+				continue;
+			}
+
+			std::string string(line);
+			std::vector<std::string> parts = splitLine(string);
+			if (parts.empty()) {
+				continue;
+			}
+
+			if (getCommand(parts[0])) {
+				if (state.commands.find(string) == state.commands.end()) {
+					execute(string, true);
 				}
+				commandLines[string] = true;
 			}
-			if (!line.empty()) {
-				execute(line, true);
+			else {
+				//unchanged lines are skipped, execute only notifies if the value really changed
+				auto entry = state.values.find(parts[0]);
+				if (entry == state.values.end() || entry->second != string) {
+					execute(string, true);
+				}
+				values[parts[0]] = string;
 			}
 		}
+
+		state.values.swap(values);
+		state.commands.swap(commandLines);
 	}
 
 	void Config::loadFirstFileFound(const std::vector<std::string>& files) {
@@ -79,24 +186,64 @@ namespace baseline {
 	}
 
 	Config::Var* Config::getVar(const std::string& name) {
-		for (auto& var : vars) {
-			if (var) {
-				if (var->name == name) {
-					return var;
-				}
-			}
+		std::shared_lock<std::shared_mutex> lock(mutex);
+		auto entry = varIndex.find(name);
+		if (entry != varIndex.end()) {
+			return entry->second->var.load(std::memory_order_acquire);
 		}
 		return nullptr;
 	}
 
+	Config::Slot* Config::getSlot(const std::string& name) {
+		std::shared_lock<std::shared_mutex> lock(mutex);
+		auto entry = varIndex.find(name);
+		if (entry != varIndex.end()) {
+			return entry->second;
+		}
+		return nullptr;
+	}
+
+	Config::Var* Config::insertVar(Var* var) {
+		std::unique_lock<std::shared_mutex> lock(mutex);
+		Slot*& slot = varIndex[var->name];
+		if (!slot) {
+			slot = new Slot();
+			slots.push_back(slot);
+		}
+		Var* previous = slot->var.load(std::memory_order_relaxed);
+		if (previous) {
+			var->setString(previous->getString());
+			retiredVars.push_back(previous);
+		}
+		slot->var.store(var, std::memory_order_release);
+		return var;
+	}
+
 	void Config::addCommand(const std::string& name, const Callback& callback) {
+		std::unique_lock<std::shared_mutex> lock(mutex);
+		auto entry = commandIndex.find(name);
+		if (entry != commandIndex.end()) {
+			commands[entry->second].callback = callback;
+			return;
+		}
 		Command command;
 		command.name = name;
 		command.callback = callback;
+		commandIndex[name] = commands.size();
 		commands.push_back(command);
 	}
 
+	Config::Callback Config::getCommand(const std::string& name) {
+		std::shared_lock<std::shared_mutex> lock(mutex);
+		auto entry = commandIndex.find(name);
+		if (entry != commandIndex.end()) {
+			return commands[entry->second].callback;
+		}
+		return nullptr;
+	}
+
 	std::vector<std::string> Config::getCommandList() {
+		std::shared_lock<std::shared_mutex> lock(mutex);
 		std::vector<std::string> list;
 		for (auto& command : commands) {
 			list.push_back(command.name);
@@ -105,19 +252,68 @@ namespace baseline {
 	}
 
 	std::vector<std::string> Config::getVarList(){
+		std::shared_lock<std::shared_mutex> lock(mutex);
 		std::vector<std::string> list;
-		for (auto& var : vars) {
-			if (var) {
+		for (auto* slot : slots) {
+			if (Var* var = slot->var.load(std::memory_order_acquire)) {
 				list.push_back(var->name);
 			}
 		}
 		return list;
 	}
 
-	void Config::execute(const std::string& string, bool canCreateVariables) {
+	int Config::addChangeCallback(const std::string& name, const ChangeCallback& callback) {
+		std::unique_lock<std::mutex> lock(listenerMutex);
+		ChangeListener listener;
+		listener.id = nextListenerId++;
+		listener.name = name;
+		listener.callback = callback;
+		changeListeners.push_back(listener);
+		return listener.id;
+	}
+
+	void Config::removeChangeCallback(int id) {
+		std::unique_lock<std::mutex> lock(listenerMutex);
+		for (int i = 0; i < changeListeners.size(); i++) {
+			if (changeListeners[i].id == id) {
+				changeListeners.erase(changeListeners.begin() + i);
+				return;
+			}
+		}
+	}
+
+	void Config::notifyChange(const std::string& name) {
+		std::vector<ChangeCallback> callbacks;
+		{
+			std::unique_lock<std::mutex> lock(listenerMutex);
+			for (auto& listener : changeListeners) {
+				if (listener.name == name && listener.callback) {
+					callbacks.push_back(listener.callback);
+				}
+			}
+		}
+		if (callbacks.empty()) {
+			return;
+		}
+
+		//keeps the file watcher thread and the caller free of module code
+		TaskManager* taskManager = Singleton::get<TaskManager>();
+		for (auto& callback : callbacks) {
+			if (taskManager->getWorkerCount() > 0) {
+				taskManager->addTask([callback, name]() {
+					callback(name);
+				}, TaskType::NORMAL, "config change " + name);
+			}
+			else {
+				callback(name);
+			}
+		}
+	}
+
+	std::vector<std::string> Config::splitLine(const std::string& line) {
 		std::vector<std::string> parts;
 		int i = 0;
-		for (auto& part1 : split(string, "\"", true)) {
+		for (auto& part1 : split(line, "\"", true)) {
 			if (i % 2 == 0) {
 				for (auto& part2 : split(part1, " ")) {
 					parts.push_back(part2);
@@ -128,44 +324,47 @@ namespace baseline {
 			}
 			i++;
 		}
+		return parts;
+	}
+
+	void Config::execute(const std::string& string, bool canCreateVariables) {
+		std::vector<std::string> parts = splitLine(string);
 
 		if (parts.size() > 0) {
 			std::string name = parts[0];
 			parts.erase(parts.begin());
 
-			for (auto& command : commands) {
-				if (command.name == name) {
-					if (command.callback) {
-						command.callback(parts);
-						return;
-					}
-				}
+			//the callback is called without holding the lock, so it can add commands and variables
+			if (Callback callback = getCommand(name)) {
+				callback(parts);
+				return;
 			}
-			for (auto& var : vars) {
-				if (var) {
-					if (var->name == name) {
-						if (parts.size() > 0) {
-							if (parts[0] == "=") {
-								if (parts.size() > 1) {
-									var->setString(parts[1]);
-								}
-							}
-							else {
-								var->setString(parts[0]);
-							}
-						}
-						else {
-							Log::info("%s = %s", name.c_str(), var->getString().c_str());
+			if (Var* var = getVar(name)) {
+				if (parts.size() > 0) {
+					std::string previous = var->getString();
+					if (parts[0] == "=") {
+						if (parts.size() > 1) {
+							var->setString(parts[1]);
 						}
-						return;
+					}
+					else {
+						var->setString(parts[0]);
+					}
+					if (var->getString() != previous) {
+						notifyChange(name);
 					}
 				}
+				else {
+					Log::info("%s = %s", name.c_str(), var->getString().c_str());
+				}
+				return;
 			}
 
 			if (parts.size() > 0 && canCreateVariables) {
 				if (parts[0] == "=") {
 					if (parts.size() > 1) {
 						addVar<std::string>(name, parts[1]);
+						notifyChange(name);
 						return;
 					}
 				}
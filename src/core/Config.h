@@ -5,42 +5,141 @@
 #pragma once
 
 #include "common/strutil.h"
+#include "common/Log.h"
 #include <string>
 #include <vector>
 #include <functional>
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <typeinfo>
 
 namespace baseline {
 
 	class Config {
 	public:
 		typedef std::function<void(const std::vector<std::string>&)> Callback;
+		typedef std::function<void(const std::string& name)> ChangeCallback;
 
+		//the loaded files are watched and changes are applied while running
+		bool enableLiveReload = true;
+
+		Config();
+		~Config();
+
+		//a file loaded by a command of another file is watched and reloaded on its own
 		void loadFile(const std::string& file);
-		void load(const std::string& text);
+		//only assignments that differ from the previous load are applied and only new command lines are executed
+		//existing variables are kept, so bound pointers and handles stay valid
+		void load(std::string_view text);
+		//reloads all loaded files
+		void reload();
+		//writes values that were set on other threads, for example by a live reload, into the fields bound on the calling thread
+		//has to be called regularly by the thread that bound the fields, the gui Window does it every frame
+		void update();
 		void loadFirstFileFound(const std::vector<std::string>& files);
 		std::string getConfigFilename();
 		std::string getFilename(const std::string& varname, const std::string& defaultValue = "");
 
+		template<typename T>
+		static size_t typeHashOf() {
+			static const size_t hash = typeid(T).hash_code();
+			return hash;
+		}
+
 		class Var {
 		public:
 			std::string name;
+			//typeid hash of the stored type, used to read the value without a string conversion
+			size_t typeHash = 0;
+			//bound to a field with addVar, the field is only accessed on the thread that bound it
+			bool bound = false;
 
+			virtual ~Var() {}
 			virtual void setString(const std::string& string) = 0;
 			virtual std::string getString() = 0;
+			virtual void appendString(std::string& out) = 0;
+			virtual void update() {}
 
 			template<typename T>
 			void set(T value) {
-				setString(toString(value));
+				if (typeHash == typeHashOf<T>()) {
+					((VarT<T>*)this)->store(value);
+				}
+				else {
+					setString(toString(value));
+				}
 			}
 
 			template<typename T>
 			T get() {
+				if (typeHash == typeHashOf<T>()) {
+					return ((VarT<T>*)this)->load();
+				}
 				return fromString<T>(getString());
 			}
 		};
 
+		class Slot {
+		public:
+			std::atomic<Var*> var = nullptr;
+		};
+
+		//typed reference to a variable, reading is an atomic load of the variable and of the value for types up to 8 bytes
+		//variables bound to a field with addVar access the field on the binding thread and a published copy on other threads
+		//handles stay valid for the lifetime of the config, also when the variable is replaced or reloaded
+		template<typename T>
+		class Handle {
+		public:
+			Handle(Slot* slot = nullptr) : slot(slot) {}
+
+			T get() const {
+				Var* var = slot ? slot->var.load(std::memory_order_acquire) : nullptr;
+				if (!var) {
+					return T();
+				}
+				return var->get<T>();
+			}
+
+			void set(const T& value) const {
+				Var* var = slot ? slot->var.load(std::memory_order_acquire) : nullptr;
+				if (var) {
+					var->set<T>(value);
+				}
+			}
+
+			bool isValid() const {
+				return slot != nullptr;
+			}
+
+		private:
+			Slot* slot;
+		};
+
 		Var* getVar(const std::string& name);
 
+		//creates the variable with defaultValue if it does not exist
+		//a variable of another type, for example one created by the config file, is replaced and its value converted once
+		//a variable bound to a field keeps its type, the handle then converts through strings on every access
+		template<typename T>
+		Handle<T> getHandle(const std::string& name, const T& defaultValue = T()) {
+			Var* var = getVar(name);
+			if (var && var->typeHash == typeHashOf<T>()) {
+				return Handle<T>(getSlot(name));
+			}
+			if (var && var->bound) {
+				Log::warning("config: variable %s is bound to a field of another type, the handle converts the value", name.c_str());
+				return Handle<T>(getSlot(name));
+			}
+			VarT<T>* newVar = new VarT<T>();
+			newVar->name = name;
+			newVar->store(defaultValue);
+			insertVar(newVar);
+			return Handle<T>(getSlot(name));
+		}
+
 		template<typename T>
 		T getValue(const std::string& name, T defaultValue = T()) {
 			if (auto* var = getVar(name)) {
@@ -58,64 +157,198 @@ namespace baseline {
 			}
 			else {
 				VarT<T>* newVar = new VarT<T>();
-				newVar->data = value;
 				newVar->name = name;
-				vars.push_back(newVar);
+				newVar->store(value);
+				insertVar(newVar);
 			}
 		}
 
 		template<typename T>
 		void addVar(const std::string& name, const T& value) {
 			VarT<T>* newVar = new VarT<T>();
-			newVar->data = value;
 			newVar->name = name;
-			vars.push_back(newVar);
+			newVar->store(value);
+			insertVar(newVar);
 		}
+		//binds a field that belongs to the calling thread, values set on other threads are written to it by update
 		template<typename T>
 		void addVar(const std::string& name, T* value) {
 			VarT<T>* newVar = new VarT<T>();
 			newVar->value = value;
+			newVar->owner = std::this_thread::get_id();
+			newVar->bound = true;
 			newVar->name = name;
-			vars.push_back(newVar);
+			newVar->published.store(*value);
+			insertVar(newVar);
 		}
 
 		void addCommand(const std::string& name, const Callback& callback);
 		void execute(const std::string& string, bool canCreateVariables = false);
 
+		//called when the value of the variable is changed by the config file or by execute
+		//the callbacks run on a TaskManager worker, or directly if the TaskManager has no workers
+		int addChangeCallback(const std::string& name, const ChangeCallback& callback);
+		void removeChangeCallback(int id);
+
 		std::vector<std::string> getCommandList();
 		std::vector<std::string> getVarList();
 
 	private:
-
 		class Command {
 		public:
 			std::string name;
 			Callback callback;
 		};
+
+		class ChangeListener {
+		public:
+			int id = 0;
+			std::string name;
+			ChangeCallback callback;
+		};
+
+		template<typename T, bool = std::is_trivially_copyable<T>::value && sizeof(T) <= 8>
+		class AtomicValue {
+		public:
+			std::atomic<T> value;
+
+			T load() const {
+				return value.load(std::memory_order_acquire);
+			}
+
+			void store(const T& v) {
+				value.store(v, std::memory_order_release);
+			}
+		};
+
+		//types that do not fit into a std::atomic are guarded by a lock
+		template<typename T>
+		class AtomicValue<T, false> {
+		public:
+			mutable std::mutex mutex;
+			T value = T();
+
+			T load() const {
+				std::unique_lock<std::mutex> lock(mutex);
+				return value;
+			}
+
+			void store(const T& v) {
+				std::unique_lock<std::mutex> lock(mutex);
+				value = v;
+			}
+		};
+
 		template<typename T>
 		class VarT : public Var {
 		public:
-			T *value;
-			T data;
+			//the bound field, nullptr if the variable owns its value
+			T* value = nullptr;
+			//the thread that bound the field, it is the only one that reads or writes it
+			std::thread::id owner;
+			//the value of variables that own their storage, the copy of the field that other threads see for bound variables
+			AtomicValue<T> published;
+			//a value was set on another thread and is not written to the field yet
+			bool pending = false;
+			std::mutex boundMutex;
 
 			VarT() {
-				value = &data;
+				typeHash = typeHashOf<T>();
+			}
+
+			T load() {
+				if (bound && std::this_thread::get_id() == owner) {
+					std::unique_lock<std::mutex> lock(boundMutex);
+					sync();
+					return *value;
+				}
+				return published.load();
+			}
+
+			void store(const T& v) {
+				if (!bound) {
+					published.store(v);
+					return;
+				}
+				std::unique_lock<std::mutex> lock(boundMutex);
+				published.store(v);
+				if (std::this_thread::get_id() == owner) {
+					*value = v;
+					pending = false;
+				}
+				else {
+					pending = true;
+				}
+			}
+
+			virtual void update() {
+				if (bound && std::this_thread::get_id() == owner) {
+					std::unique_lock<std::mutex> lock(boundMutex);
+					sync();
+				}
+			}
+
+			//a value set on another thread is written to the field, otherwise direct writes to the field are published
+			void sync() {
+				if (pending) {
+					*value = published.load();
+					pending = false;
+				}
+				else {
+					published.store(*value);
+				}
 			}
 
 			virtual void setString(const std::string& string) {
-				*value = fromString<T>(string);
+				store(fromString<T>(string));
 			}
 
 			virtual std::string getString() {
-				return toString(*value);
+				return toString(load());
+			}
+
+			virtual void appendString(std::string& out) {
+				baseline::appendString(out, load());
 			}
 		};
 
-		std::vector<Var*> vars;
+		//slots are never removed, so handles can keep pointers to them
+		std::vector<Slot*> slots;
+		std::unordered_map<std::string, Slot*> varIndex;
+		//replaced variables are kept alive for readers that still hold them
+		std::vector<Var*> retiredVars;
 		std::vector<Command> commands;
+		std::unordered_map<std::string, int> commandIndex;
+		std::shared_mutex mutex;
 		std::string loadedFile;
 		std::string prevLoadedFile;
+
+		//state of the last load of a file, used to find the lines that changed
+		class LoadedFile {
+		public:
+			std::unordered_map<std::string, std::string> values;
+			std::unordered_map<std::string, bool> commands;
+			bool watched = false;
+		};
+
+		std::vector<ChangeListener> changeListeners;
+		int nextListenerId = 1;
+		std::mutex listenerMutex;
+
+		//keyed by absolute path, text loaded with load() uses the empty path
+		//elements are not moved by inserts, so a file can be loaded by a command while another one is loading
+		std::unordered_map<std::string, LoadedFile> loadedFiles;
+		//recursive, a command of the file can load another file
+		std::recursive_mutex loadMutex;
+
+		//a variable with the same name is replaced, its current value is taken over
+		Var* insertVar(Var* var);
+		Slot* getSlot(const std::string& name);
+		Callback getCommand(const std::string& name);
+		void load(std::string_view text, LoadedFile& state);
+		void reload(const std::string& path);
+		void notifyChange(const std::string& name);
+		static std::vector<std::string> splitLine(const std::string& line);
 	};
 
 }
-
@@ -3,7 +3,19 @@
 //
 
 #include "FileWatcher.h"
+#include "Singleton.h"
+#include "TaskManager.h"
+#include "common/Clock.h"
 #include <filesystem>
+#include <algorithm>
+
+#if __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
 
 namespace baseline {
 
@@ -16,6 +28,25 @@ namespace baseline {
 		}
 	}
 
+	static std::string absolutePath(const std::string& file) {
+		std::string path = std::filesystem::absolute(file).lexically_normal().string();
+		while (path.size() > 1 && (path.back() == '/' || path.back() == '\\')) {
+			path.pop_back();
+		}
+		return path;
+	}
+
+	static bool isInside(const std::string& directory, const std::string& file, bool recursive) {
+		if (file.size() <= directory.size() || file.compare(0, directory.size(), directory) != 0) {
+			return false;
+		}
+		char seperator = file[directory.size()];
+		if (seperator != '/' && seperator != '\\') {
+			return false;
+		}
+		return recursive || file.find_first_of("/\\", directory.size() + 1) == std::string::npos;
+	}
+
 	FileWatcher::FileWatcher() {
 		start();
 	}
@@ -26,51 +57,64 @@ namespace baseline {
 
 	void FileWatcher::start() {
 		stop();
-		running = true;
 
-		thread = new std::thread([&]() {
-			while (running) {
-				{
-					std::unique_lock<std::mutex> lock(mutex);
-					for (int i = 0; i < handles.size(); i++) {
-						auto& handle = handles[i];
-						uint64_t timestamp = getTimestamp(handle.file);
-						if (timestamp != handle.timestamp && timestamp != 0) {
-							handle.timestamp = timestamp;
-							if (handle.callback) {
-								lock.unlock();
-								handle.callback();
-								lock.lock();
-							}
-							if (handle.onlyOneInvoke) {
-								handle.callback = nullptr;
-								handles.erase(handles.begin() + i);
-								i--;
-							}
-						}
-					}
-				}
-				std::this_thread::sleep_for(std::chrono::milliseconds((uint64_t)(checkTimeInterval * 1000)));
+#if __linux__
+		eventDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (eventDescriptor != -1 && pipe2(wakeDescriptors, O_NONBLOCK | O_CLOEXEC) != 0) {
+			close(eventDescriptor);
+			eventDescriptor = -1;
+		}
+#endif
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			for (auto& handle : handles) {
+				setupHandle(handle);
 			}
+			nextPollTime = 0;
+		}
 
+		running = true;
+		thread = new std::thread([&]() {
+			run();
 		});
 	}
 
 	void FileWatcher::stop() {
 		if (thread) {
 			running = false;
+			wake();
 			thread->join();
 			delete thread;
 			thread = nullptr;
 		}
+
+		std::unique_lock<std::mutex> lock(mutex);
+#if __linux__
+		if (eventDescriptor != -1) {
+			close(eventDescriptor);
+			close(wakeDescriptors[0]);
+			close(wakeDescriptors[1]);
+		}
+#endif
+		eventDescriptor = -1;
+		wakeDescriptors[0] = -1;
+		wakeDescriptors[1] = -1;
+		watches.clear();
+		watchDirectories.clear();
+		pending.clear();
+		for (auto& handle : handles) {
+			handle.watches.clear();
+			handle.polled = true;
+		}
 	}
 
 	void FileWatcher::addFile(const std::string& file, const Callback& callback, bool onlyOneInvoke) {
 		std::unique_lock<std::mutex> lock(mutex);
 
-		std::string absolut = std::filesystem::absolute(file).string();
+		std::string absolut = absolutePath(file);
 		for (auto& handle : handles) {
-			if (handle.file == absolut) {
+			if (handle.file == absolut && !handle.directory) {
 				handle.callback = callback;
 				return;
 			}
@@ -81,6 +125,7 @@ namespace baseline {
 		handle.callback = callback;
 		handle.timestamp = getTimestamp(absolut);
 		handle.onlyOneInvoke = onlyOneInvoke;
+		setupHandle(handle);
 
 		handles.push_back(handle);
 	}
@@ -88,14 +133,409 @@ namespace baseline {
 	void FileWatcher::removeFile(const std::string& file) {
 		std::unique_lock<std::mutex> lock(mutex);
 
-		std::string absolut = std::filesystem::absolute(file).string();
+		std::string absolut = absolutePath(file);
+		for (int i = 0; i < handles.size(); i++) {
+			auto& handle = handles[i];
+			if (handle.file == absolut && !handle.directory) {
+				removeWatches(handle);
+				handles.erase(handles.begin() + i);
+				return;
+			}
+		}
+	}
+
+	void FileWatcher::addDirectory(const std::string& directory, const FileCallback& callback, bool recursive) {
+		std::unique_lock<std::mutex> lock(mutex);
+
+		std::string absolut = absolutePath(directory);
+		for (auto& handle : handles) {
+			if (handle.file == absolut && handle.directory) {
+				handle.fileCallback = callback;
+				return;
+			}
+		}
+
+		Handle handle;
+		handle.file = absolut;
+		handle.fileCallback = callback;
+		handle.directory = true;
+		handle.recursive = recursive;
+		setupHandle(handle);
+
+		handles.push_back(handle);
+	}
+
+	void FileWatcher::removeDirectory(const std::string& directory) {
+		std::unique_lock<std::mutex> lock(mutex);
+
+		std::string absolut = absolutePath(directory);
 		for (int i = 0; i < handles.size(); i++) {
 			auto& handle = handles[i];
-			if (handle.file == absolut) {
+			if (handle.file == absolut && handle.directory) {
+				removeWatches(handle);
 				handles.erase(handles.begin() + i);
 				return;
 			}
 		}
 	}
 
+	bool FileWatcher::isEventDriven() {
+		std::unique_lock<std::mutex> lock(mutex);
+		if (eventDescriptor == -1) {
+			return false;
+		}
+		for (auto& handle : handles) {
+			if (handle.polled) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void FileWatcher::run() {
+		while (running) {
+			std::vector<std::function<void()>> calls;
+			uint64_t timeout = 0;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				uint64_t now = Clock::nowMilli();
+
+				std::vector<std::string> due;
+				for (auto& entry : pending) {
+					if (entry.second <= now) {
+						due.push_back(entry.first);
+					}
+				}
+				for (auto& file : due) {
+					pending.erase(file);
+					collect(file, false, calls);
+				}
+
+				if (now >= nextPollTime) {
+					pollHandles(calls);
+					nextPollTime = now + (uint64_t)(checkTimeInterval * 1000);
+				}
+
+				timeout = nextPollTime - now;
+				for (auto& entry : pending) {
+					timeout = std::min(timeout, entry.second > now ? entry.second - now : 0);
+				}
+			}
+
+			dispatch(calls);
+			if (running) {
+				wait(timeout);
+			}
+		}
+	}
+
+	void FileWatcher::wait(uint64_t millis) {
+#if __linux__
+		if (eventDescriptor != -1) {
+			pollfd descriptors[2];
+			descriptors[0] = { eventDescriptor, POLLIN, 0 };
+			descriptors[1] = { wakeDescriptors[0], POLLIN, 0 };
+			if (::poll(descriptors, 2, (int)std::min(millis, (uint64_t)INT32_MAX)) > 0) {
+				if (descriptors[1].revents) {
+					char buffer[64];
+					while (read(wakeDescriptors[0], buffer, sizeof(buffer)) > 0) {}
+				}
+				if (descriptors[0].revents) {
+					std::unique_lock<std::mutex> lock(mutex);
+					readEvents();
+				}
+			}
+			return;
+		}
+#endif
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.wait_for(lock, std::chrono::milliseconds(millis), [&]() {
+			return !running;
+		});
+	}
+
+	void FileWatcher::wake() {
+		condition.notify_all();
+#if __linux__
+		if (wakeDescriptors[1] != -1) {
+			char value = 1;
+			write(wakeDescriptors[1], &value, 1);
+		}
+#endif
+	}
+
+	void FileWatcher::setupHandle(Handle& handle) {
+		handle.polled = false;
+		bool watched = addWatch(handle, watchedDirectory(handle), handle.directory && handle.recursive);
+
+		if (!watched) {
+			removeWatches(handle);
+			handle.polled = true;
+			if (handle.directory) {
+				handle.timestamps.clear();
+				std::error_code error;
+				for (auto& entry : std::filesystem::recursive_directory_iterator(handle.file, std::filesystem::directory_options::skip_permission_denied, error)) {
+					if (!handle.recursive && entry.path().parent_path() != handle.file) {
+						continue;
+					}
+					if (entry.is_regular_file(error)) {
+						handle.timestamps[entry.path().string()] = getTimestamp(entry.path().string());
+					}
+				}
+			}
+		}
+	}
+
+	std::string FileWatcher::watchedDirectory(const Handle& handle) {
+		if (handle.directory) {
+			return handle.file;
+		}
+		//the parent is watched, so files replaced by a rename or created later are seen as well
+		return std::filesystem::path(handle.file).parent_path().string();
+	}
+
+	bool FileWatcher::addWatch(Handle& handle, const std::string& directory, bool recursive) {
+#if __linux__
+		if (eventDescriptor == -1) {
+			return false;
+		}
+		auto entry = watches.find(directory);
+		if (entry == watches.end()) {
+			uint32_t mask = IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+			int descriptor = inotify_add_watch(eventDescriptor, directory.c_str(), mask);
+			if (descriptor == -1) {
+				return false;
+			}
+			Watch watch;
+			watch.descriptor = descriptor;
+			entry = watches.insert({ directory, watch }).first;
+			watchDirectories[descriptor] = directory;
+		}
+		entry->second.refCount++;
+		handle.watches.push_back(directory);
+
+		if (recursive) {
+			std::error_code error;
+			for (auto& child : std::filesystem::directory_iterator(directory, std::filesystem::directory_options::skip_permission_denied, error)) {
+				if (child.is_directory(error) && !child.is_symlink(error)) {
+					if (!addWatch(handle, child.path().string(), true)) {
+						return false;
+					}
+				}
+			}
+		}
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	void FileWatcher::removeWatches(Handle& handle) {
+		for (auto& directory : handle.watches) {
+			auto entry = watches.find(directory);
+			if (entry == watches.end()) {
+				continue;
+			}
+			if (--entry->second.refCount <= 0) {
+#if __linux__
+				inotify_rm_watch(eventDescriptor, entry->second.descriptor);
+#endif
+				watchDirectories.erase(entry->second.descriptor);
+				watches.erase(entry);
+			}
+		}
+		handle.watches.clear();
+	}
+
+	void FileWatcher::readEvents() {
+#if __linux__
+		alignas(inotify_event) char buffer[16 * 1024];
+		while (true) {
+			ssize_t size = read(eventDescriptor, buffer, sizeof(buffer));
+			if (size <= 0) {
+				if (size < 0 && errno == EINTR) {
+					continue;
+				}
+				break;
+			}
+
+			for (char* ptr = buffer; ptr < buffer + size;) {
+				inotify_event* event = (inotify_event*)ptr;
+				ptr += sizeof(inotify_event) + event->len;
+
+				if (event->mask & IN_Q_OVERFLOW) {
+					//events were lost, every handle is checked again
+					for (auto& handle : handles) {
+						markPending(handle.file);
+					}
+					continue;
+				}
+				auto entry = watchDirectories.find(event->wd);
+				if (entry == watchDirectories.end()) {
+					continue;
+				}
+				if (event->mask & IN_IGNORED) {
+					//the directory was removed, the watch is gone and has to be added again if the directory is recreated
+					std::string directory = entry->second;
+					watchDirectories.erase(entry);
+					watches.erase(directory);
+					for (auto& handle : handles) {
+						auto watch = std::find(handle.watches.begin(), handle.watches.end(), directory);
+						if (watch == handle.watches.end()) {
+							continue;
+						}
+						handle.watches.erase(watch);
+						if (directory == watchedDirectory(handle)) {
+							//polled until the directory exists again, subdirectories are recreated by the parent events
+							removeWatches(handle);
+							handle.polled = true;
+							handle.timestamps.clear();
+						}
+					}
+					continue;
+				}
+				if (event->len == 0) {
+					continue;
+				}
+
+				std::string file = entry->second + "/" + event->name;
+				if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO))) {
+					for (auto& handle : handles) {
+						if (handle.directory && handle.recursive && !handle.polled && isInside(handle.file, file, true)) {
+							addWatch(handle, file, true);
+						}
+					}
+					//files can be created before the watch is added
+					std::error_code error;
+					for (auto& child : std::filesystem::recursive_directory_iterator(file, std::filesystem::directory_options::skip_permission_denied, error)) {
+						markPending(child.path().string());
+					}
+				}
+				markPending(file);
+			}
+		}
+#endif
+	}
+
+	void FileWatcher::markPending(const std::string& file) {
+		pending[file] = Clock::nowMilli() + (uint64_t)(coalesceTime * 1000);
+	}
+
+	void FileWatcher::collect(const std::string& file, bool polled, std::vector<std::function<void()>>& calls) {
+		for (int i = 0; i < handles.size(); i++) {
+			auto& handle = handles[i];
+			if (handle.polled != polled) {
+				continue;
+			}
+			if (handle.directory) {
+				if (handle.fileCallback && (handle.file == file || isInside(handle.file, file, handle.recursive))) {
+					calls.push_back([callback = handle.fileCallback, file]() {
+						callback(file);
+					});
+				}
+				continue;
+			}
+
+			if (handle.file != file) {
+				continue;
+			}
+			uint64_t timestamp = getTimestamp(handle.file);
+			if (timestamp != handle.timestamp && timestamp != 0) {
+				handle.timestamp = timestamp;
+				if (handle.callback) {
+					calls.push_back(handle.callback);
+				}
+				if (handle.onlyOneInvoke) {
+					removeWatches(handle);
+					handles.erase(handles.begin() + i);
+					i--;
+				}
+			}
+		}
+	}
+
+	void FileWatcher::pollHandles(std::vector<std::function<void()>>& calls) {
+		std::vector<std::string> changed;
+		for (auto& handle : handles) {
+			if (!handle.polled) {
+				continue;
+			}
+			if (!handle.directory) {
+				if (getTimestamp(handle.file) != handle.timestamp) {
+					changed.push_back(handle.file);
+				}
+				continue;
+			}
+
+			std::unordered_map<std::string, uint64_t> timestamps;
+			std::error_code error;
+			for (auto& entry : std::filesystem::recursive_directory_iterator(handle.file, std::filesystem::directory_options::skip_permission_denied, error)) {
+				if (!handle.recursive && entry.path().parent_path() != handle.file) {
+					continue;
+				}
+				if (entry.is_regular_file(error)) {
+					std::string file = entry.path().string();
+					uint64_t timestamp = getTimestamp(file);
+					timestamps[file] = timestamp;
+					auto previous = handle.timestamps.find(file);
+					if (previous == handle.timestamps.end() || previous->second != timestamp) {
+						changed.push_back(file);
+					}
+				}
+			}
+			for (auto& entry : handle.timestamps) {
+				if (timestamps.find(entry.first) == timestamps.end()) {
+					changed.push_back(entry.first);
+				}
+			}
+			handle.timestamps.swap(timestamps);
+		}
+
+		std::sort(changed.begin(), changed.end());
+		changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+		for (auto& file : changed) {
+			collect(file, true, calls);
+		}
+
+#if __linux__
+		//polled handles get their event watches back once the directory exists and can be watched
+		if (eventDescriptor != -1) {
+			for (auto& handle : handles) {
+				if (!handle.polled) {
+					continue;
+				}
+				std::error_code error;
+				if (!std::filesystem::is_directory(watchedDirectory(handle), error)) {
+					continue;
+				}
+				if (addWatch(handle, watchedDirectory(handle), handle.directory && handle.recursive)) {
+					handle.polled = false;
+					if (!handle.directory) {
+						//the file can change between the last poll and the new watch
+						markPending(handle.file);
+					}
+				}
+				else {
+					removeWatches(handle);
+				}
+			}
+		}
+#endif
+	}
+
+	void FileWatcher::dispatch(std::vector<std::function<void()>>& calls) {
+		if (calls.empty()) {
+			return;
+		}
+		TaskManager* taskManager = dispatchToTaskManager ? Singleton::get<TaskManager>() : nullptr;
+		for (auto& call : calls) {
+			if (taskManager && taskManager->getWorkerCount() > 0) {
+				taskManager->addTask(call, TaskType::NORMAL, "file watcher");
+			}
+			else {
+				call();
+			}
+		}
+	}
+
 }
@@ -8,32 +8,89 @@
 #include <thread>
 #include <vector>
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <string>
+#include <unordered_map>
 
 namespace baseline {
 
+	//uses inotify on linux and falls back to polling the timestamps when events are not available
 	class FileWatcher {
 	public:
+		//interval in seconds of the polling fallback
 		double checkTimeInterval = 2;
+		//a burst of writes results in one callback, after the file was quiet for this many seconds
+		double coalesceTime = 0.1;
+		//callbacks run on a TaskManager worker if there are workers, otherwise on the watcher thread
+		bool dispatchToTaskManager = true;
 
 		typedef std::function<void()> Callback;
+		//called with the absolute path of the changed, created or removed file
+		typedef std::function<void(const std::string& file)> FileCallback;
+
 		FileWatcher();
 		~FileWatcher();
 		void start();
 		void stop();
 		void addFile(const std::string& file, const Callback& callback, bool onlyOneInvoke = false);
 		void removeFile(const std::string& file);
+		void addDirectory(const std::string& directory, const FileCallback& callback, bool recursive = true);
+		void removeDirectory(const std::string& directory);
+		//false if all files are polled
+		bool isEventDriven();
+
 	private:
 		class Handle {
 		public:
 			std::string file = "";
 			Callback callback = nullptr;
+			FileCallback fileCallback = nullptr;
 			uint64_t timestamp = 0;
 			bool onlyOneInvoke = false;
+			bool directory = false;
+			bool recursive = false;
+			//no event watch could be added, checked by the polling loop
+			bool polled = false;
+			//directories that are watched for this handle
+			std::vector<std::string> watches;
+			//file timestamps of polled directories
+			std::unordered_map<std::string, uint64_t> timestamps;
 		};
+
+		class Watch {
+		public:
+			int descriptor = -1;
+			int refCount = 0;
+		};
+
 		std::vector<Handle> handles;
+		//changed paths and the time in milliseconds at which they are reported
+		std::unordered_map<std::string, uint64_t> pending;
+		std::unordered_map<std::string, Watch> watches;
+		std::unordered_map<int, std::string> watchDirectories;
 		std::thread* thread = nullptr;
 		std::mutex mutex;
-		bool running = false;
+		std::condition_variable condition;
+		std::atomic_bool running = false;
+		int eventDescriptor = -1;
+		int wakeDescriptors[2] = { -1, -1 };
+		uint64_t nextPollTime = 0;
+
+		void run();
+		void setupHandle(Handle& handle);
+		//the directory itself or the parent of a file
+		std::string watchedDirectory(const Handle& handle);
+		bool addWatch(Handle& handle, const std::string& directory, bool recursive);
+		void removeWatches(Handle& handle);
+		void readEvents();
+		void markPending(const std::string& file);
+		void pollHandles(std::vector<std::function<void()>>& calls);
+		//only handles that are polled or only handles that are event driven
+		void collect(const std::string& file, bool polled, std::vector<std::function<void()>>& calls);
+		void dispatch(std::vector<std::function<void()>>& calls);
+		void wait(uint64_t millis);
+		void wake();
 	};
 
 }
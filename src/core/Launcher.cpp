@@ -4,6 +4,8 @@
 
 #include "Launcher.h"
 #include "Config.h"
+#include "TaskManager.h"
+#include <algorithm>
 
 namespace baseline {
 
@@ -28,8 +30,17 @@ namespace baseline {
 			moduleManager->addModuleDirectory(std::filesystem::path(argv[0]).parent_path().string());
 		}
 
+		//workers for parallel module loading and for file watcher and config callbacks
+		auto* taskManager = Singleton::get<TaskManager>();
+		if (taskManager->getWorkerCount() == 0) {
+			taskManager->start(std::max(std::thread::hardware_concurrency(), 2u));
+		}
+
 		auto* config = Singleton::get<Config>();
+		moduleManager->beginDeferredLoading();
 		config->loadFirstFileFound({ configFile, std::string("../") + configFile , std::string("../../") + configFile, std::string("../../../") + configFile });
+		moduleManager->endDeferredLoading();
+		Log::info("%s", moduleManager->getStartupTimeline().c_str());
 	}
 
 	void Launcher::load(const std::string& name) {
@@ -72,6 +83,7 @@ namespace baseline {
 		for (int i = modules.size() - 1; i >= 0; i--) {
 			moduleManager->unloadModule(modules[i]);
 		}
+		Singleton::get<TaskManager>()->stop();
 	}
 
 }
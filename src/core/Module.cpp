@@ -3,6 +3,7 @@
 //
 
 #include "Module.h"
+#include "common/Log.h"
 
 #if WIN32
 #include <windows.h>
@@ -14,26 +15,81 @@ namespace baseline {
 
 	Module::Module() {
 		handle = nullptr;
+		tableVersion = 0;
 		name = "";
 		runtimeFile = "";
 	}
 
 	void Module::invoke(const std::string& function) {
-		auto entry = functions.find(function);
-		if (entry != functions.end()) {
-			if (entry->second) {
-				entry->second();
+		std::shared_ptr<ModuleFunctionSlot> slot = getSlot(function);
+		if (Func ptr = slot->function.load(std::memory_order_acquire)) {
+			ptr();
+		}
+	}
+
+	uint32_t Module::getTableVersion() {
+		return tableVersion;
+	}
+
+	std::shared_ptr<ModuleFunctionSlot> Module::getSlot(const std::string& function) {
+		{
+			std::shared_lock<std::shared_mutex> lock(mutex);
+			auto entry = functions.find(function);
+			if (entry != functions.end()) {
+				return entry->second;
 			}
+		}
+
+		//missing symbols are cached as well, so they are only looked up once
+		std::unique_lock<std::shared_mutex> lock(mutex);
+		std::shared_ptr<ModuleFunctionSlot>& slot = functions[function];
+		if (!slot) {
+			slot = std::make_shared<ModuleFunctionSlot>();
+			slot->function.store(findSymbol(function), std::memory_order_release);
+		}
+		return slot;
+	}
+
+	Module::Func Module::findSymbol(const std::string& function) {
+		if (!handle) {
+			return nullptr;
+		}
+#if WIN32
+		return (Func)GetProcAddress((HMODULE)handle, function.c_str());
+#else
+		return (Func)dlsym(handle, function.c_str());
+#endif
+	}
+
+	void Module::resolveFunctions() {
+		typedef const ModuleFunctionTable* (*TableFunc)();
+		TableFunc tableFunc = (TableFunc)findSymbol("baselineModuleFunctions");
+		if (!tableFunc) {
 			return;
 		}
 
-		if (handle) {
-			Func ptr = (Func)GetProcAddress((HMODULE)handle, function.c_str());
-			functions[function] = ptr;
-			if (ptr) {
-				ptr();
-			}
+		const ModuleFunctionTable* table = tableFunc();
+		if (!table || table->version != ModuleFunctionTable::currentVersion) {
+			Log::warning("module %s: function table version %d is not supported", name.c_str(), table ? (int)table->version : 0);
+			return;
+		}
+
+		std::unique_lock<std::shared_mutex> lock(mutex);
+		tableVersion = table->version;
+		for (uint32_t i = 0; i < table->count; i++) {
+			auto slot = std::make_shared<ModuleFunctionSlot>();
+			slot->function.store(table->entries[i].function, std::memory_order_release);
+			functions[table->entries[i].name] = slot;
+		}
+	}
+
+	void Module::invalidateFunctions() {
+		std::unique_lock<std::shared_mutex> lock(mutex);
+		for (auto& entry : functions) {
+			entry.second->function.store(nullptr, std::memory_order_release);
 		}
+		functions.clear();
+		tableVersion = 0;
 	}
 
 }
@@ -5,24 +5,115 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <unordered_map>
+#include <memory>
+#include <atomic>
+#include <shared_mutex>
+#include <mutex>
+#include <cstdint>
+#include <utility>
+#include <functional>
 
 namespace baseline {
 
+	//entry points a module exports with BL_MODULE_FUNCTIONS, read once when the module is opened
+	class ModuleFunctionTable {
+	public:
+		static constexpr uint32_t currentVersion = 1;
+
+		class Entry {
+		public:
+			const char* name;
+			void (*function)();
+		};
+
+		uint32_t version;
+		uint32_t count;
+		const Entry* entries;
+	};
+
+	//shared between a module and its function handles, cleared when the module is unloaded
+	class ModuleFunctionSlot {
+	public:
+		std::atomic<void(*)()> function = nullptr;
+	};
+
+	//typed entry point of a module, calling it is a single indirect call
+	//the handle becomes invalid when the module is unloaded or hot reloaded, calling an invalid handle does nothing
+	template<typename Signature>
+	class ModuleFunction;
+
+	template<typename R, typename... Args>
+	class ModuleFunction<R(Args...)> {
+	public:
+		ModuleFunction(const std::shared_ptr<ModuleFunctionSlot>& slot = nullptr) : slot(slot) {}
+
+		bool isValid() const {
+			return slot && slot->function.load(std::memory_order_acquire) != nullptr;
+		}
+
+		R operator()(Args... args) const {
+			void (*function)() = slot ? slot->function.load(std::memory_order_acquire) : nullptr;
+			if (!function) {
+				return R();
+			}
+			return ((R(*)(Args...))function)(std::forward<Args>(args)...);
+		}
+
+	private:
+		std::shared_ptr<ModuleFunctionSlot> slot;
+	};
+
 	class Module {
 	public:
 		std::string name;
 		std::string file;
 		std::string runtimeFile;
+		//names of the modules that have to be loaded before, from the manifest
+		std::vector<std::string> dependencies;
+
+		//startup timeline in seconds since the ModuleManager was created
+		double openBegin = 0;
+		double openEnd = 0;
+		double loadBegin = 0;
+		double loadEnd = 0;
 
 		Module();
 		void invoke(const std::string& function);
 
+		//functions that are not in the export table are looked up by symbol name once
+		template<typename Signature>
+		ModuleFunction<Signature> getFunction(const std::string& function) {
+			return ModuleFunction<Signature>(getSlot(function));
+		}
+		//version of the export table, 0 if the module has none
+		uint32_t getTableVersion();
+
 	private:
 		friend class ModuleManager;
 		typedef void (*Func)();
 		void* handle;
-		std::unordered_map<std::string, Func> functions;
+		uint32_t tableVersion;
+		std::unordered_map<std::string, std::shared_ptr<ModuleFunctionSlot>> functions;
+		std::shared_mutex mutex;
+		//ON_MODULE_LOAD callbacks from the static initializers, invoked before load
+		std::vector<std::function<void()>> loadCallbacks;
+
+		std::shared_ptr<ModuleFunctionSlot> getSlot(const std::string& function);
+		Func findSymbol(const std::string& function);
+		void resolveFunctions();
+		void invalidateFunctions();
 	};
 
 }
+
+#define BL_MODULE_FUNCTION(func) baseline::ModuleFunctionTable::Entry{ #func, (void(*)())&func }
+
+//exports the table of entry points, for example BL_MODULE_FUNCTIONS(BL_MODULE_FUNCTION(load), BL_MODULE_FUNCTION(update))
+#define BL_MODULE_FUNCTIONS(...) \
+	extern "C" const baseline::ModuleFunctionTable* baselineModuleFunctions() { \
+		static const baseline::ModuleFunctionTable::Entry entries[] = { __VA_ARGS__ }; \
+		static const baseline::ModuleFunctionTable table = { baseline::ModuleFunctionTable::currentVersion, sizeof(entries) / sizeof(entries[0]), entries }; \
+		return &table; \
+	}
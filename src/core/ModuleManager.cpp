@@ -7,7 +7,13 @@
 #include "Singleton.h"
 #include "FileWatcher.h"
 #include "Config.h"
+#include "TaskManager.h"
+#include "common/File.h"
+#include "common/strutil.h"
 #include <filesystem>
+#include <algorithm>
+#include <thread>
+#include <cstring>
 
 #if WIN32
 #include <windows.h>
@@ -25,14 +31,45 @@
 
 namespace baseline {
 
+	thread_local Module* ModuleManager::openingModule = nullptr;
+
+	//true if the address is code or data of the library
+	static bool isLibraryAddress(void* library, const void* address) {
+#ifdef WIN32
+		HMODULE handle = nullptr;
+		GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, (LPCSTR)address, &handle);
+		return handle != nullptr && handle == (HMODULE)library;
+#else
+		Dl_info info;
+		if (!dladdr(address, &info) || !info.dli_fname) {
+			return false;
+		}
+		//only returns the handle of an already loaded library, the reference is given back right away
+		void* handle = dlopen(info.dli_fname, RTLD_LAZY | RTLD_NOLOAD);
+		if (handle) {
+			dlclose(handle);
+		}
+		return handle != nullptr && handle == library;
+#endif
+	}
+
 	ModuleManager::ModuleManager() {
 		auto* config = Singleton::get<Config>();
 		config->addVar("enableHotReloading", &enableHotReloading);
+		config->addVar("enableLazyBinding", &enableLazyBinding);
 		config->addCommand("loadModule", [&](const std::vector<std::string>& args) {
 			if (args.size() > 0) {
-				loadModule(args[0]);
+				if (deferLoading) {
+					deferredModules.push_back(args[0]);
+				}
+				else {
+					loadModule(args[0]);
+				}
 			}
 		});
+		config->addCommand("startupTimeline", [&](const std::vector<std::string>&) {
+			Log::info("%s", getStartupTimeline().c_str());
+		});
 		config->addCommand("unloadModule", [&](const std::vector<std::string>& args) {
 			if (args.size() > 0) {
 				unloadModule(args[0]);
@@ -53,9 +90,140 @@ namespace baseline {
 			}
 		}
 		moduleDirectories.push_back(absolut);
+		moduleFilesValid = false;
 	}
 
 	Module* ModuleManager::loadModule(const std::string& name) {
+		std::vector<Module*> list = loadModules({ name });
+		return list.size() > 0 ? list[0] : nullptr;
+	}
+
+	std::vector<Module*> ModuleManager::loadModules(const std::vector<std::string>& names) {
+		//collect the requested modules and their dependencies that are not loaded yet
+		std::vector<std::shared_ptr<Module>> newModules;
+		std::unordered_map<std::string, Module*> byName;
+		std::vector<std::string> queue = names;
+		for (int i = 0; i < queue.size(); i++) {
+			std::string name = queue[i];
+			if (byName.find(name) != byName.end()) {
+				continue;
+			}
+
+			std::string file = findModuleFile(name);
+			if (file == "") {
+				Log::warning("module %s: file not found", name.c_str());
+				byName[name] = nullptr;
+				continue;
+			}
+
+			Module* loaded = nullptr;
+			for (auto& module : modules) {
+				if (module->file == file) {
+					loaded = module.get();
+					break;
+				}
+			}
+			if (loaded) {
+				if (i < names.size()) {
+					Log::warning("module %s: already loaded", name.c_str());
+				}
+				byName[name] = loaded;
+				continue;
+			}
+
+			auto module = std::make_shared<Module>();
+			module->name = name;
+			module->file = file;
+			module->runtimeFile = file;
+			readManifest(module.get());
+			for (auto& dependency : module->dependencies) {
+				queue.push_back(dependency);
+			}
+			byName[name] = module.get();
+			newModules.push_back(module);
+		}
+
+		//opening is independent for each module, static initializers run here as well
+		auto* taskManager = Singleton::get<TaskManager>();
+		if (newModules.size() > 1 && taskManager->getWorkerCount() > 0) {
+			std::vector<int> tasks;
+			for (auto& module : newModules) {
+				tasks.push_back(taskManager->addTask([this, module = module.get()]() {
+					openModule(module);
+				}, TaskType::NORMAL, "open module " + module->name));
+			}
+			for (int task : tasks) {
+				taskManager->joinTask(task);
+			}
+		}
+		else {
+			for (auto& module : newModules) {
+				openModule(module.get());
+			}
+		}
+
+		//depth first, so dependencies are loaded before the modules that need them
+		std::vector<std::shared_ptr<Module>> order;
+		std::unordered_map<Module*, int> visitState;
+		std::function<void(const std::shared_ptr<Module>&)> visit = [&](const std::shared_ptr<Module>& module) {
+			int& state = visitState[module.get()];
+			if (state == 2) {
+				return;
+			}
+			if (state == 1) {
+				Log::warning("module %s: cyclic dependency", module->name.c_str());
+				return;
+			}
+			state = 1;
+			for (auto& dependency : module->dependencies) {
+				for (auto& other : newModules) {
+					if (other->name == dependency) {
+						visit(other);
+						break;
+					}
+				}
+			}
+			visitState[module.get()] = 2;
+			order.push_back(module);
+		};
+		for (auto& module : newModules) {
+			visit(module);
+		}
+
+		for (auto& module : order) {
+			for (auto& dependency : module->dependencies) {
+				if (byName[dependency] == nullptr) {
+					Log::warning("module %s: dependency %s not found", module->name.c_str(), dependency.c_str());
+				}
+			}
+
+			if (enableHotReloading) {
+				Singleton::get<FileWatcher>()->addFile(module->file, [&, name = module->name, file = module->file]() {
+					waitForFile(file);
+					reloadModule(name);
+				});
+			}
+
+			modules.push_back(module);
+			module->loadBegin = clock.elapsed();
+			loadingModule = module.get();
+			for (auto& callback : module->loadCallbacks) {
+				callback();
+			}
+			module->loadCallbacks.clear();
+			module->invoke("load");
+			loadingModule = nullptr;
+			module->loadEnd = clock.elapsed();
+		}
+
+		std::vector<Module*> list;
+		for (auto& name : names) {
+			list.push_back(byName[name]);
+		}
+		return list;
+	}
+
+	std::string ModuleManager::findModuleFile(const std::string& name) {
 		std::string baseFile = name;
 		std::string extension = std::filesystem::path(name).extension().string();
 
@@ -63,43 +231,80 @@ namespace baseline {
 			baseFile += MODULE_FILE_EXTENSION;
 		}
 
-		std::string file = "";
-		for (auto& directory : moduleDirectories) {
-			file = directory + FILE_PATH_SEPERATOR + baseFile;
-			if (std::filesystem::exists(file)) {
-				break;
+		//the directories are listed once, they are only listed again if a module is not found
+		for (int i = 0; i < 2; i++) {
+			if (!moduleFilesValid) {
+				moduleFiles.clear();
+				for (auto& directory : moduleDirectories) {
+					std::error_code error;
+					for (auto& entry : std::filesystem::directory_iterator(directory, error)) {
+						std::string filename = entry.path().filename().string();
+						if (moduleFiles.find(filename) == moduleFiles.end()) {
+							moduleFiles[filename] = directory + FILE_PATH_SEPERATOR + filename;
+						}
+					}
+				}
+				moduleFilesValid = true;
 			}
-			file = "";
-		}
 
-		if (file == "") {
-			Log::warning("module %s: file not found", name.c_str());
-			return nullptr;
+			auto entry = moduleFiles.find(baseFile);
+			if (entry != moduleFiles.end()) {
+				return entry->second;
+			}
+			if (baseFile.find_first_of("/\\") != std::string::npos) {
+				for (auto& directory : moduleDirectories) {
+					std::string file = directory + FILE_PATH_SEPERATOR + baseFile;
+					if (std::filesystem::exists(file)) {
+						return file;
+					}
+				}
+			}
+			moduleFilesValid = false;
 		}
+		return "";
+	}
 
-		for (auto& module : modules) {
-			if (module->file == file) {
-				Log::warning("module %s: already loaded", name.c_str());
-				return module.get();
+	void ModuleManager::readManifest(Module* module) {
+		std::filesystem::path file = std::filesystem::path(module->file).replace_extension(".module");
+		if (moduleFiles.find(file.filename().string()) == moduleFiles.end()) {
+			return;
+		}
+		FileView view;
+		if (!view.open(file.string())) {
+			return;
+		}
+		for (std::string_view line : splitView(view.view(), "\n")) {
+			size_t comment = line.find('#');
+			if (comment != std::string_view::npos) {
+				line = line.substr(0, comment);
+			}
+			if (!line.empty() && line.back() == '\r') {
+				line.remove_suffix(1);
+			}
+			std::vector<std::string> parts = split(std::string(line), " ");
+			if (parts.size() > 0 && parts[0] == "depends") {
+				for (int i = 1; i < parts.size(); i++) {
+					if (parts[i] != "=") {
+						module->dependencies.push_back(parts[i]);
+					}
+				}
 			}
 		}
+	}
 
-		auto module = std::make_shared<Module>();
-		module->name = name;
-		module->file = file;
-		module->runtimeFile = file;
+	void ModuleManager::openModule(Module* module) {
+		module->openBegin = clock.elapsed();
 
 #if WIN32
 		if (enableHotReloading) {
 			for (int i = 0; i < 10; i++) {
-				std::filesystem::path path(file);
+				std::filesystem::path path(module->file);
 				path = path.parent_path() / "runtime_files" / std::to_string(i) / path.filename();
 
-				if (!std::filesystem::exists(path.parent_path())) {
-					std::filesystem::create_directories(path.parent_path());
-				}
+				//modules are opened in parallel, so the directory can be created by another thread in between
 				try {
-					std::filesystem::copy(file, path, std::filesystem::copy_options::overwrite_existing);
+					std::filesystem::create_directories(path.parent_path());
+					std::filesystem::copy(module->file, path, std::filesystem::copy_options::overwrite_existing);
 					module->runtimeFile = path.string();
 					break;
 				}
@@ -107,34 +312,46 @@ namespace baseline {
 			}
 		}
 
+		openingModule = module;
 		module->handle = (void*)LoadLibrary(module->runtimeFile.c_str());
+		openingModule = nullptr;
 #else
-		module->handle = dlopen(runtimePath.c_str(), RTLD_NOW | RTLD_LOCAL);
+		if (enableHotReloading) {
+			//libraries with unique symbols stay mapped after dlclose, opening the same path again would return the old code
+			//every load gets its own copy, the file is removed first, because a mapped file must not be overwritten
+			std::filesystem::path path(module->file);
+			path = path.parent_path() / "runtime_files" / (path.stem().string() + "_" + std::to_string(runtimeFileCounter++) + path.extension().string());
+			try {
+				std::filesystem::create_directories(path.parent_path());
+				std::filesystem::remove(path);
+				std::filesystem::copy_file(module->file, path);
+				module->runtimeFile = path.string();
+			}
+			catch (...) {}
+		}
+		openingModule = module;
+		module->handle = dlopen(module->runtimeFile.c_str(), (enableLazyBinding ? RTLD_LAZY : RTLD_NOW) | RTLD_LOCAL);
+		openingModule = nullptr;
 #endif
 
+		module->openEnd = clock.elapsed();
 		if (!module->handle) {
+			module->loadCallbacks.clear();
 			Log::error("module %s could not be loaded", module->name.c_str());
 		}
-
-		if (enableHotReloading) {
-			Singleton::get<FileWatcher>()->addFile(module->file, [&, name = module->name]() {
-				bool tmp = enableHotReloading;
-				enableHotReloading = false;
-				unloadModule(name);
-				enableHotReloading = tmp;
-				loadModule(name);
-			});
-		}
-
-		if (module->handle) {
-			Log::info("module %s loaded, file: %s", name.c_str(), file.c_str());
+		else {
+			module->resolveFunctions();
+			Log::info("module %s loaded, file: %s", module->name.c_str(), module->file.c_str());
 		}
+	}
 
-		modules.push_back(module);
-		if (module) {
-			module->invoke("load");
+	bool ModuleManager::deferLoadCallback(const std::function<void()>& callback) {
+		//static initializers of modules opened in parallel must not run into each other
+		if (!openingModule) {
+			return false;
 		}
-		return module.get();
+		openingModule->loadCallbacks.push_back(callback);
+		return true;
 	}
 
 	Module* ModuleManager::getModule(const std::string& name) {
@@ -150,12 +367,32 @@ namespace baseline {
 		if (module) {
 			module->invoke("unload");
 		}
+		{
+			//the state is part of the library and gone after it is closed
+			std::unique_lock<std::mutex> lock(stateMutex);
+			for (int i = 0; i < states.size(); i++) {
+				if (states[i].moduleName == module->name) {
+					states.erase(states.begin() + i);
+					i--;
+				}
+			}
+		}
+		//handles to functions of the module must not be called after this
+		module->invalidateFunctions();
+		//singletons whose destructor is only in this library are destroyed while it is still loaded
+		Singleton::clearModule([library = module->handle](const void* address) {
+			return isLibraryAddress(library, address);
+		});
+		//pending async log records may point to format strings of the module
+		Log::flush();
 #ifdef WIN32
 		FreeLibrary((HINSTANCE)module->handle);
 #else      
 		dlclose(module->handle);
 #endif
 		module->handle = nullptr;
+		//the addresses of its format strings can be used by the next library
+		Log::forgetFormats();
 		Log::info("module %s unloaded", module->name.c_str());
 
 		if (enableHotReloading) {
@@ -201,4 +438,276 @@ namespace baseline {
 		return list;
 	}
 
+	void ModuleManager::beginDeferredLoading() {
+		deferLoading = true;
+	}
+
+	std::vector<Module*> ModuleManager::endDeferredLoading() {
+		deferLoading = false;
+		std::vector<std::string> names;
+		names.swap(deferredModules);
+		return loadModules(names);
+	}
+
+	std::string ModuleManager::getStartupTimeline() {
+		std::string timeline = "module startup timeline (ms):";
+		for (auto& module : modules) {
+			char line[256];
+			snprintf(line, sizeof(line), "\n  %-24s open %8.2f - %8.2f (%7.2f)  load %8.2f - %8.2f (%7.2f)",
+				module->name.c_str(),
+				module->openBegin * 1000, module->openEnd * 1000, (module->openEnd - module->openBegin) * 1000,
+				module->loadBegin * 1000, module->loadEnd * 1000, (module->loadEnd - module->loadBegin) * 1000);
+			timeline += line;
+		}
+		return timeline;
+	}
+
+	Module* ModuleManager::reloadModule(const std::string& name) {
+		Module* module = getModule(name);
+		if (!module) {
+			return loadModule(name);
+		}
+
+		Clock reloadClock;
+		saveStates(module);
+		//the file watch is kept, loading the module again only replaces its callback
+		bool tmp = enableHotReloading;
+		enableHotReloading = false;
+		reloading = true;
+		unloadModule(module);
+		enableHotReloading = tmp;
+		module = loadModule(name);
+		reloading = false;
+
+		{
+			std::unique_lock<std::mutex> lock(stateMutex);
+			for (auto& saved : savedStates) {
+				if (saved.moduleName == name) {
+					Log::warning("module %s: state %s was not registered again", name.c_str(), saved.name.c_str());
+				}
+			}
+			savedStates.erase(std::remove_if(savedStates.begin(), savedStates.end(), [&](const SavedState& saved) {
+				return saved.moduleName == name;
+			}), savedStates.end());
+		}
+
+		Log::info("module %s reloaded in %.2f ms", name.c_str(), reloadClock.elapsed() * 1000);
+		return module;
+	}
+
+	bool ModuleManager::isReloading() {
+		return reloading;
+	}
+
+	bool ModuleManager::addState(const std::string& name, const TypeDescriptor* type, void* data) {
+		std::unique_lock<std::mutex> lock(stateMutex);
+		State state;
+		state.name = name;
+		state.moduleName = loadingModule ? loadingModule->name : "";
+		state.type = type;
+		state.data = data;
+		states.push_back(state);
+
+		for (int i = 0; i < savedStates.size(); i++) {
+			if (savedStates[i].name == name && savedStates[i].moduleName == state.moduleName) {
+				restoreState(savedStates[i], state);
+				savedStates.erase(savedStates.begin() + i);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void ModuleManager::removeState(const std::string& name) {
+		std::unique_lock<std::mutex> lock(stateMutex);
+		for (int i = 0; i < states.size(); i++) {
+			if (states[i].name == name) {
+				states.erase(states.begin() + i);
+				return;
+			}
+		}
+	}
+
+	//leaf members of a type, a type without members is its own leaf with an empty name and no member type
+	static std::vector<MemberDescriptor> leafMembers(const TypeDescriptor* type) {
+		if (!type->members.empty()) {
+			return flatMemberList(type);
+		}
+		MemberDescriptor member;
+		member.name = "";
+		member.offset = 0;
+		return { member };
+	}
+
+	//copies a saved leaf value, primitives of another type are converted, returns false if the types do not fit
+	static bool restoreValue(const TypeDescriptor* type, void* ptr, const std::string& typeName, const char* bytes, int size) {
+		if (typeName == type->name) {
+			if (type->isType<std::string>()) {
+				((std::string*)ptr)->assign(bytes, size);
+				return true;
+			}
+			if (size != type->size) {
+				return false;
+			}
+			memcpy(ptr, bytes, size);
+			return true;
+		}
+
+		//primitives are converted, for example when a member changed from int to float
+		const TypeDescriptor* sourceType = Reflection::getType(typeName);
+		bool primitive = (int)type->flags & (int)TypeDescriptor::Flags::PRIMITIVE;
+		if (primitive && sourceType && ((int)sourceType->flags & (int)TypeDescriptor::Flags::PRIMITIVE) && size == sourceType->size && size <= sizeof(uint64_t)) {
+			uint64_t value = 0;
+			memcpy(&value, bytes, size);
+			fromString(type, ptr, toString(sourceType, &value));
+			return true;
+		}
+		return false;
+	}
+
+	void ModuleManager::saveStates(Module* module) {
+		std::unique_lock<std::mutex> lock(stateMutex);
+		for (auto& state : states) {
+			if (state.moduleName != module->name) {
+				continue;
+			}
+
+			SavedState saved;
+			saved.name = state.name;
+			saved.moduleName = state.moduleName;
+
+			for (auto& member : leafMembers(state.type)) {
+				const TypeDescriptor* type = member.type ? member.type.get() : state.type;
+				uint8_t* ptr = (uint8_t*)state.data + member.offset;
+
+				SavedMember savedMember;
+				savedMember.name = member.name;
+				savedMember.typeName = type->name;
+				if (type->isType<std::string>()) {
+					savedMember.bytes = *(std::string*)ptr;
+				}
+				else if ((int)type->flags & (int)TypeDescriptor::Flags::VECTOR) {
+					//elements are copied as bytes, so only vectors of plain data are kept
+					const TypeDescriptor* elementType = type->valueType.get();
+					if (!((int)elementType->flags & (int)TypeDescriptor::Flags::DATA)) {
+						Log::warning("module %s: member %s of state %s can not be preserved", module->name.c_str(), member.name.c_str(), state.name.c_str());
+						continue;
+					}
+					savedMember.isVector = true;
+					savedMember.size = elementType->size;
+					savedMember.count = type->vectorOps->size(ptr);
+					if (savedMember.count > 0) {
+						savedMember.bytes.assign((const char*)type->vectorOps->get(ptr, 0), savedMember.count * elementType->size);
+					}
+					for (auto& elementMember : leafMembers(elementType)) {
+						const TypeDescriptor* leafType = elementMember.type ? elementMember.type.get() : elementType;
+						SavedMember leaf;
+						leaf.name = elementMember.name;
+						leaf.typeName = leafType->name;
+						leaf.offset = elementMember.offset;
+						leaf.size = leafType->size;
+						savedMember.elementMembers.push_back(leaf);
+					}
+				}
+				else if ((int)type->flags & (int)TypeDescriptor::Flags::DATA) {
+					savedMember.bytes.assign((const char*)ptr, type->size);
+				}
+				else {
+					Log::warning("module %s: member %s of state %s can not be preserved", module->name.c_str(), member.name.c_str(), state.name.c_str());
+					continue;
+				}
+				saved.members.push_back(savedMember);
+			}
+			savedStates.push_back(saved);
+		}
+	}
+
+	void ModuleManager::restoreState(const SavedState& saved, const State& state) {
+		for (auto& member : leafMembers(state.type)) {
+			const TypeDescriptor* type = member.type ? member.type.get() : state.type;
+			uint8_t* ptr = (uint8_t*)state.data + member.offset;
+
+			const SavedMember* source = nullptr;
+			for (auto& savedMember : saved.members) {
+				if (savedMember.name == member.name) {
+					source = &savedMember;
+					break;
+				}
+			}
+			if (!source) {
+				continue;
+			}
+
+			if (source->isVector != (((int)type->flags & (int)TypeDescriptor::Flags::VECTOR) != 0)) {
+				Log::warning("state %s: type of member %s changed from %s to %s", saved.name.c_str(), member.name.c_str(), source->typeName.c_str(), type->name.c_str());
+				continue;
+			}
+			if (!source->isVector) {
+				if (!restoreValue(type, ptr, source->typeName, source->bytes.data(), (int)source->bytes.size())) {
+					Log::warning("state %s: type of member %s changed from %s to %s", saved.name.c_str(), member.name.c_str(), source->typeName.c_str(), type->name.c_str());
+				}
+				continue;
+			}
+
+			const TypeDescriptor* elementType = type->valueType.get();
+			std::vector<MemberDescriptor> elementMembers = leafMembers(elementType);
+			bool sameLayout = source->size == elementType->size && source->elementMembers.size() == elementMembers.size();
+			for (int i = 0; sameLayout && i < elementMembers.size(); i++) {
+				const TypeDescriptor* leafType = elementMembers[i].type ? elementMembers[i].type.get() : elementType;
+				const SavedMember& leaf = source->elementMembers[i];
+				sameLayout = leaf.name == elementMembers[i].name && leaf.typeName == leafType->name && leaf.offset == elementMembers[i].offset && leaf.size == leafType->size;
+			}
+			if (sameLayout && !((int)elementType->flags & (int)TypeDescriptor::Flags::DATA)) {
+				sameLayout = false;
+			}
+
+			type->vectorOps->resize(ptr, source->count);
+			if (sameLayout) {
+				if (source->count > 0) {
+					memcpy(type->vectorOps->get(ptr, 0), source->bytes.data(), source->bytes.size());
+				}
+				continue;
+			}
+
+			//the element type changed, every element is restored by member name like the state itself
+			for (auto& elementMember : elementMembers) {
+				const TypeDescriptor* leafType = elementMember.type ? elementMember.type.get() : elementType;
+				const SavedMember* leaf = nullptr;
+				for (auto& savedLeaf : source->elementMembers) {
+					if (savedLeaf.name == elementMember.name) {
+						leaf = &savedLeaf;
+						break;
+					}
+				}
+				if (!leaf) {
+					continue;
+				}
+				for (int i = 0; i < source->count; i++) {
+					uint8_t* element = (uint8_t*)type->vectorOps->get(ptr, i);
+					const char* bytes = source->bytes.data() + (size_t)i * source->size + leaf->offset;
+					if (!restoreValue(leafType, element + elementMember.offset, leaf->typeName, bytes, leaf->size)) {
+						std::string name = elementMember.name.empty() ? member.name : member.name + "." + elementMember.name;
+						Log::warning("state %s: type of member %s changed from %s to %s", saved.name.c_str(), name.c_str(), leaf->typeName.c_str(), leafType->name.c_str());
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	void ModuleManager::waitForFile(const std::string& file) {
+		//the compiler or linker can still be writing the library, it is only loaded when the size stays the same
+		uintmax_t previousSize = (uintmax_t)-1;
+		for (int i = 0; i < 40; i++) {
+			std::error_code error;
+			uintmax_t size = std::filesystem::file_size(file, error);
+			if (!error && size > 0 && size == previousSize) {
+				return;
+			}
+			previousSize = error ? (uintmax_t)-1 : size;
+			std::this_thread::sleep_for(std::chrono::milliseconds((uint64_t)(hotReloadDebounce * 1000)));
+		}
+		Log::warning("module file %s did not stop changing", file.c_str());
+	}
+
 }
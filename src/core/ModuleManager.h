@@ -6,28 +6,116 @@
 
 #include "Module.h"
 #include "Singleton.h"
+#include "Reflection.h"
+#include "common/Clock.h"
 #include <vector>
 #include <memory>
 #include <functional>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
 
 namespace baseline {
 
+	//a module can have a manifest next to its library with the same name and the extension .module
+	//each line "depends = name1 name2" adds dependencies, they are loaded first
 	class ModuleManager {
 	public:
 		bool enableHotReloading = false;
+		//symbols are resolved on first use instead of when the library is opened (RTLD_LAZY), no effect on windows
+		bool enableLazyBinding = false;
+		//a changed module file has to keep its size for this many seconds before it is reloaded
+		double hotReloadDebounce = 0.25;
 
 		ModuleManager();
 		void addModuleDirectory(const std::string &directory);
 		Module *loadModule(const std::string &name);
+		//the libraries are opened in parallel on the TaskManager, load is invoked in dependency order on the calling thread
+		//ON_MODULE_LOAD callbacks are deferred while opening and invoked right before load, so they also run in order
+		std::vector<Module*> loadModules(const std::vector<std::string>& names);
 		Module* getModule(const std::string& name);
 		void unloadModule(Module* module);
 		void unloadModule(const std::string& name);
+		//the registered states of the module are carried over to the new instance
+		Module* reloadModule(const std::string& name);
+		//true while a module is unloaded and loaded again, unload can keep resources that are referenced by its state
+		bool isReloading();
 		std::vector<Module*> getLoadedModules();
 		std::vector<std::string> getInstalledModules();
 
+		//the loadModule command only collects the names until endDeferredLoading loads them together
+		void beginDeferredLoading();
+		std::vector<Module*> endDeferredLoading();
+		//open and load time of every module, relative to the creation of the manager
+		std::string getStartupTimeline();
+
+		//registers reflected state of the module that is currently loaded, has to be called in load
+		//on a hot reload the state is saved before unload and copied into the new instance by member name and type
+		//returns true if the state was restored, so the module can skip its initialization
+		template<typename T>
+		bool addState(const std::string& name, T* data) {
+			return addState(name, Reflection::getType<T>(), data);
+		}
+		bool addState(const std::string& name, const TypeDescriptor* type, void* data);
+		void removeState(const std::string& name);
+
+		//keeps the callback if the current thread is opening a module, returns false if the callback has to be invoked directly
+		static bool deferLoadCallback(const std::function<void()>& callback);
+
 	private:
+		class State {
+		public:
+			std::string name;
+			std::string moduleName;
+			const TypeDescriptor* type = nullptr;
+			void* data = nullptr;
+		};
+
+		//copy of a leaf member that does not depend on the code of the unloaded module
+		class SavedMember {
+		public:
+			std::string name;
+			std::string typeName;
+			bool isVector = false;
+			int count = 0;
+			std::string bytes;
+			//size of a vector element or of a member of an element
+			int size = 0;
+			//offset of a member inside a vector element
+			int offset = 0;
+			//flattened members of the vector elements, used to restore the elements by member name if the element type changed
+			std::vector<SavedMember> elementMembers;
+		};
+
+		class SavedState {
+		public:
+			std::string name;
+			std::string moduleName;
+			std::vector<SavedMember> members;
+		};
+
 		std::vector<std::string> moduleDirectories;
 		std::vector<std::shared_ptr<Module>> modules;
+		//module file name to path, so directories are not probed for every module
+		std::unordered_map<std::string, std::string> moduleFiles;
+		bool moduleFilesValid = false;
+		bool deferLoading = false;
+		std::vector<std::string> deferredModules;
+		Clock clock;
+		std::vector<State> states;
+		std::vector<SavedState> savedStates;
+		std::mutex stateMutex;
+		Module* loadingModule = nullptr;
+		bool reloading = false;
+		std::atomic<int> runtimeFileCounter = 0;
+		static thread_local Module* openingModule;
+
+		std::string findModuleFile(const std::string& name);
+		void saveStates(Module* module);
+		static void restoreState(const SavedState& saved, const State& state);
+		void waitForFile(const std::string& file);
+		void readManifest(Module* module);
+		void openModule(Module* module);
 	};
 
 	class OnModuleLoadCallback {
@@ -38,7 +126,7 @@ namespace baseline {
 		OnModuleLoadCallback(const std::function<void()> &onLoad, const std::function<void()> &onUnload) {
 			this->onLoad = onLoad;
 			this->onUnload = onUnload;
-			if (onLoad) {
+			if (onLoad && !ModuleManager::deferLoadCallback(onLoad)) {
 				onLoad();
 			}
 		}
@@ -17,6 +17,11 @@ namespace baseline {
 		return typesByName;
 	}
 
+	std::recursive_mutex& Reflection::getMutexImpl() {
+		static std::recursive_mutex mutex;
+		return mutex;
+	}
+
 	void Reflection::initTypeImpl(std::shared_ptr<TypeDescriptor> type) {
 		bool isPrimitive = false;
 		if (type->hash == (int)typeid(float).hash_code()) {
@@ -103,33 +108,55 @@ namespace baseline {
 		}
 	}
 
+	template<typename T>
+	static bool appendPrimitive(const TypeDescriptor* desc, void* value, std::string& out) {
+		if (desc->isType<T>()) {
+			appendString(out, *(T*)value);
+			return true;
+		}
+		return false;
+	}
+
+	template<typename T>
+	static bool parsePrimitive(const TypeDescriptor* desc, void* dest, const std::string& src) {
+		if (desc->isType<T>()) {
+			*(T*)dest = fromString<T>(src);
+			return true;
+		}
+		return false;
+	}
+
 	std::string toString(const TypeDescriptor* desc, void* value) {
+		std::string str;
+		toString(desc, value, str);
+		return str;
+	}
+
+	void toString(const TypeDescriptor* desc, void* value, std::string& out) {
 		if (desc->isType<std::string>()) {
-			return *(std::string*)value;
-		}
-		else if ((int)desc->flags & (int)TypeDescriptor::Flags::DATA) {
-			if (desc->isType<float>()) {
-				return toString(*(float*)value);
-			}
-			if (desc->isType<double>()) {
-				return toString(*(double*)value);
-			}
-			if (desc->size == 8) {
-				return toString(*(int64_t*)value);
-			}
-			else {
-				return toString(*(int*)value);
-			}
+			out.append(*(std::string*)value);
+		}
+		else if ((int)desc->flags & (int)TypeDescriptor::Flags::PRIMITIVE) {
+			appendPrimitive<float>(desc, value, out) ||
+				appendPrimitive<double>(desc, value, out) ||
+				appendPrimitive<int32_t>(desc, value, out) ||
+				appendPrimitive<uint32_t>(desc, value, out) ||
+				appendPrimitive<int64_t>(desc, value, out) ||
+				appendPrimitive<uint64_t>(desc, value, out) ||
+				appendPrimitive<int16_t>(desc, value, out) ||
+				appendPrimitive<uint16_t>(desc, value, out) ||
+				appendPrimitive<int8_t>(desc, value, out) ||
+				appendPrimitive<uint8_t>(desc, value, out);
 		}
 		else {
-			std::string str;
+			bool first = true;
 			for (auto& m : desc->members) {
-				if (!str.empty()) {
-					str += ",";
+				if (!first) {
+					out.push_back(',');
 				}
-				str += toString(m->type.get(), (uint8_t*)value + m->offset);
+				first = false;
+				toString(m->type.get(), (uint8_t*)value + m->offset, out);
 			}
-			return str;
 		}
 	}
 
@@ -137,19 +164,17 @@ namespace baseline {
 		if (desc->isType<std::string>()) {
 			*(std::string*)dest = src;
 		}
-		else if ((int)desc->flags & (int)TypeDescriptor::Flags::DATA) {
-			if (desc->isType<float>()) {
-				*(float*)dest = fromString<float>(src);
-			}
-			else if (desc->isType<double>()) {
-				*(double*)dest = fromString<double>(src);
-			}
-			else if (desc->size == 8) {
-				*(int64_t*)dest = fromString<int>(src);
-			}
-			else {
-				*(int*)dest = fromString<int>(src);
-			}
+		else if ((int)desc->flags & (int)TypeDescriptor::Flags::PRIMITIVE) {
+			parsePrimitive<float>(desc, dest, src) ||
+				parsePrimitive<double>(desc, dest, src) ||
+				parsePrimitive<int32_t>(desc, dest, src) ||
+				parsePrimitive<uint32_t>(desc, dest, src) ||
+				parsePrimitive<int64_t>(desc, dest, src) ||
+				parsePrimitive<uint64_t>(desc, dest, src) ||
+				parsePrimitive<int16_t>(desc, dest, src) ||
+				parsePrimitive<uint16_t>(desc, dest, src) ||
+				parsePrimitive<int8_t>(desc, dest, src) ||
+				parsePrimitive<uint8_t>(desc, dest, src);
 		}
 	}
 
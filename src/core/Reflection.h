@@ -9,6 +9,7 @@
 #include <memory>
 #include <map>
 #include <functional>
+#include <mutex>
 
 namespace baseline {
 
@@ -177,17 +178,26 @@ namespace baseline {
 		}
 	};
 
+	//modules are opened in parallel, so the static initializers of REG_TYPE and REG_MEMBER can run at the same time
+	//registration and lookups are guarded by one lock, descriptors are only read without it once the modules are loaded
 	class Reflection {
 	public:
 		template<typename Type>
 		static void registerType(const std::string& name) {
+			std::unique_lock<std::recursive_mutex> lock(getMutexImpl());
 			auto type = getTypeImpl<Type>();
 			type->name = name;
+			//a module that is loaded again registers its members again, members it no longer has must not stay
+			//the layout can have changed as well, so the flags are computed again
+			type->members.clear();
+			type->flags = TypeDescriptor::Flags::NONE;
+			initType<Type>(type);
 			getTypesByNameImpl()[name] = type;
 		}
 
 		template<typename Type, typename Member>
 		static void registerMember(const std::string& name, int offset) {
+			std::unique_lock<std::recursive_mutex> lock(getMutexImpl());
 			auto type = getTypeImpl<Type>();
 
 			std::shared_ptr<MemberDescriptor> member;
@@ -204,6 +214,8 @@ namespace baseline {
 
 			member->offset = offset;
 			member->type = getTypeImpl<Member>();
+			//the ops of an existing member type can point into a module that was unloaded
+			initType<Member>(member->type);
 			initType<Type>(type);
 		}
 
@@ -214,6 +226,7 @@ namespace baseline {
 		}
 
 		static const TypeDescriptor* getType(const std::string& name) {
+			std::unique_lock<std::recursive_mutex> lock(getMutexImpl());
 			auto& typesByName = getTypesByNameImpl();
 			auto i = typesByName.find(name);
 			if (i == typesByName.end()) {
@@ -229,10 +242,12 @@ namespace baseline {
 	private:
 		static std::vector<std::shared_ptr<TypeDescriptor>>& getTypesImpl();
 		static std::map<std::string, std::shared_ptr<TypeDescriptor>>& getTypesByNameImpl();
+		static std::recursive_mutex& getMutexImpl();
 		static void initTypeImpl(std::shared_ptr<TypeDescriptor> type);
 
 		template<typename Type>
 		static void initType(std::shared_ptr<TypeDescriptor> type) {
+			type->size = sizeof(Type);
 			type->typeOps = std::make_shared<TypeOpsT<Type>>();
 			if constexpr (std::is_pointer_v<Type>) {
 				(int&)type->flags |= (int)TypeDescriptor::Flags::POINTER;
@@ -245,6 +260,7 @@ namespace baseline {
 				using ValueType = typename Type::value_type;
 				(int&)type->flags |= (int)TypeDescriptor::Flags::VECTOR;
 				type->valueType = getTypeImpl<ValueType>();
+				type->valueType->typeOps = std::make_shared<TypeOpsT<ValueType>>();
 				if (type->name.empty()) {
 					type->name = "vector<" + type->valueType->name + ">";
 				}
@@ -263,6 +279,8 @@ namespace baseline {
 
 		template<typename Type>
 		static std::shared_ptr<TypeDescriptor> getTypeImpl() {
+			//recursive, initType looks up the types of pointers, vectors and maps
+			std::unique_lock<std::recursive_mutex> lock(getMutexImpl());
 			auto& types = getTypesImpl();
 			int hash = (int)typeid(Type).hash_code();
 
@@ -289,6 +307,9 @@ namespace baseline {
 
 	std::string toString(const TypeDescriptor* desc, void* value);
 
+	//appends to out, members of structs are separated by ','
+	void toString(const TypeDescriptor* desc, void* value, std::string& out);
+
 	void fromString(const TypeDescriptor* desc, void* dest, const std::string& src);
 
 	std::vector<MemberDescriptor> flatMemberList(const TypeDescriptor* desc, const std::string& prefix = "", int offset = 0, bool fullNames = true);
@@ -3,17 +3,102 @@
 //
 
 #include "Singleton.h"
+#include <mutex>
+#include <algorithm>
 
 namespace baseline {
 
-	void** Singleton::getInstance(size_t hashCode) {
-		static std::unordered_map<size_t, void*> instances;
-		auto entry = instances.find(hashCode);
-		if (entry == instances.end()) {
-			instances[hashCode] = nullptr;
-			return &instances[hashCode];
+	//recursive, because constructors of singletons create other singletons
+	static std::recursive_mutex& getMutex() {
+		static std::recursive_mutex mutex;
+		return mutex;
+	}
+
+	//slots are never freed, so the pointers cached in Singleton::get stay valid
+	static std::unordered_map<size_t, void*>& getSlots() {
+		static std::unordered_map<size_t, void*> slots;
+		return slots;
+	}
+
+	static int nextOrder = 1;
+
+	Singleton::Slot* Singleton::getSlot(size_t hashCode, DestructFunc destruct) {
+		std::unique_lock<std::recursive_mutex> lock(getMutex());
+		auto& slots = getSlots();
+		Slot* slot = nullptr;
+		auto entry = slots.find(hashCode);
+		if (entry == slots.end()) {
+			slot = new Slot();
+			slots[hashCode] = slot;
+		}
+		else {
+			slot = (Slot*)entry->second;
+		}
+		if (std::find(slot->destructors.begin(), slot->destructors.end(), destruct) == slot->destructors.end()) {
+			slot->destructors.push_back(destruct);
+		}
+		return slot;
+	}
+
+	void* Singleton::create(Slot* slot, ConstructFunc construct) {
+		std::unique_lock<std::recursive_mutex> lock(getMutex());
+		void* instance = slot->instance.load(std::memory_order_relaxed);
+		if (instance == nullptr) {
+			instance = construct();
+			//after the constructor, so singletons it created come first
+			slot->order = nextOrder++;
+			slot->instance.store(instance, std::memory_order_release);
+		}
+		return instance;
+	}
+
+	void Singleton::destroy(Slot* slot) {
+		std::unique_lock<std::recursive_mutex> lock(getMutex());
+		void* instance = slot->instance.exchange(nullptr, std::memory_order_acq_rel);
+		if (instance != nullptr && !slot->destructors.empty()) {
+			slot->destructors[0](instance);
+		}
+		slot->order = 0;
+	}
+
+	std::vector<Singleton::Slot*> Singleton::getConstructedSlots() {
+		std::vector<Slot*> list;
+		for (auto& entry : getSlots()) {
+			Slot* slot = (Slot*)entry.second;
+			if (slot->instance.load(std::memory_order_relaxed) != nullptr) {
+				list.push_back(slot);
+			}
+		}
+		std::sort(list.begin(), list.end(), [](Slot* a, Slot* b) {
+			return a->order > b->order;
+		});
+		return list;
+	}
+
+	void Singleton::clearModule(const std::function<bool(const void* address)>& isModuleCode) {
+		std::unique_lock<std::recursive_mutex> lock(getMutex());
+		auto isModuleDestructor = [&](DestructFunc destruct) {
+			return isModuleCode((const void*)destruct);
+		};
+
+		//the destructors of the module are still loaded here
+		for (Slot* slot : getConstructedSlots()) {
+			if (std::all_of(slot->destructors.begin(), slot->destructors.end(), isModuleDestructor)) {
+				destroy(slot);
+			}
+		}
+
+		for (auto& entry : getSlots()) {
+			Slot* slot = (Slot*)entry.second;
+			slot->destructors.erase(std::remove_if(slot->destructors.begin(), slot->destructors.end(), isModuleDestructor), slot->destructors.end());
+		}
+	}
+
+	void Singleton::clearAll() {
+		std::unique_lock<std::recursive_mutex> lock(getMutex());
+		for (Slot* slot : getConstructedSlots()) {
+			destroy(slot);
 		}
-		return &entry->second;
 	}
 
 }
@@ -5,35 +5,68 @@
 #pragma once
 
 #include <unordered_map>
+#include <vector>
+#include <functional>
+#include <atomic>
+#include <typeinfo>
+#include <cstddef>
 
 namespace baseline {
 
 	class Singleton {
 	public:
+		//lock free after the first call per type, the instance is only created once even if called from multiple threads
+		//each library that calls get for a type registers its own destructor, the slot is looked up once per library
 		template<typename Class>
 		static Class *get() {
-			static Class** instance = getInstance<Class>();
-			if (*instance == nullptr) {
-				*instance = new Class();
+			static Slot* slot = getSlot(typeid(Class).hash_code(), &destruct<Class>);
+			void* instance = slot->instance.load(std::memory_order_acquire);
+			if (instance == nullptr) {
+				instance = create(slot, &construct<Class>);
 			}
-			return *instance;
+			return (Class*)instance;
 		}
 
 		template<typename Class>
 		static void clear() {
-			Class** instance = getInstance<Class>();
-			if (*instance != nullptr) {
-				delete *instance;
-				*instance = nullptr;
-			}
+			destroy(getSlot(typeid(Class).hash_code(), &destruct<Class>));
 		}
 
+		//called before the library of a module is closed, isModuleCode tells if an address belongs to the library
+		//instances of types that only the module used are destroyed in reverse construction order,
+		//the other types keep their instance and use the destructor of another library from then on
+		static void clearModule(const std::function<bool(const void* address)>& isModuleCode);
+		//destroys all instances in reverse construction order, for the end of the program after the modules are unloaded
+		//an instance that uses another singleton in its constructor is destroyed before that one
+		static void clearAll();
+
 	private:
-		static void** getInstance(size_t hashCode);
+		typedef void* (*ConstructFunc)();
+		typedef void (*DestructFunc)(void* instance);
+
+		class Slot {
+		public:
+			std::atomic<void*> instance = nullptr;
+			//one per library that uses the type, they all do the same
+			std::vector<DestructFunc> destructors;
+			//position in the construction order, 0 if there is no instance
+			int order = 0;
+		};
+
+		static Slot* getSlot(size_t hashCode, DestructFunc destruct);
+		static void* create(Slot* slot, ConstructFunc construct);
+		static void destroy(Slot* slot);
+		//slots with an instance, the last constructed first
+		static std::vector<Slot*> getConstructedSlots();
+
+		template<typename Class>
+		static void* construct() {
+			return new Class();
+		}
 
 		template<typename Class>
-		static Class** getInstance() {
-			return (Class**)getInstance(typeid(Class).hash_code());
+		static void destruct(void* instance) {
+			delete (Class*)instance;
 		}
 	};
 
@@ -0,0 +1,416 @@
+//
+// Copyright (c) 2024 Julian Hinxlage. All rights reserved.
+//
+
+#include "Snapshot.h"
+#include "common/Log.h"
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+#include <algorithm>
+
+namespace baseline {
+
+	static const char snapshotMagic[8] = { 'B', 'L', 'S', 'N', 'A', 'P', 0, 0 };
+
+	class SnapshotHeader {
+	public:
+		char magic[8];
+		uint32_t version;
+		uint32_t arrayCount;
+		uint64_t schemaSize;
+	};
+
+	class SchemaWriter {
+	public:
+		std::string data;
+
+		template<typename T>
+		void write(const T& value) {
+			data.append((const char*)&value, sizeof(value));
+		}
+
+		void writeStr(const std::string& str) {
+			write((uint32_t)str.size());
+			data.append(str);
+		}
+	};
+
+	class SchemaReader {
+	public:
+		const uint8_t* data = nullptr;
+		uint64_t size = 0;
+		uint64_t index = 0;
+		bool valid = true;
+
+		template<typename T>
+		void read(T& value) {
+			if (index + sizeof(value) > size) {
+				valid = false;
+				value = T();
+				return;
+			}
+			memcpy(&value, data + index, sizeof(value));
+			index += sizeof(value);
+		}
+
+		void readStr(std::string& str) {
+			uint32_t length = 0;
+			read(length);
+			if (index + length > size) {
+				valid = false;
+				str.clear();
+				return;
+			}
+			str.assign((const char*)data + index, length);
+			index += length;
+		}
+	};
+
+	Snapshot::Snapshot() {
+	}
+
+	Snapshot::~Snapshot() {
+		close();
+	}
+
+	void Snapshot::add(const std::string& name, const TypeDescriptor* type, const void* data, int count) {
+		if (!type || !((int)type->flags & (int)TypeDescriptor::Flags::DATA)) {
+			Log::error("snapshot: array %s has no DATA type", name.c_str());
+			return;
+		}
+
+		Array* array = getArray(name);
+		if (!array) {
+			arrays.push_back({});
+			array = &arrays.back();
+			array->name = name;
+		}
+		array->typeName = type->name;
+		array->elementSize = type->size;
+		array->count = count;
+		array->members = getMembers(type);
+		array->data = data;
+		array->converted.clear();
+		array->convertedType = nullptr;
+	}
+
+	bool Snapshot::save(const std::string& file) {
+		//the layouts are written as new arrays, the loaded arrays keep describing the mapped file
+		std::vector<Array> layouts;
+		std::vector<const void*> sources;
+		for (auto& array : arrays) {
+			Array layout;
+			layout.name = array.name;
+			layout.typeName = array.typeName;
+			layout.elementSize = array.elementSize;
+			layout.count = array.count;
+			layout.members = array.members;
+			if (array.data) {
+				sources.push_back(array.data);
+			}
+			else if (array.convertedType) {
+				//converted arrays are saved with the layout they were converted to
+				layout.typeName = array.convertedType->name;
+				layout.elementSize = array.convertedType->size;
+				layout.members = getMembers(array.convertedType);
+				sources.push_back(array.converted.data());
+			}
+			else if (fileView.data()) {
+				sources.push_back(fileView.data() + array.dataOffset);
+			}
+			else {
+				sources.push_back(nullptr);
+			}
+			layouts.push_back(layout);
+		}
+
+		//the schema size does not depend on the data offsets, so it is measured first
+		uint64_t offset = sizeof(SnapshotHeader) + writeSchema(layouts).size();
+		for (auto& layout : layouts) {
+			offset = (offset + pageSize - 1) / pageSize * pageSize;
+			layout.dataOffset = offset;
+			offset += layout.count * layout.elementSize;
+		}
+		std::string schema = writeSchema(layouts);
+
+		//written next to the target and renamed, the file can still be mapped by this or another snapshot
+		std::string tmpFile = file + ".tmp";
+		std::ofstream stream(tmpFile, std::ios::binary);
+		if (!stream.is_open()) {
+			Log::warning("snapshot: could not open file %s", file.c_str());
+			return false;
+		}
+
+		SnapshotHeader header;
+		memcpy(header.magic, snapshotMagic, sizeof(header.magic));
+		header.version = version;
+		header.arrayCount = layouts.size();
+		header.schemaSize = schema.size();
+		stream.write((const char*)&header, sizeof(header));
+		stream.write(schema.data(), schema.size());
+
+		uint64_t position = sizeof(header) + schema.size();
+		std::vector<char> padding(pageSize, 0);
+		for (int i = 0; i < layouts.size(); i++) {
+			auto& layout = layouts[i];
+			uint64_t size = layout.count * layout.elementSize;
+			stream.write(padding.data(), layout.dataOffset - position);
+			if (sources[i]) {
+				stream.write((const char*)sources[i], size);
+			}
+			else {
+				for (uint64_t j = 0; j < size; j += pageSize) {
+					stream.write(padding.data(), std::min((uint64_t)pageSize, size - j));
+				}
+			}
+			position = layout.dataOffset + size;
+		}
+
+		stream.close();
+		std::error_code error;
+		if (!stream.good()) {
+			Log::warning("snapshot: could not write file %s", file.c_str());
+			std::filesystem::remove(tmpFile, error);
+			return false;
+		}
+		if (!replaceFile(tmpFile, file)) {
+			Log::warning("snapshot: could not replace file %s", file.c_str());
+			std::filesystem::remove(tmpFile, error);
+			return false;
+		}
+		return true;
+	}
+
+	std::string Snapshot::writeSchema(const std::vector<Array>& layouts) {
+		SchemaWriter schema;
+		for (auto& array : layouts) {
+			schema.writeStr(array.name);
+			schema.writeStr(array.typeName);
+			schema.write(array.elementSize);
+			schema.write(array.count);
+			schema.write(array.dataOffset);
+			schema.write((uint32_t)array.members.size());
+			for (auto& member : array.members) {
+				schema.writeStr(member.name);
+				schema.writeStr(member.typeName);
+				schema.write(member.offset);
+				schema.write(member.size);
+			}
+		}
+		return schema.data;
+	}
+
+	bool Snapshot::load(const std::string& file) {
+		close();
+
+		if (!fileView.open(file, true)) {
+			Log::warning("snapshot: file %s not found", file.c_str());
+			return false;
+		}
+		uint8_t* mapping = fileView.data();
+		uint64_t mappingSize = fileView.size();
+		if (!mapping) {
+			Log::warning("snapshot: file %s is empty", file.c_str());
+			close();
+			return false;
+		}
+
+		SchemaReader reader;
+		reader.data = mapping;
+		reader.size = mappingSize;
+
+		SnapshotHeader header;
+		reader.read(header);
+		if (!reader.valid || memcmp(header.magic, snapshotMagic, sizeof(header.magic)) != 0) {
+			Log::warning("snapshot: file %s is not a snapshot", file.c_str());
+			close();
+			return false;
+		}
+		if (header.version != version) {
+			Log::warning("snapshot: file %s has version %i, expected %i", file.c_str(), (int)header.version, (int)version);
+			close();
+			return false;
+		}
+		if (header.schemaSize > mappingSize - sizeof(header)) {
+			Log::warning("snapshot: file %s has an invalid schema", file.c_str());
+			close();
+			return false;
+		}
+		reader.size = sizeof(header) + header.schemaSize;
+
+		for (uint32_t i = 0; i < header.arrayCount && reader.valid; i++) {
+			Array array;
+			uint32_t memberCount = 0;
+			reader.readStr(array.name);
+			reader.readStr(array.typeName);
+			reader.read(array.elementSize);
+			reader.read(array.count);
+			reader.read(array.dataOffset);
+			reader.read(memberCount);
+			for (uint32_t j = 0; j < memberCount && reader.valid; j++) {
+				Member member;
+				reader.readStr(member.name);
+				reader.readStr(member.typeName);
+				reader.read(member.offset);
+				reader.read(member.size);
+				if ((uint64_t)member.offset + member.size > array.elementSize) {
+					reader.valid = false;
+				}
+				array.members.push_back(member);
+			}
+			//compared by division, count * elementSize can overflow for a broken header
+			if (array.elementSize == 0 || array.dataOffset % pageSize != 0 || array.dataOffset > mappingSize) {
+				reader.valid = false;
+			}
+			else if (array.count > (mappingSize - array.dataOffset) / array.elementSize) {
+				reader.valid = false;
+			}
+			arrays.push_back(array);
+		}
+
+		if (!reader.valid) {
+			Log::warning("snapshot: file %s has an invalid schema", file.c_str());
+			close();
+			return false;
+		}
+
+		this->file = file;
+		Log::trace("loaded snapshot %s", file.c_str());
+		return true;
+	}
+
+	void Snapshot::close() {
+		fileView.close();
+		arrays.clear();
+		file = "";
+	}
+
+	void* Snapshot::get(const std::string& name, const TypeDescriptor* type, int* count) {
+		Array* array = getArray(name);
+		if (!array || !type) {
+			if (count) {
+				*count = 0;
+			}
+			return nullptr;
+		}
+		if (count) {
+			*count = (int)array->count;
+		}
+
+		if (array->data) {
+			return (void*)array->data;
+		}
+		if (isLayoutEqual(*array, type)) {
+			return fileView.data() + array->dataOffset;
+		}
+		if (array->convertedType != type) {
+			Log::info("snapshot %s: layout of %s changed, converting array %s", file.c_str(), type->name.c_str(), name.c_str());
+			convert(*array, type);
+		}
+		return array->converted.data();
+	}
+
+	bool Snapshot::isInPlace(const std::string& name, const TypeDescriptor* type) {
+		Array* array = getArray(name);
+		return array && fileView.data() && !array->data && isLayoutEqual(*array, type);
+	}
+
+	std::vector<std::string> Snapshot::getArrayNames() {
+		std::vector<std::string> list;
+		for (auto& array : arrays) {
+			list.push_back(array.name);
+		}
+		return list;
+	}
+
+	Snapshot::Array* Snapshot::getArray(const std::string& name) {
+		for (auto& array : arrays) {
+			if (array.name == name) {
+				return &array;
+			}
+		}
+		return nullptr;
+	}
+
+	std::vector<Snapshot::Member> Snapshot::getMembers(const TypeDescriptor* type) {
+		std::vector<Member> members;
+		if (type->members.empty()) {
+			members.push_back({ "", type->name, 0, (uint32_t)type->size });
+		}
+		else {
+			for (auto& m : flatMemberList(type)) {
+				members.push_back({ m.name, m.type->name, (uint32_t)m.offset, (uint32_t)m.type->size });
+			}
+		}
+		return members;
+	}
+
+	bool Snapshot::isLayoutEqual(const Array& array, const TypeDescriptor* type) {
+		if (!type || array.typeName != type->name || array.elementSize != type->size) {
+			return false;
+		}
+		auto members = getMembers(type);
+		if (members.size() != array.members.size()) {
+			return false;
+		}
+		for (int i = 0; i < members.size(); i++) {
+			auto& a = members[i];
+			auto& b = array.members[i];
+			if (a.name != b.name || a.typeName != b.typeName || a.offset != b.offset || a.size != b.size) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void Snapshot::convert(Array& array, const TypeDescriptor* type) {
+		array.converted.clear();
+		array.converted.resize(array.count * type->size);
+		array.convertedType = type;
+
+		auto members = getMembers(type);
+		std::vector<const Member*> sources;
+		for (auto& member : members) {
+			const Member* source = nullptr;
+			for (auto& m : array.members) {
+				if (m.name == member.name) {
+					source = &m;
+					break;
+				}
+			}
+			if (!source) {
+				Log::warning("snapshot %s: member %s of %s not found", file.c_str(), member.name.c_str(), type->name.c_str());
+			}
+			sources.push_back(source);
+		}
+
+		std::string text;
+		for (uint64_t i = 0; i < array.count; i++) {
+			uint8_t* dest = array.converted.data() + i * type->size;
+			uint8_t* src = fileView.data() + array.dataOffset + i * array.elementSize;
+			type->typeOps->construct(dest);
+
+			for (int j = 0; j < members.size(); j++) {
+				auto& member = members[j];
+				auto* source = sources[j];
+				if (!source) {
+					continue;
+				}
+				if (source->typeName == member.typeName && source->size == member.size) {
+					memcpy(dest + member.offset, src + source->offset, member.size);
+				}
+				else {
+					const TypeDescriptor* sourceType = Reflection::getType(source->typeName);
+					const TypeDescriptor* destType = Reflection::getType(member.typeName);
+					if (sourceType && destType && sourceType->size == source->size) {
+						text.clear();
+						toString(sourceType, src + source->offset, text);
+						fromString(destType, dest + member.offset, text);
+					}
+				}
+			}
+		}
+	}
+
+}
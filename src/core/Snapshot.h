@@ -0,0 +1,79 @@
+//
+// Copyright (c) 2024 Julian Hinxlage. All rights reserved.
+//
+
+#pragma once
+
+#include "Reflection.h"
+#include "common/File.h"
+#include <string>
+#include <vector>
+
+namespace baseline {
+
+	//binary file of reflected DATA arrays
+	//the arrays are stored page aligned, so they can be used in place from a memory mapping
+	//the schema header is used for validation and to convert arrays whose type layout has changed
+	class Snapshot {
+	public:
+		static constexpr uint32_t version = 1;
+		static constexpr uint32_t pageSize = 4096;
+
+		Snapshot();
+		~Snapshot();
+
+		//the data is not copied and has to stay valid until save is called
+		template<typename T>
+		void add(const std::string& name, const T* data, int count) {
+			add(name, Reflection::getType<T>(), data, count);
+		}
+		void add(const std::string& name, const TypeDescriptor* type, const void* data, int count);
+		bool save(const std::string& file);
+
+		bool load(const std::string& file);
+		void close();
+
+		//returns the array in place if the layout matches, otherwise a converted copy
+		template<typename T>
+		T* get(const std::string& name, int* count = nullptr) {
+			return (T*)get(name, Reflection::getType<T>(), count);
+		}
+		void* get(const std::string& name, const TypeDescriptor* type, int* count = nullptr);
+		bool isInPlace(const std::string& name, const TypeDescriptor* type);
+		std::vector<std::string> getArrayNames();
+
+	private:
+		class Member {
+		public:
+			std::string name;
+			std::string typeName;
+			uint32_t offset = 0;
+			uint32_t size = 0;
+		};
+
+		class Array {
+		public:
+			std::string name;
+			std::string typeName;
+			uint32_t elementSize = 0;
+			uint64_t count = 0;
+			uint64_t dataOffset = 0;
+			std::vector<Member> members;
+			const void* data = nullptr;
+			const TypeDescriptor* convertedType = nullptr;
+			std::vector<uint8_t> converted;
+		};
+
+		std::vector<Array> arrays;
+		std::string file;
+		//mapped copy on write, so arrays used in place can be modified without touching the file
+		FileView fileView;
+
+		Array* getArray(const std::string& name);
+		static std::string writeSchema(const std::vector<Array>& layouts);
+		static std::vector<Member> getMembers(const TypeDescriptor* type);
+		static bool isLayoutEqual(const Array& array, const TypeDescriptor* type);
+		void convert(Array& array, const TypeDescriptor* type);
+	};
+
+}
@@ -123,10 +123,12 @@ namespace baseline {
 		addThread([&]() {
 			runTimer();
 		}, "timer");
+		this->workerCount = workerCount;
 	}
 
 	void TaskManager::stop(bool joinTasks, bool runAllTasks) {
 		LOCK(threadDataMutex);
+		workerCount = 0;
 
 		if (runAllTasks) {
 			for (auto& i : tasks) {
@@ -155,6 +157,10 @@ namespace baseline {
 		threads.clear();
 	}
 
+	int TaskManager::getWorkerCount() {
+		return workerCount;
+	}
+
 	TaskManager::Task& TaskManager::getTask(int taskId) {
 		auto i = tasks.find(taskId);
 		if (i == tasks.end()) {
@@ -11,6 +11,7 @@
 #include <condition_variable>
 #include <functional>
 #include <memory>
+#include <atomic>
 
 namespace baseline {
 
@@ -51,6 +52,8 @@ namespace baseline {
 		void terminateTask(int taskId);
 		void start(int workerCount);
 		void stop(bool joinTasks = true, bool runAllTasks = false);
+		//0 if the manager is not started, NORMAL tasks only run when there are workers
+		int getWorkerCount();
 
 
 		std::vector<int> getTaskIds();
@@ -94,6 +97,7 @@ namespace baseline {
 
 		int nextThreadId = 1;
 		int nextTaskId = 1;
+		std::atomic<int> workerCount = 0;
 
 		std::vector<std::shared_ptr<Thread>> threads;
 		std::map<int, Task> tasks;
@@ -94,4 +94,4 @@ extern "C" void load() {
 	});
 }
 
-
+BL_MODULE_FUNCTIONS(BL_MODULE_FUNCTION(load), BL_MODULE_FUNCTION(unload))
@@ -4,6 +4,8 @@
 
 #include "Window.h"
 #include "common/strutil.h"
+#include "core/Config.h"
+#include "core/Singleton.h"
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <imgui.h>
@@ -23,6 +25,9 @@ static void glfw_error_callback(int error, const char* description) {
 
 namespace baseline {
 
+	void (*Window::setViewportHook)(int x, int y, int width, int height) = nullptr;
+	void (*Window::invalidateStateHook)() = nullptr;
+
 	bool Window::init(int width, int height, const std::string& title, int swapInterval, bool maximized) {
 		//init glfw
 		glfwSetErrorCallback(glfw_error_callback);
@@ -110,6 +115,8 @@ namespace baseline {
 			glfwWaitEvents();
 		}
 		glfwPollEvents();
+		//values of a live reloaded config file are written to the fields bound on this thread
+		Singleton::get<Config>()->update();
 		ImGui_ImplOpenGL3_NewFrame();
 		ImGui_ImplGlfw_NewFrame();
 		ImGui::NewFrame();
@@ -128,10 +135,18 @@ namespace baseline {
 		int x = 0;
 		int y = 0;
 		glfwGetFramebufferSize((GLFWwindow*)context, &x, &y);
-		glViewport(0, 0, x, y);
+		if (setViewportHook) {
+			setViewportHook(0, 0, x, y);
+		}
+		else {
+			glViewport(0, 0, x, y);
+		}
 		glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT);
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+		if (invalidateStateHook) {
+			invalidateStateHook();
+		}
 
 		ImGuiIO& io = ImGui::GetIO(); (void)io;
 		if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
@@ -17,6 +17,10 @@ namespace baseline {
 		bool alwaysRefresh = false;
 		bool enableLayout = true;
 
+		//set by the render module, so the GL state it caches stays valid when endFrame draws ImGui with raw GL calls
+		static void (*setViewportHook)(int x, int y, int width, int height);
+		static void (*invalidateStateHook)();
+
 		bool init(int width, int height, const std::string &title, int swapInterval = 1, bool maximized = false);
 		void beginFrame();
 		void endFrame();
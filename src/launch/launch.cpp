@@ -15,6 +15,7 @@ using namespace baseline;
 #define BL_LAUNCH_CONFIG_STR STR2(BL_LAUNCH_CONFIG)
 
 int main(int argc, char* argv[]) {
+	Log::setAsync(true);
 	auto* launcher = Singleton::get<Launcher>();
 
 	Log::info("directory:  %s", std::filesystem::current_path().string().c_str());
@@ -26,5 +27,8 @@ int main(int argc, char* argv[]) {
 
 	launcher->joinAll();
 	launcher->shutdown();
+	//the singletons of the modules were destroyed when they were unloaded
+	Singleton::clearAll();
+	Log::setAsync(false);
 	return 0;
 }
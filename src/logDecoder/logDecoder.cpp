@@ -0,0 +1,40 @@
+//
+// Copyright (c) 2024 Julian Hinxlage. All rights reserved.
+//
+
+#include "common/BinaryLog.h"
+#include <cstdio>
+
+using namespace baseline;
+
+//renders binary log files back to the text log format
+//rotated files should be passed oldest first, e.g. logDecoder log.bin.2 log.bin.1 log.bin
+int main(int argc, char* argv[]) {
+	if (argc < 2) {
+		printf("usage: %s <file> [file ...]\n", argv[0]);
+		return 1;
+	}
+
+	int result = 0;
+	std::string line;
+	std::string message;
+	for (int i = 1; i < argc; i++) {
+		BinaryLogReader reader;
+		if (!reader.open(argv[i])) {
+			fprintf(stderr, "%s: not a binary log file\n", argv[i]);
+			result = 1;
+			continue;
+		}
+
+		LogLevel level;
+		uint64_t time;
+		while (reader.next(level, time, message)) {
+			line.clear();
+			Log::appendPrefix(line, time, level);
+			line.append(message);
+			line.push_back('\n');
+			fwrite(line.data(), 1, line.size(), stdout);
+		}
+	}
+	return result;
+}
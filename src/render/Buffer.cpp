@@ -3,7 +3,9 @@
 //
 
 #include "Buffer.h"
+#include "RenderState.h"
 #include <GL/glew.h>
+#include <algorithm>
 
 namespace baseline {
 
@@ -14,21 +16,24 @@ namespace baseline {
         elementSize = 1;
         dynamic = false;
         type = BufferType::VERTEX_BUFFER;
+        streaming = false;
+        persistent = false;
+        frame = 0;
+        regionSize = 0;
+        mapping = nullptr;
     }
 
     Buffer::~Buffer() {
+        clearStream();
         if(id != 0){
+            RenderState::get().removeBuffer(id);
             glDeleteBuffers(1, &id);
             id = 0;
         }
     }
 
     void bindBuffer(uint32_t id, BufferType type){
-        static uint32_t currentId[32];
-        if(currentId[(int)type] != id){
-            glBindBuffer(internalEnum(type), id);
-            currentId[(int)type] = id;
-        }
+        RenderState::get().bindBuffer(type, id);
     }
 
     void Buffer::bind() const {
@@ -51,6 +56,10 @@ namespace baseline {
         return elementSize;
     }
 
+    uint32_t Buffer::getCapacity() const {
+        return capacity;
+    }
+
     uint32_t Buffer::getElementCount() const {
         return size / elementSize;
     }
@@ -88,4 +97,117 @@ namespace baseline {
         unbind();
     }
 
-}
\ No newline at end of file
+    void Buffer::initStream(uint32_t size, uint32_t elementSize, BufferType type, int frameCount) {
+        clearStream();
+        this->elementSize = elementSize;
+        this->dynamic = true;
+        this->type = type;
+        this->size = 0;
+        streaming = true;
+        persistent = GLEW_ARB_buffer_storage || GLEW_VERSION_4_4;
+        fences.assign(persistent ? std::max(frameCount, 1) : 0, nullptr);
+        frame = 0;
+        regionSize = 0;
+        growStream(std::max(size, elementSize));
+    }
+
+    void* Buffer::mapStream(uint32_t size) {
+        if(!streaming){
+            return nullptr;
+        }
+        if(size > regionSize){
+            growStream(size);
+        }
+        this->size = size;
+
+        if(persistent){
+            if(!mapping){
+                return nullptr;
+            }
+            GLsync &fence = (GLsync&)fences[frame];
+            if(fence){
+                //only blocks if the GPU is more than frameCount frames behind
+                if(glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED){
+                    glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX);
+                }
+                glDeleteSync(fence);
+                fence = nullptr;
+            }
+            return (uint8_t*)mapping + getStreamOffset();
+        }else{
+            //orphan the old storage so the driver does not wait for draws that still read it
+            bind();
+            glBufferData(internalEnum(type), regionSize, nullptr, GL_STREAM_DRAW);
+            void *data = glMapBufferRange(internalEnum(type), 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+            unbind();
+            return data;
+        }
+    }
+
+    void Buffer::unmapStream() {
+        if(streaming && !persistent){
+            bind();
+            glUnmapBuffer(internalEnum(type));
+            unbind();
+        }
+    }
+
+    void Buffer::fenceStream() {
+        if(streaming && persistent){
+            fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            frame = (frame + 1) % (int)fences.size();
+        }
+    }
+
+    uint32_t Buffer::getStreamOffset() const {
+        return persistent ? frame * regionSize : 0;
+    }
+
+    void Buffer::growStream(uint32_t size) {
+        //geometric growth, regions stay a multiple of the element size so offsets can be used as base instances
+        uint32_t newSize = std::max(size, regionSize * 2);
+        newSize = (newSize + elementSize - 1) / elementSize * elementSize;
+
+        if(persistent){
+            //immutable storage can not be resized, the old buffer is released by the driver when the GPU is done with it
+            size_t regions = fences.size();
+            clearStream();
+            fences.assign(regions, nullptr);
+            if(id != 0){
+                RenderState::get().removeBuffer(id);
+                glDeleteBuffers(1, &id);
+                id = 0;
+            }
+            glGenBuffers(1, &id);
+            bind();
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(internalEnum(type), (GLsizeiptr)newSize * fences.size(), nullptr, flags);
+            mapping = glMapBufferRange(internalEnum(type), 0, (GLsizeiptr)newSize * fences.size(), flags);
+            unbind();
+            frame = 0;
+            capacity = newSize * (uint32_t)fences.size();
+        }else{
+            if(id == 0){
+                glGenBuffers(1, &id);
+            }
+            capacity = newSize;
+        }
+        regionSize = newSize;
+    }
+
+    void Buffer::clearStream() {
+        for(auto &fence : fences){
+            if(fence){
+                glDeleteSync((GLsync)fence);
+            }
+        }
+        fences.clear();
+        if(mapping){
+            bind();
+            glUnmapBuffer(internalEnum(type));
+            unbind();
+            mapping = nullptr;
+        }
+    }
+
+}
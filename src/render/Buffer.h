@@ -5,6 +5,7 @@
 #pragma once
 
 #include "enum.h"
+#include <vector>
 
 namespace baseline {
 
@@ -21,10 +22,23 @@ namespace baseline {
         uint32_t getId() const;
         uint32_t getElementCount() const;
         uint32_t getElementSize() const;
+        uint32_t getCapacity() const;
 
         void init(void *data, uint32_t size, uint32_t elementSize = 1, BufferType type = BufferType::VERTEX_BUFFER, bool dynamic = false);
         void setData(void *data, uint32_t size, uint32_t offset = 0);
 
+        //streaming buffer for data that is rewritten every frame, split into frameCount regions
+        //uses persistent mapping with a fence per region if buffer storage is available, otherwise orphaning
+        //the id changes when the buffer grows, vertex arrays using it need to be updated
+        void initStream(uint32_t size, uint32_t elementSize = 1, BufferType type = BufferType::VERTEX_BUFFER, int frameCount = 3);
+        //returns the memory to write size bytes into, waits until the GPU is done with the region
+        void* mapStream(uint32_t size);
+        void unmapStream();
+        //call after the draw calls that read the region
+        void fenceStream();
+        //offset in bytes of the mapped region
+        uint32_t getStreamOffset() const;
+
     private:
         uint32_t id;
         uint32_t size;
@@ -32,6 +46,16 @@ namespace baseline {
         uint32_t elementSize;
         bool dynamic;
         BufferType type;
+
+        bool streaming;
+        bool persistent;
+        int frame;
+        uint32_t regionSize;
+        void* mapping;
+        std::vector<void*> fences;
+
+        void growStream(uint32_t size);
+        void clearStream();
     };
 
 }
@@ -3,6 +3,7 @@
 //
 
 #include "FrameBuffer.h"
+#include "RenderState.h"
 #include "GL/glew.h"
 #include "GLFW/glfw3.h"
 #include <algorithm>
@@ -33,51 +34,56 @@ namespace baseline {
 
     FrameBuffer::~FrameBuffer() {
         if(id != 0){
+            RenderState::get().removeFrameBuffer(id);
             glDeleteFramebuffers(1, &id);
             id = 0;
         }
     }
 
-    static uint32_t currentFrameBufferId = 0;
-
     void bindFrameBuffer(uint32_t id){
-        if(currentFrameBufferId != id){
-            glBindFramebuffer(GL_FRAMEBUFFER, id);
-            currentFrameBufferId = id;
-        }
+        RenderState::get().bindFrameBuffer(id);
     }
 
     void FrameBuffer::bind() const {
-        if(currentFrameBufferId != id) {
-            bindFrameBuffer(id);
-            glViewport(0, 0, width, height);
+        RenderState &state = RenderState::get();
+        bool bound = state.getFrameBuffer() == id;
+        bindFrameBuffer(id);
 
-            std::vector<GLenum> drawBuffers;
-            for(auto &attachment : attachments){
-                if(attachment.second.texture.get() != nullptr) {
-                    if (attachment.first >= (int)TextureAttachment::COLOR && attachment.first < (int)TextureAttachment::COLOR + 16) {
-                        if(attachment.second.texture->getWidth() != width || attachment.second.texture->getHeight() != height){
-                            glViewport(0, 0, attachment.second.texture->getWidth(), attachment.second.texture->getHeight());
-                        }
+        //the viewport is also set if the frame buffer was already bound by setAttachment or resize
+        int viewportWidth = width;
+        int viewportHeight = height;
+        std::vector<GLenum> drawBuffers;
+        for(auto &attachment : attachments){
+            if(attachment.second.texture.get() != nullptr) {
+                if (attachment.first >= (int)TextureAttachment::COLOR && attachment.first < (int)TextureAttachment::COLOR + 16) {
+                    if(attachment.second.texture->getWidth() != width || attachment.second.texture->getHeight() != height){
+                        viewportWidth = attachment.second.texture->getWidth();
+                        viewportHeight = attachment.second.texture->getHeight();
+                    }
+                    if(!bound){
                         drawBuffers.push_back(internalEnum((TextureAttachment)attachment.first));
                     }
                 }
             }
+        }
+        state.setViewport(0, 0, viewportWidth, viewportHeight);
+        if(!bound){
             std::sort(drawBuffers.begin(), drawBuffers.end());
             glDrawBuffers(drawBuffers.size(), drawBuffers.data());
         }
     }
 
     void FrameBuffer::unbind() {
-        if(currentFrameBufferId != 0) {
+        if(RenderState::get().getFrameBuffer() != 0) {
             bindFrameBuffer(0);
             GLFWwindow* window = glfwGetCurrentContext();
             if (window) {
                 int width = 0;
                 int height = 0;
-                glfwGetWindowSize(window, &width, &height);
+                //the viewport is in pixels, which differ from screen coordinates on HiDPI displays
+                glfwGetFramebufferSize(window, &width, &height);
                 if (width != 0 && height != 0) {
-                    glViewport(0, 0, width, height);
+                    RenderState::get().setViewport(0, 0, width, height);
                 }
             }
         }
@@ -232,12 +238,14 @@ namespace baseline {
     }
 
     void FrameBuffer::clear() {
-        uint32_t current = currentFrameBufferId;
+        uint32_t current = RenderState::get().getFrameBuffer();
         bindFrameBuffer(id);
         for(auto &attachment : attachments){
             clear((TextureAttachment)attachment.first);
         }
-        bindFrameBuffer(current);
+        if(current != RenderState::unknown){
+            bindFrameBuffer(current);
+        }
     }
 
     void FrameBuffer::clear(TextureAttachment attachment) {
@@ -254,7 +262,10 @@ namespace baseline {
                 }
 
                 glm::vec4 color = entry->second.spec.clearColor.vec();
-                glDrawBuffer(internalEnum((TextureAttachment)entry->first));
+                //depth and stencil are not draw buffers
+                if (bit == GL_COLOR_BUFFER_BIT) {
+                    glDrawBuffer(internalEnum((TextureAttachment)entry->first));
+                }
                 glClearColor(color.r, color.g, color.b, color.a);
                 glClear(bit);
             }
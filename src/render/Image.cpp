@@ -4,9 +4,11 @@
 
 #include "Image.h"
 #include "common/Log.h"
+#include "common/File.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 #include <algorithm>
+#include <climits>
 
 using namespace baseline;
 
@@ -83,11 +85,22 @@ namespace baseline {
     }
 
     bool Image::load(const std::string &file) {
+        FileView view;
+        if(!view.open(file)){
+            Log::warning("image: no file %s found", file.c_str());
+            return false;
+        }
+        if(view.size() > INT_MAX){
+            Log::warning("image: file %s is too large", file.c_str());
+            return false;
+        }
+
+        //decoded directly from the mapping, the encoded file is not copied
         int x, y, c;
-        stbi_uc *uc = stbi_load(file.c_str(), &x, &y, &c, 0);
+        stbi_uc *uc = stbi_load_from_memory(view.data(), (int)view.size(), &x, &y, &c, 0);
 
         if(uc == nullptr){
-            Log::warning("image: no file %s found", file.c_str());
+            Log::warning("image: could not decode %s", file.c_str());
             return false;
         }
 
@@ -96,10 +109,7 @@ namespace baseline {
         channels = c;
         bitsPerChannel = 8;
 
-        data.resize(width * height * channels);
-        for(int i = 0; i < data.size(); i++){
-            data[i] = uc[i];
-        }
+        data.assign(uc, uc + (size_t)width * height * channels);
         stbi_image_free(uc);
         Log::trace("loaded image %s", file.c_str());
         return true;
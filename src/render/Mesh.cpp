@@ -4,9 +4,17 @@
 
 #include "Mesh.h"
 #include "common/Log.h"
+#include "common/File.h"
+#include "common/strutil.h"
+#include "MeshOptimizer.h"
+#include "core/Singleton.h"
+#include "core/TaskManager.h"
 #include <fstream>
-#include <map>
+#include <filesystem>
 #include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
 
 namespace baseline {
 
@@ -14,13 +22,16 @@ namespace baseline {
         boundingMin = {-0.5, -0.5, -0.5};
         boundingMax = {+0.5, +0.5, +0.5};
         changeCounter = 0;
+        indexType = Type::UINT32;
+        vertexBytes = 0;
+        indexBytes = 0;
     }
 
-    void Mesh::create(float *vertices, int vertexCount, int *indices, int indexCount, std::vector<Attribute> layout, bool keepData) {
+    void Mesh::upload(const void *vertices, uint32_t vertexSize, const void *indices, uint32_t indexSize, Type indexType, std::vector<Attribute> layout) {
         vertexArray.clear();
 
         auto vertexBuffer = std::make_shared<Buffer>();
-        auto indexBuffer = std::make_shared<Buffer>();
+        indexBuffer = std::make_shared<Buffer>();
 
         int stride = 0;
         for(auto &a : layout){
@@ -28,11 +39,36 @@ namespace baseline {
             stride += a.size * a.count;
         }
 
-        vertexBuffer->init(vertices, vertexCount * sizeof(vertices[0]), stride, BufferType::VERTEX_BUFFER, false);
-        indexBuffer->init(indices, indexCount * sizeof(indices[0]), sizeof(indices[0]), BufferType::INDEX_BUFFER, false);
+        vertexBuffer->init((void*)vertices, vertexSize, stride, BufferType::VERTEX_BUFFER, false);
+        indexBuffer->init((void*)indices, indexSize, internalEnumSize(indexType), BufferType::INDEX_BUFFER, false);
 
-        vertexArray.addIndexBuffer(indexBuffer, Type::UINT32);
+        vertexArray.addIndexBuffer(indexBuffer, indexType);
         vertexArray.addVertexBuffer(vertexBuffer, layout);
+        this->indexType = indexType;
+        vertexBytes = vertexSize;
+        indexBytes = indexSize;
+    }
+
+    void Mesh::uploadIndices() {
+        std::vector<int> indices = indexData;
+        indices.insert(indices.end(), lodIndexData.begin(), lodIndexData.end());
+
+        //the vertex array keeps the buffer, it has to be unbound so the buffer is not attached to another vertex array
+        VertexArray::unbind();
+        if(indexType == Type::UINT16){
+            std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+            indexBuffer->init(shortIndices.data(), shortIndices.size() * sizeof(uint16_t), sizeof(uint16_t), BufferType::INDEX_BUFFER, false);
+            indexBytes = shortIndices.size() * sizeof(uint16_t);
+        }else{
+            indexBuffer->init(indices.data(), indices.size() * sizeof(int), sizeof(int), BufferType::INDEX_BUFFER, false);
+            indexBytes = indices.size() * sizeof(int);
+        }
+    }
+
+    void Mesh::create(float *vertices, int vertexCount, int *indices, int indexCount, std::vector<Attribute> layout, bool keepData) {
+        upload(vertices, vertexCount * sizeof(vertices[0]), indices, indexCount * sizeof(indices[0]), Type::UINT32, layout);
+        lods = { Lod{ 0, (uint32_t)indexCount, 0 } };
+        lodIndexData.clear();
 
         if (keepData) {
             vertexData.clear();
@@ -43,216 +79,540 @@ namespace baseline {
         changeCounter++;
     }
 
-    std::vector<std::string> split(const std::string &str, char delimiter = ' '){
-        std::vector<std::string> result;
-        result.push_back("");
-        for(char c : str){
-            if(c == delimiter){
-                if(result.back() != ""){
-                    result.push_back("");
+    Mesh::OptimizeStats Mesh::optimize(bool quantize) {
+        const int stride = 3 + 3 + 2;
+        OptimizeStats stats;
+        if(vertexData.empty() || vertexData.size() % stride != 0){
+            Log::warning("mesh: optimize needs the vertex data in the default layout");
+            return stats;
+        }
+
+        int vertexCount = vertexData.size() / stride;
+        stats.acmrBefore = getCacheMissRatio(indexData, vertexCount);
+        stats.vertexBytesBefore = vertexBytes;
+        stats.indexBytesBefore = indexBytes;
+
+        //every lod is ordered for the cache and then for overdraw, the vertex order follows the full mesh
+        optimizeVertexCache(indexData, vertexCount);
+        optimizeOverdraw(indexData, vertexData.data(), stride, vertexCount);
+        for(int i = 1; i < lods.size(); i++){
+            auto begin = lodIndexData.begin() + (lods[i].indexOffset - indexData.size());
+            std::vector<int> indices(begin, begin + lods[i].indexCount);
+            optimizeVertexCache(indices, vertexCount);
+            optimizeOverdraw(indices, vertexData.data(), stride, vertexCount);
+            std::copy(indices.begin(), indices.end(), begin);
+        }
+        std::vector<int> indices = indexData;
+        indices.insert(indices.end(), lodIndexData.begin(), lodIndexData.end());
+        std::vector<int> remap;
+        int usedCount = optimizeVertexFetch(indices, vertexCount, remap);
+        std::copy(indices.begin(), indices.begin() + indexData.size(), indexData.begin());
+        std::copy(indices.begin() + indexData.size(), indices.end(), lodIndexData.begin());
+        std::vector<float> vertices(usedCount * stride);
+        for(int i = 0; i < vertexCount; i++){
+            if(remap[i] != -1){
+                memcpy(&vertices[remap[i] * stride], &vertexData[i * stride], stride * sizeof(float));
+            }
+        }
+        vertexData.swap(vertices);
+        vertexCount = usedCount;
+        stats.acmrAfter = getCacheMissRatio(indexData, vertexCount);
+
+        //positions stay floats, normals are signed normalized bytes
+        //texture coordinates are unsigned normalized 16 bit values if they are all in [0, 1]
+        std::vector<uint8_t> packed;
+        std::vector<Attribute> layout = { {Type::FLOAT, 3}, {Type::FLOAT, 3}, {Type::FLOAT, 2} };
+        const void *vertexSource = vertexData.data();
+        uint32_t vertexSize = vertexData.size() * sizeof(float);
+        if(quantize){
+            bool unitCoordinates = true;
+            for(int i = 0; i < vertexCount; i++){
+                float u = vertexData[i * stride + 6];
+                float v = vertexData[i * stride + 7];
+                if(u < 0 || u > 1 || v < 0 || v > 1){
+                    unitCoordinates = false;
+                    break;
+                }
+            }
+
+            uint32_t packedStride = 12 + 4 + (unitCoordinates ? 4 : 8);
+            packed.resize(vertexCount * packedStride);
+            for(int i = 0; i < vertexCount; i++){
+                const float *source = &vertexData[i * stride];
+                uint8_t *target = &packed[i * packedStride];
+                memcpy(target, source, 12);
+                int8_t normal[4] = {};
+                for(int j = 0; j < 3; j++){
+                    normal[j] = (int8_t)std::round(std::clamp(source[3 + j], -1.0f, 1.0f) * 127.0f);
+                }
+                memcpy(target + 12, normal, 4);
+                if(unitCoordinates){
+                    uint16_t coordinates[2];
+                    for(int j = 0; j < 2; j++){
+                        coordinates[j] = (uint16_t)std::round(source[6 + j] * 65535.0f);
+                    }
+                    memcpy(target + 16, coordinates, 4);
+                }else{
+                    memcpy(target + 16, source + 6, 8);
                 }
-            }else{
-                result.back() += c;
             }
+
+            layout = { {Type::FLOAT, 3}, {Type::INT8, 4, true}, unitCoordinates ? Attribute(Type::UINT16, 2, true) : Attribute(Type::FLOAT, 2) };
+            vertexSource = packed.data();
+            vertexSize = packed.size();
         }
-        if(result.back() == ""){
-            result.pop_back();
+
+        if(vertexCount <= 0x10000){
+            std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+            upload(vertexSource, vertexSize, shortIndices.data(), shortIndices.size() * sizeof(uint16_t), Type::UINT16, layout);
+        }else{
+            upload(vertexSource, vertexSize, indices.data(), indices.size() * sizeof(int), Type::UINT32, layout);
         }
-        return result;
+        changeCounter++;
+
+        stats.vertexBytesAfter = vertexBytes;
+        stats.indexBytesAfter = indexBytes;
+        Log::trace("optimized mesh: acmr %.3f -> %.3f, vertex buffer %u -> %u bytes, index buffer %u -> %u bytes",
+            stats.acmrBefore, stats.acmrAfter, stats.vertexBytesBefore, stats.vertexBytesAfter, stats.indexBytesBefore, stats.indexBytesAfter);
+        return stats;
     }
 
-    bool Mesh::load(const std::string &file) {
-        std::ifstream stream;
-        stream.open(file);
+    void Mesh::generateLods(int lodCount, float reduction) {
+        const int stride = 3 + 3 + 2;
+        if(indexData.empty() || vertexData.empty() || vertexData.size() % stride != 0){
+            Log::warning("mesh: generating lods needs the vertex data in the default layout");
+            return;
+        }
+        int vertexCount = vertexData.size() / stride;
+
+        //each lod is simplified from the previous one, so the errors add up
+        lods = { Lod{ 0, (uint32_t)indexData.size(), 0 } };
+        lodIndexData.clear();
+        std::vector<int> indices = indexData;
+        float error = 0;
+        for(int i = 0; i < lodCount; i++){
+            uint32_t previousCount = indices.size();
+            int targetCount = (int)(previousCount / 3 * reduction) * 3;
+            error += simplifyMesh(indices, vertexData.data(), stride, vertexCount, targetCount, FLT_MAX);
+            //not worth a lod if the mesh got less than half as small as asked for
+            if(indices.empty() || indices.size() > previousCount * (1.0f + reduction) * 0.5f){
+                break;
+            }
+            optimizeVertexCache(indices, vertexCount);
+            lods.push_back({ (uint32_t)(indexData.size() + lodIndexData.size()), (uint32_t)indices.size(), error });
+            lodIndexData.insert(lodIndexData.end(), indices.begin(), indices.end());
+        }
+
+        uploadIndices();
+        changeCounter++;
+        for(int i = 1; i < lods.size(); i++){
+            Log::trace("mesh lod %i: %i triangles, error %f", i, lods[i].indexCount / 3, lods[i].error);
+        }
+    }
+
+    const std::vector<Mesh::Lod>& Mesh::getLods() {
+        return lods;
+    }
 
+    int Mesh::selectLod(float maxError) {
+        for(int i = (int)lods.size() - 1; i > 0; i--){
+            if(lods[i].error <= maxError){
+                return i;
+            }
+        }
+        return 0;
+    }
+
+    int Mesh::selectLod(float distance, float fovY, float screenHeight, float maxPixelError, float scale) {
+        if(distance <= 0 || screenHeight <= 0 || scale <= 0){
+            return 0;
+        }
+        //size of one pixel in object space at the distance
+        float pixelSize = 2.0f * distance * std::tan(fovY * 0.5f) / screenHeight / scale;
+        return selectLod(maxPixelError * pixelSize);
+    }
+
+    void Mesh::submit(int lod, int instanceCount) {
+        if(lods.empty()){
+            vertexArray.submit(-1, instanceCount);
+            return;
+        }
+        lod = std::clamp(lod, 0, (int)lods.size() - 1);
+        vertexArray.submit(lods[lod].indexCount, instanceCount, 0, lods[lod].indexOffset);
+    }
+
+    template<typename T>
+    static T parseValue(std::string_view str, T defaultValue = 0){
+        T value = defaultValue;
+        parseNumber(str, value);
+        return value;
+    }
+
+    static uint64_t getTimestamp(const std::string &file) {
+        std::error_code error;
+        auto time = std::filesystem::last_write_time(file, error);
+        if(error){
+            return 0;
+        }
+        return time.time_since_epoch().count();
+    }
+
+    class ObjIndex {
+    public:
+        int v = -1;
+        int n = -1;
+        int t = -1;
+
+        bool operator==(const ObjIndex &i) const {
+            return v == i.v && n == i.n && t == i.t;
+        }
+    };
+
+    //lines of an obj file parsed by one thread, indices in the file are global so chunks are simply appended
+    class ObjChunk {
+    public:
+        std::string_view text;
         std::vector<float> vs;
         std::vector<float> ns;
         std::vector<float> ts;
-        bool faceWarning = false;
-
-        struct Index{
-            int v = -1;
-            int n = -1;
-            int t = -1;
-
-            bool operator<(const Index &i) const{
-                if(v != i.v){
-                    return v < i.v;
+        std::vector<ObjIndex> is;
+        bool polygons = false;
+    };
+
+    static void parseObj(ObjChunk &chunk) {
+        std::vector<std::string_view> parts;
+        const char *next = chunk.text.data();
+        const char *end = next + chunk.text.size();
+        while(next < end){
+            const char *lineEnd = (const char*)memchr(next, '\n', end - next);
+            if(!lineEnd){
+                lineEnd = end;
+            }
+            const char *c = next;
+            next = lineEnd + 1;
+
+            //tokens separated by spaces or tabs
+            parts.clear();
+            while(c < lineEnd){
+                while(c < lineEnd && (*c == ' ' || *c == '\t' || *c == '\r')){
+                    c++;
                 }
-                if(n != i.n){
-                    return n < i.n;
+                const char *token = c;
+                while(c < lineEnd && *c != ' ' && *c != '\t' && *c != '\r'){
+                    c++;
                 }
-                if(t != i.t){
-                    return t < i.t;
+                if(c != token){
+                    parts.emplace_back(token, c - token);
                 }
-                return false;
             }
-        };
-        std::vector<Index> is;
-
-        if(stream.is_open()){
-            std::string line;
-            while(std::getline(stream, line)){
-                std::vector<std::string> parts = split(line, ' ');
-                if (parts.size() > 0) {
-                    if (parts[0] == "v") {
-                        for (int i = 0; i < 3; i++) {
-                            if (parts.size() > i + 1) {
-                                try {
-                                    vs.push_back(std::stof(parts[i + 1]));
-                                }
-                                catch (...) {}
-                            }
-                            else {
-                                vs.push_back(0);
-                            }
-                        }
+            if (parts.size() > 0) {
+                if (parts[0] == "v") {
+                    for (int i = 0; i < 3; i++) {
+                        chunk.vs.push_back(parts.size() > i + 1 ? parseValue<float>(parts[i + 1]) : 0);
                     }
-                    else if (parts[0] == "vn") {
-                        for (int i = 0; i < 3; i++) {
-                            if (parts.size() > i + 1) {
-                                try {
-                                    ns.push_back(std::stof(parts[i + 1]));
-                                }
-                                catch (...) {}
-                            }
-                            else {
-                                ns.push_back(0);
-                            }
-                        }
+                }
+                else if (parts[0] == "vn") {
+                    for (int i = 0; i < 3; i++) {
+                        chunk.ns.push_back(parts.size() > i + 1 ? parseValue<float>(parts[i + 1]) : 0);
                     }
-                    else if (parts[0] == "vt") {
-                        for (int i = 0; i < 2; i++) {
-                            if (parts.size() > i + 1) {
-                                try {
-                                    ts.push_back(std::stof(parts[i + 1]));
-                                }
-                                catch (...) {}
-                            }
-                            else {
-                                ts.push_back(0);
-                            }
-                        }
+                }
+                else if (parts[0] == "vt") {
+                    for (int i = 0; i < 2; i++) {
+                        chunk.ts.push_back(parts.size() > i + 1 ? parseValue<float>(parts[i + 1]) : 0);
                     }
-                    else if (parts[0] == "f") {
-                        for (int i = 1; i < parts.size(); i++) {
-                            std::vector<std::string> parts2 = split(parts[i], '/');
-
-                            is.push_back({});
-                            if (parts2.size() > 0) {
-                                try {
-                                    is.back().v = std::stof(parts2[0]) - 1;
-                                }
-                                catch (...) {}
-                            }
-                            if (parts2.size() > 1) {
-                                try {
-                                    is.back().t = std::stof(parts2[1]) - 1;
-                                }
-                                catch (...) {}
-                            }
-                            else {
-                                is.back().t = is.back().v;
-                            }
-                            if (parts2.size() > 2) {
-                                try {
-                                    is.back().n = std::stof(parts2[2]) - 1;
-                                }
-                                catch (...) {}
-                            }
-                            else {
-                                is.back().n = is.back().v;
+                }
+                else if (parts[0] == "f") {
+                    for (int i = 1; i < parts.size(); i++) {
+                        //v, v/t, v//n or v/t/n
+                        std::string_view parts2[3];
+                        int count = 0;
+                        std::string_view part = parts[i];
+                        while(count < 3){
+                            size_t slash = part.find('/');
+                            parts2[count++] = part.substr(0, slash);
+                            if(slash == std::string_view::npos){
+                                break;
                             }
+                            part.remove_prefix(slash + 1);
                         }
-                        if(parts.size() - 1 >= 4){
-                            if(!faceWarning){
-                                Log::warning("mesh %s: only triangle faces are supported", file.c_str());
-                                faceWarning = true;
-                            }
+
+                        ObjIndex index;
+                        if (count > 0) {
+                            index.v = parseValue<int>(parts2[0]) - 1;
+                        }
+                        if (count > 1) {
+                            index.t = parseValue<int>(parts2[1]) - 1;
+                        }
+                        else {
+                            index.t = index.v;
+                        }
+                        if (count > 2) {
+                            index.n = parseValue<int>(parts2[2]) - 1;
                         }
+                        else {
+                            index.n = index.v;
+                        }
+                        chunk.is.push_back(index);
+                    }
+                    if(parts.size() - 1 >= 4){
+                        chunk.polygons = true;
                     }
                 }
             }
+        }
+    }
+
+    template<typename T>
+    static void append(std::vector<T> &target, const std::vector<T> &source) {
+        target.insert(target.end(), source.begin(), source.end());
+    }
+
+    bool Mesh::load(const std::string &file, bool useCache, int lodCount) {
+        //the file is mapped and parsed in place, lines and tokens are views into the mapping
+        FileView view;
+        view.open(file);
+        if(!view.isOpen()){
+            Log::warning("mesh: file %s not found", file.c_str());
+            return false;
+        }
 
-            if(vs.size() == 0 && is.size() == 0){
-                return false;
+        std::string cacheFile = file + ".mesh";
+        uint64_t timestamp = getTimestamp(file);
+        int cachedLodCount = 0;
+        if(useCache && loadCache(cacheFile, timestamp, view.size(), cachedLodCount)){
+            if(lodCount > 0 && cachedLodCount != lodCount){
+                generateLods(lodCount);
+                saveCache(cacheFile, timestamp, view.size(), lodCount);
             }
+            Log::trace("loaded mesh %s from cache", file.c_str());
+            return true;
+        }
 
-            std::map<Index, int> map;
+        //split at line ends into one chunk per TaskManager worker and the calling thread, small files are parsed on the calling thread
+        std::string_view text = view.view();
+        const size_t minChunkSize = 1024 * 1024;
+        auto* taskManager = Singleton::get<TaskManager>();
+        int chunkCount = (int)std::max<size_t>(1, std::min<size_t>(taskManager->getWorkerCount() + 1, text.size() / minChunkSize));
+        std::vector<ObjChunk> chunks(chunkCount);
+        size_t begin = 0;
+        for(int i = 0; i < chunkCount; i++){
+            size_t end = text.size();
+            if(i != chunkCount - 1){
+                end = text.find('\n', std::max(begin, text.size() * (i + 1) / chunkCount));
+                end = end == std::string_view::npos ? text.size() : end + 1;
+            }
+            chunks[i].text = text.substr(begin, end - begin);
+            begin = end;
+        }
 
-            indexData.clear();
-            vertexData.clear();
+        std::vector<int> tasks;
+        for(int i = 1; i < chunkCount; i++){
+            tasks.push_back(taskManager->addTask([&chunks, i]() {
+                parseObj(chunks[i]);
+            }, TaskType::NORMAL, "parse mesh"));
+        }
+        parseObj(chunks[0]);
+        for(int task : tasks){
+            taskManager->joinTask(task);
+        }
 
-            boundingMin = {0, 0, 0};
-            boundingMax = {0, 0, 0};
+        std::vector<float> &vs = chunks[0].vs;
+        std::vector<float> &ns = chunks[0].ns;
+        std::vector<float> &ts = chunks[0].ts;
+        std::vector<ObjIndex> &is = chunks[0].is;
+        bool polygons = chunks[0].polygons;
+        for(int i = 1; i < chunkCount; i++){
+            append(vs, chunks[i].vs);
+            append(ns, chunks[i].ns);
+            append(ts, chunks[i].ts);
+            append(is, chunks[i].is);
+            polygons |= chunks[i].polygons;
+        }
+        if(polygons){
+            Log::warning("mesh %s: only triangle faces are supported", file.c_str());
+        }
 
-            for(auto &i : is){
-                auto entry = map.find(i);
-                int index = 0;
-                if(entry == map.end()){
-                    index = map.size();
-                    map[i] = index;
+        if(vs.size() == 0 && is.size() == 0){
+            return false;
+        }
 
-                    if(i.v != -1 && vs.size() > i.v * 3 + 2){
+        //open addressing table from obj index to vertex index, vertices are numbered in order of first use
+        uint32_t tableSize = 16;
+        while(tableSize < is.size() * 2){
+            tableSize *= 2;
+        }
+        std::vector<int> table(tableSize, -1);
+        std::vector<ObjIndex> vertices;
 
-                        float x = vs[i.v * 3 + 0];
-                        float y = vs[i.v * 3 + 1];
-                        float z = vs[i.v * 3 + 2];
+        indexData.clear();
+        vertexData.clear();
+        indexData.reserve(is.size());
 
-                        if(index == 0){
-                            boundingMin = {x, y, z};
-                            boundingMax = {x, y, z};
-                        }
+        boundingMin = {0, 0, 0};
+        boundingMax = {0, 0, 0};
 
-                        boundingMin.x = std::min(x, boundingMin.x);
-                        boundingMin.y = std::min(y, boundingMin.y);
-                        boundingMin.z = std::min(z, boundingMin.z);
-
-                        boundingMax.x = std::max(x, boundingMax.x);
-                        boundingMax.y = std::max(y, boundingMax.y);
-                        boundingMax.z = std::max(z, boundingMax.z);
-
-                        vertexData.push_back(x);
-                        vertexData.push_back(y);
-                        vertexData.push_back(z);
-                    }else{
-                        vertexData.push_back(0);
-                        vertexData.push_back(0);
-                        vertexData.push_back(0);
-                    }
+        for(auto &i : is){
+            uint32_t hash = (uint32_t)i.v * 73856093u ^ (uint32_t)i.n * 19349663u ^ (uint32_t)i.t * 83492791u;
+            uint32_t slot = (hash ^ (hash >> 16)) & (tableSize - 1);
+            while(table[slot] != -1 && !(vertices[table[slot]] == i)){
+                slot = (slot + 1) & (tableSize - 1);
+            }
 
+            int index = table[slot];
+            if(index == -1){
+                index = vertices.size();
+                table[slot] = index;
+                vertices.push_back(i);
 
-                    if(i.n != -1 && ns.size() > i.n * 3 + 2){
-                        vertexData.push_back(ns[i.n * 3 + 0]);
-                        vertexData.push_back(ns[i.n * 3 + 1]);
-                        vertexData.push_back(ns[i.n * 3 + 2]);
-                    }else{
-                        vertexData.push_back(0);
-                        vertexData.push_back(0);
-                        vertexData.push_back(0);
-                    }
+                if(i.v != -1 && vs.size() > i.v * 3 + 2){
+
+                    float x = vs[i.v * 3 + 0];
+                    float y = vs[i.v * 3 + 1];
+                    float z = vs[i.v * 3 + 2];
 
-                    if(i.t != -1 && ts.size() > i.t * 2 + 1){
-                        vertexData.push_back(ts[i.t * 2 + 0]);
-                        vertexData.push_back(ts[i.t * 2 + 1]);
-                    }else{
-                        vertexData.push_back(0);
-                        vertexData.push_back(0);
+                    if(index == 0){
+                        boundingMin = {x, y, z};
+                        boundingMax = {x, y, z};
                     }
 
+                    boundingMin.x = std::min(x, boundingMin.x);
+                    boundingMin.y = std::min(y, boundingMin.y);
+                    boundingMin.z = std::min(z, boundingMin.z);
+
+                    boundingMax.x = std::max(x, boundingMax.x);
+                    boundingMax.y = std::max(y, boundingMax.y);
+                    boundingMax.z = std::max(z, boundingMax.z);
+
+                    vertexData.push_back(x);
+                    vertexData.push_back(y);
+                    vertexData.push_back(z);
+                }else{
+                    vertexData.push_back(0);
+                    vertexData.push_back(0);
+                    vertexData.push_back(0);
+                }
+
+
+                if(i.n != -1 && ns.size() > i.n * 3 + 2){
+                    vertexData.push_back(ns[i.n * 3 + 0]);
+                    vertexData.push_back(ns[i.n * 3 + 1]);
+                    vertexData.push_back(ns[i.n * 3 + 2]);
                 }else{
-                    index = entry->second;
+                    vertexData.push_back(0);
+                    vertexData.push_back(0);
+                    vertexData.push_back(0);
+                }
+
+                if(i.t != -1 && ts.size() > i.t * 2 + 1){
+                    vertexData.push_back(ts[i.t * 2 + 0]);
+                    vertexData.push_back(ts[i.t * 2 + 1]);
+                }else{
+                    vertexData.push_back(0);
+                    vertexData.push_back(0);
                 }
-                indexData.push_back(index);
             }
+            indexData.push_back(index);
+        }
 
-            create(vertexData.data(), vertexData.size(), indexData.data(), indexData.size(), { {Type::FLOAT, 3}, {Type::FLOAT, 3}, {Type::FLOAT, 2} });
-            Log::trace("loaded mesh %s", file.c_str());
-            return true;
-        }else{
-            Log::warning("mesh: file %s not found", file.c_str());
+        create(vertexData.data(), vertexData.size(), indexData.data(), indexData.size(), { {Type::FLOAT, 3}, {Type::FLOAT, 3}, {Type::FLOAT, 2} });
+        if(lodCount > 0){
+            generateLods(lodCount);
+        }
+        if(useCache){
+            saveCache(cacheFile, timestamp, view.size(), lodCount);
+        }
+        Log::trace("loaded mesh %s", file.c_str());
+        return true;
+    }
+
+    //header of a mesh cache file, followed by the vertex floats, the indices, the lod table and the lod indices
+    class MeshCacheHeader {
+    public:
+        //version 3 stores the measured lod error instead of the quadric error
+        static constexpr uint32_t currentVersion = 3;
+
+        char magic[4];
+        uint32_t version;
+        uint64_t sourceTimestamp;
+        uint64_t sourceSize;
+        uint32_t vertexDataCount;
+        uint32_t indexCount;
+        glm::vec3 boundingMin;
+        glm::vec3 boundingMax;
+        //lod count that was asked for, fewer lods are stored when the mesh could not be simplified further
+        uint32_t requestedLodCount;
+        uint32_t lodCount;
+        uint32_t lodIndexCount;
+    };
+
+    bool Mesh::loadCache(const std::string &file, uint64_t sourceTimestamp, uint64_t sourceSize, int &lodCount) {
+        FileView view;
+        if(!view.open(file) || view.size() < sizeof(MeshCacheHeader)){
+            return false;
+        }
+
+        MeshCacheHeader header;
+        memcpy(&header, view.data(), sizeof(header));
+        if(memcmp(header.magic, "BLMC", 4) != 0 || header.version != MeshCacheHeader::currentVersion){
+            return false;
+        }
+        //a changed obj file or an incomplete write invalidates the cache
+        if(header.sourceTimestamp != sourceTimestamp || header.sourceSize != sourceSize){
+            return false;
+        }
+        uint64_t expectedSize = sizeof(header) + (uint64_t)header.vertexDataCount * sizeof(float) + (uint64_t)header.indexCount * sizeof(int);
+        expectedSize += (uint64_t)header.lodCount * sizeof(Lod) + (uint64_t)header.lodIndexCount * sizeof(int);
+        if(view.size() != expectedSize){
+            return false;
+        }
+
+        const uint8_t *data = view.data() + sizeof(header);
+        vertexData.assign((const float*)data, (const float*)data + header.vertexDataCount);
+        data += header.vertexDataCount * sizeof(float);
+        indexData.assign((const int*)data, (const int*)data + header.indexCount);
+        data += header.indexCount * sizeof(int);
+        boundingMin = header.boundingMin;
+        boundingMax = header.boundingMax;
+
+        create(vertexData.data(), vertexData.size(), indexData.data(), indexData.size(), { {Type::FLOAT, 3}, {Type::FLOAT, 3}, {Type::FLOAT, 2} });
+        if(header.lodCount > 0){
+            lods.resize(header.lodCount);
+            memcpy(lods.data(), data, header.lodCount * sizeof(Lod));
+            data += header.lodCount * sizeof(Lod);
+            lodIndexData.assign((const int*)data, (const int*)data + header.lodIndexCount);
+            uploadIndices();
+        }
+        lodCount = header.requestedLodCount;
+        return true;
+    }
+
+    void Mesh::saveCache(const std::string &file, uint64_t sourceTimestamp, uint64_t sourceSize, int lodCount) {
+        MeshCacheHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, "BLMC", 4);
+        header.version = MeshCacheHeader::currentVersion;
+        header.sourceTimestamp = sourceTimestamp;
+        header.sourceSize = sourceSize;
+        header.vertexDataCount = vertexData.size();
+        header.indexCount = indexData.size();
+        header.boundingMin = boundingMin;
+        header.boundingMax = boundingMax;
+        header.requestedLodCount = lodCount;
+        header.lodCount = lods.size();
+        header.lodIndexCount = lodIndexData.size();
+
+        std::string data;
+        data.reserve(sizeof(header) + vertexData.size() * sizeof(float) + (indexData.size() + lodIndexData.size()) * sizeof(int) + lods.size() * sizeof(Lod));
+        data.append((const char*)&header, sizeof(header));
+        data.append((const char*)vertexData.data(), vertexData.size() * sizeof(float));
+        data.append((const char*)indexData.data(), indexData.size() * sizeof(int));
+        data.append((const char*)lods.data(), lods.size() * sizeof(Lod));
+        data.append((const char*)lodIndexData.data(), lodIndexData.size() * sizeof(int));
+
+        //written to a temporary file and renamed, a reader never maps a partially written cache
+        if(!writeFile(file, data, true)){
+            Log::trace("mesh: could not write cache file %s", file.c_str());
         }
-        return false;
     }
 
     bool Mesh::save(const std::string& file) {
@@ -12,12 +12,55 @@ namespace baseline {
 
     class Mesh {
     public:
+        class OptimizeStats {
+        public:
+            //average cache miss ratio, transformed vertices per triangle with a 16 entry fifo cache
+            float acmrBefore = 0;
+            float acmrAfter = 0;
+            uint32_t vertexBytesBefore = 0;
+            uint32_t vertexBytesAfter = 0;
+            uint32_t indexBytesBefore = 0;
+            uint32_t indexBytesAfter = 0;
+        };
+
+        //index range of a level of detail, all lods share the vertex buffer
+        class Lod {
+        public:
+            uint32_t indexOffset = 0;
+            uint32_t indexCount = 0;
+            //largest distance of a removed vertex to the lod in object space, summed over the lods it was simplified from
+            //measured at the vertices only, so points inside the triangles can deviate a bit more
+            float error = 0;
+        };
+
         Mesh();
 
-        bool load(const std::string &file);
+        //obj files, large files are parsed on multiple threads
+        //with useCache the result is stored in file.mesh and loaded from there while the obj file is unchanged
+        //with lodCount the lods are generated after loading and stored in the cache as well
+        bool load(const std::string &file, bool useCache = true, int lodCount = 0);
         bool save(const std::string& file);
         void create(float *vertices, int vertexCount, int *indices, int indexCount, std::vector<Attribute> layout = {{Type::FLOAT, 3}, {Type::FLOAT, 3}, {Type::FLOAT, 2}}, bool keepData = false);
 
+        //reorders the triangles for the post transform vertex cache and then clusters of them against overdraw,
+        //the vertices are reordered for fetch locality,
+        //uses 16 bit indices when possible and with quantize packs normals into bytes and texture coordinates into 16 bits
+        //needs the vertex data in the default layout, it is kept by load and by create with keepData
+        OptimizeStats optimize(bool quantize = true);
+
+        //simplifies the mesh by quadric edge collapse, each lod has about reduction times the triangles of the previous one
+        //stops early when the mesh can not be reduced further, the index buffer contains all lods afterwards
+        void generateLods(int lodCount = 4, float reduction = 0.5f);
+        //lod 0 is the full mesh
+        const std::vector<Lod>& getLods();
+        //the coarsest lod with an error of at most maxError in object space
+        int selectLod(float maxError);
+        //the coarsest lod with an error of at most maxPixelError on the screen for an instance at a distance with a perspective projection
+        //the error is measured at the removed vertices, it is not a strict bound for the whole surface
+        int selectLod(float distance, float fovY, float screenHeight, float maxPixelError = 1.0f, float scale = 1.0f);
+        //draws a lod, use instead of vertexArray.submit() when the mesh has lods
+        void submit(int lod = 0, int instanceCount = -1);
+
         const std::vector<float>& getVertexData() { return vertexData; }
         const std::vector<int>& getIndexData() { return indexData; }
 
@@ -28,6 +71,19 @@ namespace baseline {
     private:
         std::vector<float> vertexData;
         std::vector<int> indexData;
+        //indices of the lods after the first one, their offsets continue after indexData
+        std::vector<int> lodIndexData;
+        std::vector<Lod> lods;
+        std::shared_ptr<Buffer> indexBuffer;
+        Type indexType;
+        uint32_t vertexBytes;
+        uint32_t indexBytes;
+
+        void upload(const void *vertices, uint32_t vertexSize, const void *indices, uint32_t indexSize, Type indexType, std::vector<Attribute> layout);
+        //uploads the indices of all lods into the index buffer with the current index type
+        void uploadIndices();
+        bool loadCache(const std::string &file, uint64_t sourceTimestamp, uint64_t sourceSize, int &lodCount);
+        void saveCache(const std::string &file, uint64_t sourceTimestamp, uint64_t sourceSize, int lodCount);
     };
 
 }
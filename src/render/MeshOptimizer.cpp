@@ -0,0 +1,643 @@
+//
+// Copyright (c) 2024 Julian Hinxlage. All rights reserved.
+//
+
+#include "MeshOptimizer.h"
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+
+namespace baseline {
+
+    float getCacheMissRatio(const std::vector<int> &indices, int vertexCount, int cacheSize) {
+        int triangleCount = (int)indices.size() / 3;
+        if (triangleCount == 0) {
+            return 0;
+        }
+
+        //a vertex is in the cache until cacheSize other vertices were added after it
+        std::vector<int> cachedAt(vertexCount, -1);
+        int misses = 0;
+        for (int index : indices) {
+            if (index < 0 || index >= vertexCount) {
+                continue;
+            }
+            if (cachedAt[index] == -1 || misses - cachedAt[index] >= cacheSize) {
+                cachedAt[index] = misses;
+                misses++;
+            }
+        }
+        return (float)misses / (float)triangleCount;
+    }
+
+    void optimizeVertexCache(std::vector<int> &indices, int vertexCount, int cacheSize) {
+        int triangleCount = (int)indices.size() / 3;
+        std::vector<int> result;
+        result.reserve(indices.size());
+
+        //triangles of each vertex, triangles with invalid indices are kept at the end in their order
+        std::vector<int> offsets(vertexCount + 1, 0);
+        std::vector<bool> valid(triangleCount, true);
+        for (int t = 0; t < triangleCount; t++) {
+            for (int i = 0; i < 3; i++) {
+                int index = indices[t * 3 + i];
+                if (index < 0 || index >= vertexCount) {
+                    valid[t] = false;
+                }
+            }
+            if (valid[t]) {
+                for (int i = 0; i < 3; i++) {
+                    offsets[indices[t * 3 + i] + 1]++;
+                }
+            }
+        }
+        for (int v = 0; v < vertexCount; v++) {
+            offsets[v + 1] += offsets[v];
+        }
+        std::vector<int> adjacency(offsets[vertexCount]);
+        std::vector<int> live(vertexCount);
+        for (int v = 0; v < vertexCount; v++) {
+            live[v] = offsets[v + 1] - offsets[v];
+        }
+        std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+        for (int t = 0; t < triangleCount; t++) {
+            if (valid[t]) {
+                for (int i = 0; i < 3; i++) {
+                    adjacency[fill[indices[t * 3 + i]]++] = t;
+                }
+            }
+        }
+
+        std::vector<int> timestamps(vertexCount, 0);
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<int> deadEnd;
+        std::vector<int> candidates;
+        int time = cacheSize + 1;
+        int cursor = 0;
+        int fanning = vertexCount > 0 ? 0 : -1;
+
+        while (fanning >= 0) {
+            //emit all remaining triangles around the fanning vertex
+            candidates.clear();
+            for (int i = offsets[fanning]; i < offsets[fanning + 1]; i++) {
+                int t = adjacency[i];
+                if (emitted[t]) {
+                    continue;
+                }
+                for (int j = 0; j < 3; j++) {
+                    int v = indices[t * 3 + j];
+                    result.push_back(v);
+                    deadEnd.push_back(v);
+                    candidates.push_back(v);
+                    live[v]--;
+                    if (time - timestamps[v] > cacheSize) {
+                        timestamps[v] = time++;
+                    }
+                }
+                emitted[t] = true;
+            }
+
+            //next fanning vertex: the oldest candidate that stays in the cache while its triangles are emitted
+            int next = -1;
+            int best = -1;
+            for (int v : candidates) {
+                if (live[v] > 0) {
+                    int priority = 0;
+                    if (time - timestamps[v] + 2 * live[v] <= cacheSize) {
+                        priority = time - timestamps[v];
+                    }
+                    if (priority > best) {
+                        best = priority;
+                        next = v;
+                    }
+                }
+            }
+            //dead end, use a recently used vertex or the next vertex in order
+            while (next == -1 && !deadEnd.empty()) {
+                int v = deadEnd.back();
+                deadEnd.pop_back();
+                if (live[v] > 0) {
+                    next = v;
+                }
+            }
+            while (next == -1 && cursor < vertexCount) {
+                if (live[cursor] > 0) {
+                    next = cursor;
+                }
+                cursor++;
+            }
+            fanning = next;
+        }
+
+        for (int t = 0; t < triangleCount; t++) {
+            if (!valid[t]) {
+                result.insert(result.end(), indices.begin() + t * 3, indices.begin() + t * 3 + 3);
+            }
+        }
+        result.insert(result.end(), indices.begin() + triangleCount * 3, indices.end());
+        indices.swap(result);
+    }
+
+    //fifo cache of the overdraw pass, a flush moves the time past every cached vertex
+    class TriangleCache {
+    public:
+        std::vector<int> cachedAt;
+        int time = 0;
+        int cacheSize = 0;
+
+        TriangleCache(int vertexCount, int cacheSize) : cachedAt(vertexCount, -cacheSize - 1), cacheSize(cacheSize) {}
+
+        //number of vertices of the triangle that had to be transformed
+        int add(const int *triangle) {
+            int misses = 0;
+            for (int i = 0; i < 3; i++) {
+                int v = triangle[i];
+                if (time - cachedAt[v] > cacheSize) {
+                    cachedAt[v] = time++;
+                    misses++;
+                }
+            }
+            return misses;
+        }
+
+        void flush() {
+            time += cacheSize + 1;
+        }
+    };
+
+    void optimizeOverdraw(std::vector<int> &indices, const float *positions, int stride, int vertexCount, int cacheSize, float threshold) {
+        //triangles with invalid indices are kept at the end in their order, like in optimizeVertexCache
+        std::vector<int> triangles;
+        std::vector<int> invalid;
+        int triangleCount = (int)indices.size() / 3;
+        for (int t = 0; t < triangleCount; t++) {
+            bool valid = true;
+            for (int i = 0; i < 3; i++) {
+                int index = indices[t * 3 + i];
+                if (index < 0 || index >= vertexCount) {
+                    valid = false;
+                }
+            }
+            (valid ? triangles : invalid).push_back(t);
+        }
+        if (triangles.size() < 2) {
+            return;
+        }
+
+        //hard boundaries, a triangle with three misses starts a new patch of the mesh
+        std::vector<int> runs;
+        TriangleCache cache(vertexCount, cacheSize);
+        for (int i = 0; i < triangles.size(); i++) {
+            if (cache.add(&indices[triangles[i] * 3]) == 3 || i == 0) {
+                runs.push_back(i);
+            }
+        }
+        runs.push_back((int)triangles.size());
+
+        //soft boundaries, a run is split each time the miss ratio since the last split is low enough
+        //the cache is flushed at a split, so each cluster can be drawn in any order and keeps its ratio
+        std::vector<int> clusters;
+        for (int r = 0; r + 1 < runs.size(); r++) {
+            int begin = runs[r];
+            int end = runs[r + 1];
+            cache.flush();
+            int runMisses = 0;
+            for (int i = begin; i < end; i++) {
+                runMisses += cache.add(&indices[triangles[i] * 3]);
+            }
+            float target = threshold * (float)runMisses / (float)(end - begin);
+
+            clusters.push_back(begin);
+            cache.flush();
+            int misses = 0;
+            int count = 0;
+            for (int i = begin; i < end; i++) {
+                misses += cache.add(&indices[triangles[i] * 3]);
+                count++;
+                if ((float)misses <= target * (float)count && i + 1 < end) {
+                    clusters.push_back(i + 1);
+                    cache.flush();
+                    misses = 0;
+                    count = 0;
+                }
+            }
+            //the last cluster rarely reaches the ratio, it is merged with the one before
+            if (count > 0 && clusters.back() != begin) {
+                clusters.pop_back();
+            }
+        }
+        clusters.push_back((int)triangles.size());
+
+        auto position = [&](int v) {
+            const float *p = positions + (size_t)v * stride;
+            return glm::vec3(p[0], p[1], p[2]);
+        };
+        glm::vec3 center(0);
+        float area = 0;
+        std::vector<glm::vec3> centroids(clusters.size() - 1);
+        std::vector<glm::vec3> normals(clusters.size() - 1);
+        for (int c = 0; c + 1 < clusters.size(); c++) {
+            glm::vec3 centroid(0);
+            glm::vec3 normal(0);
+            float clusterArea = 0;
+            for (int i = clusters[c]; i < clusters[c + 1]; i++) {
+                const int *triangle = &indices[triangles[i] * 3];
+                glm::vec3 a = position(triangle[0]);
+                glm::vec3 b = position(triangle[1]);
+                glm::vec3 d = position(triangle[2]);
+                glm::vec3 cross = glm::cross(b - a, d - a);
+                float weight = glm::length(cross) * 0.5f;
+                centroid += (a + b + d) * (weight / 3.0f);
+                normal += cross;
+                clusterArea += weight;
+            }
+            center += centroid;
+            area += clusterArea;
+            centroids[c] = clusterArea > 0 ? centroid / clusterArea : glm::vec3(0);
+            normals[c] = glm::length(normal) > 0 ? glm::normalize(normal) : glm::vec3(0);
+        }
+        if (area <= 0) {
+            return;
+        }
+        center /= area;
+
+        //occlusion potential, clusters on the outside facing outwards are likely to occlude others
+        std::vector<float> potentials(clusters.size() - 1);
+        std::vector<int> order(clusters.size() - 1);
+        for (int c = 0; c < order.size(); c++) {
+            potentials[c] = glm::dot(centroids[c] - center, normals[c]);
+            order[c] = c;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            return potentials[a] > potentials[b];
+        });
+
+        std::vector<int> result;
+        result.reserve(indices.size());
+        for (int c : order) {
+            for (int i = clusters[c]; i < clusters[c + 1]; i++) {
+                result.insert(result.end(), indices.begin() + triangles[i] * 3, indices.begin() + triangles[i] * 3 + 3);
+            }
+        }
+        for (int t : invalid) {
+            result.insert(result.end(), indices.begin() + t * 3, indices.begin() + t * 3 + 3);
+        }
+        result.insert(result.end(), indices.begin() + triangleCount * 3, indices.end());
+        indices.swap(result);
+    }
+
+    int optimizeVertexFetch(std::vector<int> &indices, int vertexCount, std::vector<int> &remap) {
+        remap.assign(vertexCount, -1);
+        int count = 0;
+        for (int &index : indices) {
+            if (index < 0 || index >= vertexCount) {
+                continue;
+            }
+            if (remap[index] == -1) {
+                remap[index] = count++;
+            }
+            index = remap[index];
+        }
+        return count;
+    }
+
+    //sum of squared distances to the planes of the triangles around a vertex, weighted by triangle area
+    class Quadric {
+    public:
+        double a2 = 0, b2 = 0, c2 = 0, ab = 0, ac = 0, bc = 0, ad = 0, bd = 0, cd = 0, d2 = 0;
+        double weight = 0;
+
+        void addPlane(glm::dvec3 normal, double d, double w) {
+            a2 += w * normal.x * normal.x;
+            b2 += w * normal.y * normal.y;
+            c2 += w * normal.z * normal.z;
+            ab += w * normal.x * normal.y;
+            ac += w * normal.x * normal.z;
+            bc += w * normal.y * normal.z;
+            ad += w * normal.x * d;
+            bd += w * normal.y * d;
+            cd += w * normal.z * d;
+            d2 += w * d * d;
+            weight += w;
+        }
+
+        void add(const Quadric &q) {
+            a2 += q.a2; b2 += q.b2; c2 += q.c2;
+            ab += q.ab; ac += q.ac; bc += q.bc;
+            ad += q.ad; bd += q.bd; cd += q.cd;
+            d2 += q.d2;
+            weight += q.weight;
+        }
+
+        //squared distance, normalized by the weight
+        double error(glm::dvec3 p) const {
+            double e = a2 * p.x * p.x + b2 * p.y * p.y + c2 * p.z * p.z
+                + 2 * (ab * p.x * p.y + ac * p.x * p.z + bc * p.y * p.z)
+                + 2 * (ad * p.x + bd * p.y + cd * p.z) + d2;
+            return weight > 0 ? std::abs(e) / weight : 0;
+        }
+    };
+
+    class PositionHash {
+    public:
+        size_t operator()(const glm::vec3 &p) const {
+            uint32_t bits[3];
+            memcpy(bits, &p, sizeof(bits));
+            return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+        }
+    };
+
+    class Collapse {
+    public:
+        int source;
+        int target;
+        double error;
+    };
+
+    //closest point on a triangle (Ericson, Real-Time Collision Detection 5.1.5)
+    static double pointTriangleDistance(glm::dvec3 p, glm::dvec3 a, glm::dvec3 b, glm::dvec3 c) {
+        glm::dvec3 ab = b - a;
+        glm::dvec3 ac = c - a;
+        glm::dvec3 ap = p - a;
+        double d1 = glm::dot(ab, ap);
+        double d2 = glm::dot(ac, ap);
+        if (d1 <= 0 && d2 <= 0) {
+            return glm::length(p - a);
+        }
+        glm::dvec3 bp = p - b;
+        double d3 = glm::dot(ab, bp);
+        double d4 = glm::dot(ac, bp);
+        if (d3 >= 0 && d4 <= d3) {
+            return glm::length(p - b);
+        }
+        double vc = d1 * d4 - d3 * d2;
+        if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+            return glm::length(p - (a + ab * (d1 / (d1 - d3))));
+        }
+        glm::dvec3 cp = p - c;
+        double d5 = glm::dot(ab, cp);
+        double d6 = glm::dot(ac, cp);
+        if (d6 >= 0 && d5 <= d6) {
+            return glm::length(p - c);
+        }
+        double vb = d5 * d2 - d1 * d6;
+        if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+            return glm::length(p - (a + ac * (d2 / (d2 - d6))));
+        }
+        double va = d3 * d6 - d5 * d4;
+        if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) {
+            return glm::length(p - (b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)))));
+        }
+        double sum = va + vb + vc;
+        if (sum <= 0) {
+            //degenerate triangle, the closest vertex is good enough
+            return std::min({ glm::length(p - a), glm::length(p - b), glm::length(p - c) });
+        }
+        return glm::length(p - (a + ab * (vb / sum) + ac * (vc / sum)));
+    }
+
+    float simplifyMesh(std::vector<int> &indices, const float *positions, int stride, int vertexCount, int targetIndexCount, float maxError) {
+        auto position = [&](int v) {
+            const float *p = positions + (size_t)v * stride;
+            return glm::dvec3(p[0], p[1], p[2]);
+        };
+        indices.resize(indices.size() / 3 * 3);
+        for (int index : indices) {
+            if (index < 0 || index >= vertexCount) {
+                return 0;
+            }
+        }
+
+        //vertices with the same position form a group, groups with more than one vertex are seams
+        std::vector<int> group(vertexCount);
+        std::vector<int> groupSize;
+        std::unordered_map<glm::vec3, int, PositionHash> groups;
+        groups.reserve(vertexCount);
+        for (int v = 0; v < vertexCount; v++) {
+            const float *p = positions + (size_t)v * stride;
+            //adding zero turns -0 into 0
+            glm::vec3 key(p[0] + 0.0f, p[1] + 0.0f, p[2] + 0.0f);
+            auto entry = groups.find(key);
+            if (entry == groups.end()) {
+                entry = groups.emplace(key, (int)groupSize.size()).first;
+                groupSize.push_back(0);
+            }
+            group[v] = entry->second;
+            groupSize[entry->second]++;
+        }
+
+        //edges that are used by one triangle or more than two are borders, their vertices are kept
+        std::vector<bool> locked(vertexCount, false);
+        std::vector<bool> canTarget(vertexCount, true);
+        for (int v = 0; v < vertexCount; v++) {
+            if (groupSize[group[v]] > 1) {
+                locked[v] = true;
+                canTarget[v] = false;
+            }
+        }
+        {
+            std::unordered_map<uint64_t, int> edges;
+            edges.reserve(indices.size());
+            for (size_t i = 0; i < indices.size(); i += 3) {
+                for (int j = 0; j < 3; j++) {
+                    uint32_t a = group[indices[i + j]];
+                    uint32_t b = group[indices[i + (j + 1) % 3]];
+                    edges[((uint64_t)std::min(a, b) << 32) | std::max(a, b)]++;
+                }
+            }
+            for (size_t i = 0; i < indices.size(); i += 3) {
+                for (int j = 0; j < 3; j++) {
+                    int a = indices[i + j];
+                    int b = indices[i + (j + 1) % 3];
+                    uint32_t ga = group[a];
+                    uint32_t gb = group[b];
+                    if (edges[((uint64_t)std::min(ga, gb) << 32) | std::max(ga, gb)] != 2) {
+                        locked[a] = true;
+                        locked[b] = true;
+                    }
+                }
+            }
+        }
+
+        std::vector<Quadric> quadrics(vertexCount);
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            glm::dvec3 p0 = position(indices[i + 0]);
+            glm::dvec3 p1 = position(indices[i + 1]);
+            glm::dvec3 p2 = position(indices[i + 2]);
+            glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+            double length = glm::length(normal);
+            if (length == 0) {
+                continue;
+            }
+            normal /= length;
+            for (int j = 0; j < 3; j++) {
+                quadrics[indices[i + j]].addPlane(normal, -glm::dot(normal, p0), length * 0.5);
+            }
+        }
+
+        //each pass collapses the cheapest edges whose vertices were not changed in the same pass
+        //the quadric error is a mean squared distance, so it limits the collapses but is not returned
+        double maxErrorSquared = (double)maxError * maxError;
+        //vertex each vertex was collapsed into over all passes
+        std::vector<int> collapsedInto(vertexCount);
+        for (int v = 0; v < vertexCount; v++) {
+            collapsedInto[v] = v;
+        }
+        std::vector<Collapse> collapses;
+        std::vector<int> remap(vertexCount);
+        std::vector<bool> touched(vertexCount);
+        std::vector<int> offsets(vertexCount + 1);
+        std::vector<int> adjacency;
+        while ((int)indices.size() > targetIndexCount) {
+            collapses.clear();
+            for (size_t i = 0; i < indices.size(); i += 3) {
+                for (int j = 0; j < 3; j++) {
+                    int a = indices[i + j];
+                    int b = indices[i + (j + 1) % 3];
+                    for (int k = 0; k < 2; k++) {
+                        if (!locked[a] && canTarget[b]) {
+                            Quadric q = quadrics[a];
+                            q.add(quadrics[b]);
+                            collapses.push_back({ a, b, q.error(position(b)) });
+                        }
+                        std::swap(a, b);
+                    }
+                }
+            }
+            if (collapses.empty()) {
+                break;
+            }
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse &c1, const Collapse &c2) {
+                return c1.error < c2.error;
+            });
+
+            std::fill(offsets.begin(), offsets.end(), 0);
+            for (int index : indices) {
+                offsets[index + 1]++;
+            }
+            for (int v = 0; v < vertexCount; v++) {
+                offsets[v + 1] += offsets[v];
+            }
+            adjacency.resize(indices.size());
+            std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); i++) {
+                adjacency[fill[indices[i]]++] = (int)(i / 3);
+            }
+
+            for (int v = 0; v < vertexCount; v++) {
+                remap[v] = v;
+            }
+            std::fill(touched.begin(), touched.end(), false);
+
+            //an interior collapse removes two triangles
+            int triangleCount = (int)indices.size() / 3;
+            int targetTriangleCount = targetIndexCount / 3;
+            int collapseCount = 0;
+            for (auto &collapse : collapses) {
+                if (collapse.error > maxErrorSquared || triangleCount <= targetTriangleCount) {
+                    break;
+                }
+                int a = collapse.source;
+                int b = collapse.target;
+                if (touched[a] || touched[b]) {
+                    continue;
+                }
+
+                //reject collapses that flip or fold a triangle around the source
+                bool flipped = false;
+                for (int i = offsets[a]; i < offsets[a + 1] && !flipped; i++) {
+                    int t = adjacency[i];
+                    int v[3] = { remap[indices[t * 3 + 0]], remap[indices[t * 3 + 1]], remap[indices[t * 3 + 2]] };
+                    if (v[0] == b || v[1] == b || v[2] == b) {
+                        continue;
+                    }
+                    glm::dvec3 p[3];
+                    glm::dvec3 q[3];
+                    for (int j = 0; j < 3; j++) {
+                        p[j] = position(v[j]);
+                        q[j] = v[j] == a ? position(b) : p[j];
+                    }
+                    glm::dvec3 n0 = glm::cross(p[1] - p[0], p[2] - p[0]);
+                    glm::dvec3 n1 = glm::cross(q[1] - q[0], q[2] - q[0]);
+                    if (glm::dot(n0, n1) <= 0.25 * glm::length(n0) * glm::length(n1)) {
+                        flipped = true;
+                    }
+                }
+                if (flipped) {
+                    continue;
+                }
+
+                remap[a] = b;
+                quadrics[b].add(quadrics[a]);
+                touched[a] = true;
+                touched[b] = true;
+                triangleCount -= 2;
+                collapseCount++;
+            }
+            if (collapseCount == 0) {
+                break;
+            }
+            for (int v = 0; v < vertexCount; v++) {
+                collapsedInto[v] = remap[collapsedInto[v]];
+            }
+
+            //apply the collapses and remove the triangles that became degenerate
+            size_t count = 0;
+            for (size_t i = 0; i < indices.size(); i += 3) {
+                int v0 = remap[indices[i + 0]];
+                int v1 = remap[indices[i + 1]];
+                int v2 = remap[indices[i + 2]];
+                if (group[v0] != group[v1] && group[v0] != group[v2] && group[v1] != group[v2]) {
+                    indices[count++] = v0;
+                    indices[count++] = v1;
+                    indices[count++] = v2;
+                }
+            }
+            indices.resize(count);
+        }
+
+        //the error is measured, each removed vertex is compared with the triangles near the vertex it was collapsed into
+        std::fill(offsets.begin(), offsets.end(), 0);
+        for (int index : indices) {
+            offsets[index + 1]++;
+        }
+        for (int v = 0; v < vertexCount; v++) {
+            offsets[v + 1] += offsets[v];
+        }
+        adjacency.resize(indices.size());
+        std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++) {
+            adjacency[fill[indices[i]]++] = (int)(i / 3);
+        }
+        double resultError = 0;
+        //triangles are shared by the rings of the neighbors, each one is only tested once per vertex
+        std::vector<int> testedFor(indices.size() / 3, -1);
+        for (int v = 0; v < vertexCount; v++) {
+            int target = collapsedInto[v];
+            if (target == v || offsets[target] == offsets[target + 1]) {
+                continue;
+            }
+            //the triangles around the target and around its neighbors, the vertex can be closer to the neighbors
+            double distance = DBL_MAX;
+            for (int i = offsets[target]; i < offsets[target + 1]; i++) {
+                for (int j = 0; j < 3; j++) {
+                    int neighbor = indices[adjacency[i] * 3 + j];
+                    for (int k = offsets[neighbor]; k < offsets[neighbor + 1]; k++) {
+                        int t = adjacency[k];
+                        if (testedFor[t] == v) {
+                            continue;
+                        }
+                        testedFor[t] = v;
+                        distance = std::min(distance, pointTriangleDistance(position(v), position(indices[t * 3 + 0]), position(indices[t * 3 + 1]), position(indices[t * 3 + 2])));
+                    }
+                }
+            }
+            resultError = std::max(resultError, distance);
+        }
+        return (float)resultError;
+    }
+
+}
@@ -0,0 +1,36 @@
+//
+// Copyright (c) 2024 Julian Hinxlage. All rights reserved.
+//
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+namespace baseline {
+
+    //average cache miss ratio, transformed vertices per triangle with a fifo post transform cache
+    float getCacheMissRatio(const std::vector<int> &indices, int vertexCount, int cacheSize = 16);
+
+    //reorders the triangles so that vertices are reused while they are still in the post transform cache (tipsify)
+    void optimizeVertexCache(std::vector<int> &indices, int vertexCount, int cacheSize = 16);
+
+    //overdraw pass of tipsify, call after optimizeVertexCache
+    //the triangles are split into clusters where the cache was flushed or the cache miss ratio of a cluster
+    //dropped to threshold times the ratio of its run, clusters facing away from the mesh center are drawn first
+    //positions are read as 3 floats every stride floats
+    void optimizeOverdraw(std::vector<int> &indices, const float *positions, int stride, int vertexCount, int cacheSize = 16, float threshold = 1.05f);
+
+    //numbers the vertices in order of first use, remap[oldIndex] is the new index or -1 for unused vertices
+    //returns the number of used vertices
+    int optimizeVertexFetch(std::vector<int> &indices, int vertexCount, std::vector<int> &remap);
+
+    //collapses edges by quadric error until there are at most targetIndexCount indices or the quadric error would exceed maxError
+    //the quadric error is the root of the area weighted mean squared distance to the planes of the merged triangles, not a bound
+    //vertices are not moved, the result uses a subset of the same vertices
+    //vertices on open borders and seams (different vertices with the same position) are kept
+    //positions are read as 3 floats every stride floats
+    //returns the largest distance of a removed vertex to the triangles near the vertex it was collapsed into, in position units
+    float simplifyMesh(std::vector<int> &indices, const float *positions, int stride, int vertexCount, int targetIndexCount, float maxError);
+
+}
@@ -3,6 +3,7 @@
 //
 
 #include "RenderContext.h"
+#include "RenderState.h"
 #include "common/Log.h"
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -60,40 +61,28 @@ namespace baseline {
         if(c != context){
             glfwMakeContextCurrent((GLFWwindow*)c);
             context = c;
+            RenderState::setContext(c);
         }
     }
 
     void RenderContext::destroy() {
         if(context != nullptr){
+            RenderState::removeContext(context);
             glfwDestroyWindow((GLFWwindow*)context);
             set(nullptr);
         }
     }
 
     void RenderContext::setDepth(bool enabled) {
-        if(enabled){
-            glEnable(GL_DEPTH_TEST);
-        }else{
-            glDisable(GL_DEPTH_TEST);
-        }
+        RenderState::get().setDepth(enabled);
     }
 
     void RenderContext::setBlend(bool enabled) {
-        if(enabled){
-            glEnable(GL_BLEND);
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        }else{
-            glDisable(GL_BLEND);
-        }
+        RenderState::get().setBlend(enabled ? BlendMode::ALPHA : BlendMode::NONE);
     }
 
     void RenderContext::setCull(bool enabled, bool front) {
-        if(enabled){
-            glEnable(GL_CULL_FACE);
-            glCullFace(front ? GL_FRONT : GL_BACK);
-        }else{
-            glDisable(GL_CULL_FACE);
-        }
+        RenderState::get().setCull(enabled, front);
     }
 
     void RenderContext::flush(bool synchronous) {
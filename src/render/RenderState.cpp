@@ -0,0 +1,273 @@
+//
+// Copyright (c) 2024 Julian Hinxlage. All rights reserved.
+//
+
+#include "RenderState.h"
+#include "gui/Window.h"
+#include <GL/glew.h>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace baseline {
+
+    static std::mutex statesMutex;
+    static std::unordered_map<void*, std::shared_ptr<RenderState>> states;
+    static thread_local std::shared_ptr<RenderState> currentState;
+
+    static void setWindowViewport(int x, int y, int width, int height) {
+        RenderState::get().setViewport(x, y, width, height);
+    }
+
+    static void invalidateWindowState() {
+        RenderState::get().invalidate();
+    }
+
+    RenderState::RenderState() {
+        invalidate();
+        //the Window draws ImGui between the frames of the renderer
+        Window::setViewportHook = setWindowViewport;
+        Window::invalidateStateHook = invalidateWindowState;
+    }
+
+    RenderState &RenderState::get() {
+        if(!currentState){
+            //contexts that were not made current with RenderContext, for example the one of a Window
+            currentState = std::make_shared<RenderState>();
+        }
+        return *currentState;
+    }
+
+    void RenderState::setContext(void *context) {
+        if(!context){
+            currentState = nullptr;
+            return;
+        }
+        std::unique_lock<std::mutex> lock(statesMutex);
+        std::shared_ptr<RenderState> &state = states[context];
+        if(!state){
+            state = std::make_shared<RenderState>();
+        }
+        currentState = state;
+    }
+
+    void RenderState::removeContext(void *context) {
+        std::unique_lock<std::mutex> lock(statesMutex);
+        states.erase(context);
+    }
+
+    bool RenderState::skip(bool same) {
+        if(same){
+            counters.skipped++;
+        }else{
+            counters.issued++;
+        }
+        return same;
+    }
+
+    void RenderState::bindProgram(uint32_t id) {
+        if(!skip(program == id)){
+            glUseProgram(id);
+            program = id;
+        }
+    }
+
+    void RenderState::bindVertexArray(uint32_t id) {
+        if(!skip(vertexArray == id)){
+            glBindVertexArray(id);
+            vertexArray = id;
+            //the index buffer binding is part of the vertex array
+            buffers[(int)BufferType::INDEX_BUFFER] = unknown;
+        }
+    }
+
+    void RenderState::bindBuffer(BufferType type, uint32_t id) {
+        uint32_t &current = buffers[(int)type];
+        if(!skip(current == id)){
+            glBindBuffer(internalEnum(type), id);
+            current = id;
+        }
+    }
+
+    void RenderState::bindBufferBase(BufferType type, uint32_t index, uint32_t id) {
+        //indexed bindings are not tracked, but they also change the generic binding
+        counters.issued++;
+        glBindBufferBase(internalEnum(type), index, id);
+        buffers[(int)type] = id;
+    }
+
+    void RenderState::bindFrameBuffer(uint32_t id) {
+        if(!skip(frameBuffer == id)){
+            glBindFramebuffer(GL_FRAMEBUFFER, id);
+            frameBuffer = id;
+        }
+    }
+
+    void RenderState::setActiveUnit(uint32_t unit) {
+        if(!skip(activeUnit == unit)){
+            glActiveTexture(GL_TEXTURE0 + unit);
+            activeUnit = unit;
+        }
+    }
+
+    void RenderState::bindTexture(TextureType type, uint32_t id, int32_t slot) {
+        uint32_t unit = slot < 0 ? activeUnit : (uint32_t)slot;
+        if(unit == unknown || unit >= maxTextureUnits){
+            if(slot >= 0){
+                glActiveTexture(GL_TEXTURE0 + unit);
+                activeUnit = unit;
+                counters.issued++;
+            }
+            glBindTexture(internalEnum(type), id);
+            counters.issued++;
+            return;
+        }
+
+        uint32_t &current = textures[unit][(int)type];
+        if(!skip(current == id)){
+            setActiveUnit(unit);
+            glBindTexture(internalEnum(type), id);
+            current = id;
+        }
+    }
+
+    void RenderState::setViewport(int x, int y, int width, int height) {
+        if(!skip(viewport[0] == x && viewport[1] == y && viewport[2] == width && viewport[3] == height)){
+            glViewport(x, y, width, height);
+            viewport[0] = x;
+            viewport[1] = y;
+            viewport[2] = width;
+            viewport[3] = height;
+        }
+    }
+
+    void RenderState::setBlend(BlendMode mode) {
+        if(skip(blend == (int)mode)){
+            return;
+        }
+        switch (mode) {
+        case BlendMode::ALPHA:
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            break;
+        case BlendMode::ADDITIVE:
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+            break;
+        case BlendMode::MULTIPLY:
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_DST_COLOR, GL_ONE_MINUS_SRC_ALPHA);
+            break;
+        case BlendMode::NONE:
+            glDisable(GL_BLEND);
+            break;
+        }
+        blend = (int)mode;
+    }
+
+    void RenderState::setDepth(bool enabled) {
+        if(!skip(depth == (int)enabled)){
+            if(enabled){
+                glEnable(GL_DEPTH_TEST);
+            }else{
+                glDisable(GL_DEPTH_TEST);
+            }
+            depth = (int)enabled;
+        }
+    }
+
+    void RenderState::setCull(bool enabled, bool front) {
+        //0 disabled, 1 back faces, 2 front faces
+        int mode = enabled ? (front ? 2 : 1) : 0;
+        if(!skip(cull == mode)){
+            if(enabled){
+                glEnable(GL_CULL_FACE);
+                glCullFace(front ? GL_FRONT : GL_BACK);
+            }else{
+                glDisable(GL_CULL_FACE);
+            }
+            cull = mode;
+        }
+    }
+
+    uint32_t RenderState::getProgram() {
+        return program;
+    }
+
+    uint32_t RenderState::getVertexArray() {
+        return vertexArray;
+    }
+
+    uint32_t RenderState::getFrameBuffer() {
+        return frameBuffer;
+    }
+
+    void RenderState::removeProgram(uint32_t id) {
+        if(program == id){
+            program = unknown;
+        }
+    }
+
+    void RenderState::removeVertexArray(uint32_t id) {
+        if(vertexArray == id){
+            vertexArray = unknown;
+        }
+        buffers[(int)BufferType::INDEX_BUFFER] = unknown;
+    }
+
+    void RenderState::removeBuffer(uint32_t id) {
+        for(auto &buffer : buffers){
+            if(buffer == id){
+                buffer = unknown;
+            }
+        }
+    }
+
+    void RenderState::removeFrameBuffer(uint32_t id) {
+        if(frameBuffer == id){
+            frameBuffer = unknown;
+        }
+    }
+
+    void RenderState::removeTexture(uint32_t id) {
+        for(auto &unit : textures){
+            for(auto &texture : unit){
+                if(texture == id){
+                    texture = unknown;
+                }
+            }
+        }
+    }
+
+    void RenderState::invalidate() {
+        program = unknown;
+        vertexArray = unknown;
+        frameBuffer = unknown;
+        for(auto &buffer : buffers){
+            buffer = unknown;
+        }
+        for(auto &unit : textures){
+            for(auto &texture : unit){
+                texture = unknown;
+            }
+        }
+        activeUnit = unknown;
+        for(auto &v : viewport){
+            v = -1;
+        }
+        blend = -1;
+        depth = -1;
+        cull = -1;
+    }
+
+    const RenderState::Counters &RenderState::getCounters() {
+        return counters;
+    }
+
+    RenderState::Counters RenderState::resetCounters() {
+        Counters result = counters;
+        counters = Counters();
+        return result;
+    }
+
+}
@@ -0,0 +1,83 @@
+//
+// Copyright (c) 2024 Julian Hinxlage. All rights reserved.
+//
+
+#pragma once
+
+#include "enum.h"
+
+namespace baseline {
+
+    //tracks the GL state of one context and skips calls that would not change it
+    //uniform values belong to the program and are filtered by the Shader
+    class RenderState {
+    public:
+        //returned by the getters when the state is not known
+        static constexpr uint32_t unknown = 0xffffffff;
+
+        class Counters {
+        public:
+            int issued = 0;
+            int skipped = 0;
+        };
+
+        RenderState();
+
+        //state of the context that is current on the calling thread
+        static RenderState &get();
+        //called by RenderContext when a context becomes current or is destroyed
+        static void setContext(void *context);
+        static void removeContext(void *context);
+
+        void bindProgram(uint32_t id);
+        void bindVertexArray(uint32_t id);
+        void bindBuffer(BufferType type, uint32_t id);
+        void bindBufferBase(BufferType type, uint32_t index, uint32_t id);
+        void bindFrameBuffer(uint32_t id);
+        //a slot of -1 binds to the active unit
+        void bindTexture(TextureType type, uint32_t id, int32_t slot = -1);
+        void setViewport(int x, int y, int width, int height);
+        void setBlend(BlendMode mode);
+        void setDepth(bool enabled);
+        void setCull(bool enabled, bool front = false);
+        //counts a call that is filtered elsewhere, returns same
+        bool skip(bool same);
+
+        uint32_t getProgram();
+        uint32_t getVertexArray();
+        uint32_t getFrameBuffer();
+
+        //GL unbinds deleted objects, their ids can be reused by new objects
+        void removeProgram(uint32_t id);
+        void removeVertexArray(uint32_t id);
+        void removeBuffer(uint32_t id);
+        void removeFrameBuffer(uint32_t id);
+        void removeTexture(uint32_t id);
+        //forget everything, needed after code that changes the GL state directly
+        void invalidate();
+
+        const Counters &getCounters();
+        //returns the counters since the last reset, call once per frame
+        Counters resetCounters();
+
+    private:
+        static constexpr int maxTextureUnits = 32;
+        static constexpr int bufferTypeCount = 3;
+        static constexpr int textureTypeCount = 3;
+
+        uint32_t program;
+        uint32_t vertexArray;
+        uint32_t frameBuffer;
+        uint32_t buffers[bufferTypeCount];
+        uint32_t textures[maxTextureUnits][textureTypeCount];
+        uint32_t activeUnit;
+        int viewport[4];
+        int blend;
+        int depth;
+        int cull;
+        Counters counters;
+
+        void setActiveUnit(uint32_t unit);
+    };
+
+}
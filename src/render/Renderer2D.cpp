@@ -1,9 +1,13 @@
 
 #include "Renderer2D.h"
+#include "RenderState.h"
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <glm/gtc/matrix_transform.hpp>
 #include <fstream>
+#include <algorithm>
+#include <atomic>
+#include "common/Log.h"
 
 #define STR(x) #x
 
@@ -14,9 +18,19 @@ const char* shaderSource =
 
 namespace baseline {
 
+	//renderer ids are never reused, so a cached context can not belong to a destroyed renderer
+	static std::atomic<uint64_t> nextRendererId = 1;
+	thread_local uint64_t Renderer2D::cachedRendererId = 0;
+	thread_local Renderer2D::Context* Renderer2D::cachedContext = nullptr;
+
+	Renderer2D::Renderer2D() {
+		rendererId = nextRendererId++;
+	}
+
 	void Renderer2D::init(bool useFrameBuffer, int resolutionX, int resolutionY) {
 		shader = std::make_shared<Shader>();
 		shader->loadFromSource(shaderSource);
+		projectionUniform = shader->getUniform("uProjection");
 
 		defaultTexture = std::make_shared<Texture>();
 		defaultTexture->create(1, 1);
@@ -38,15 +52,26 @@ namespace baseline {
 
 
 		instanceBuffer = std::make_shared<Buffer>();
-		instanceBuffer->init(nullptr, 0, 1, BufferType::VERTEX_BUFFER, true);
+		instanceBuffer->initStream(1024 * sizeof(Instance), sizeof(Instance));
+		instanceCapacity = instanceBuffer->getCapacity();
 		defaultMesh->vertexArray.addVertexBuffer(instanceBuffer, {
-			{Type::FLOAT, 4},
-			{Type::FLOAT, 4},
-			{Type::FLOAT, 4},
-			{Type::FLOAT, 4},
-			{Type::FLOAT, 4},
+			{Type::FLOAT, 2},
+			{Type::FLOAT, 2},
+			{Type::FLOAT, 1},
+			{Type::UINT8, 4, true},
+			{Type::UINT8, 4},
 		}, 1);
 
+		int units = 0;
+		glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &units);
+		maxTextureSlots = std::max(1, std::min(units, maxTextureSlotCount));
+		int slots[maxTextureSlotCount];
+		for (int i = 0; i < maxTextureSlotCount; i++) {
+			slots[i] = std::min(i, maxTextureSlots - 1);
+		}
+		shader->bind();
+		shader->set("uTextures", slots, maxTextureSlotCount);
+
 		if (useFrameBuffer) {
 			frameBuffer = std::make_shared<FrameBuffer>();
 			frameBuffer->init(resolutionX, resolutionY, {
@@ -56,31 +81,215 @@ namespace baseline {
 			);
 		}
 
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		RenderState::get().setBlend(BlendMode::ALPHA);
 	}
 
-	void Renderer2D::submitQuad(glm::vec2 pos, glm::vec2 scale, float rotation, Texture* texture, Color color) {
-		glm::mat4 transform(1);
-		transform = glm::translate(transform, glm::vec3(pos, 0));
-		transform = glm::scale(transform, glm::vec3(scale, 0));
-		transform = glm::rotate(transform, rotation, glm::vec3(0, 0, 1));
+	void Renderer2D::Context::submitQuad(glm::vec2 pos, glm::vec2 scale, float rotation, Texture* texture, Color color, int layer, BlendMode blend) {
+		Sprite sprite;
+		sprite.position = pos;
+		sprite.scale = scale;
+		sprite.rotation = rotation;
+		sprite.color = color;
+		submit(sprite, texture, false, layer, blend);
+	}
 
-		Instance instance;
-		instance.transform = transform;
-		instance.color = color.vec();
-		quadInstances.push_back(instance);
+	void Renderer2D::Context::submitCircle(glm::vec2 pos, glm::vec2 scale, Texture* texture, Color color, int layer, BlendMode blend) {
+		Sprite sprite;
+		sprite.position = pos;
+		sprite.scale = scale;
+		sprite.color = color;
+		submit(sprite, texture, true, layer, blend);
 	}
 
-	void Renderer2D::submitCircle(glm::vec2 pos, glm::vec2 scale, Texture* texture, Color color) {
-		glm::mat4 transform(1);
-		transform = glm::translate(transform, glm::vec3(pos, 0));
-		transform = glm::scale(transform, glm::vec3(scale, 0));
+	void Renderer2D::Context::submitQuads(const Sprite* sprites, int count, Texture* texture, int layer, BlendMode blend) {
+		if (count <= 0) {
+			return;
+		}
+		uint64_t key = getKey(texture, layer, blend);
+		size_t offset = instances.size();
+		instances.resize(offset + count);
+		keys.resize(offset + count);
+
+		//plain copies without branches, these loops are vectorized by the compiler
+		Instance* instance = instances.data() + offset;
+		for (int i = 0; i < count; i++) {
+			instance[i].sprite = sprites[i];
+			instance[i].slot = 0;
+			instance[i].circle = 0;
+		}
+		uint64_t* target = keys.data() + offset;
+		for (int i = 0; i < count; i++) {
+			target[i] = key | (uint64_t)(offset + i);
+		}
+	}
 
-		Instance instance;
-		instance.transform = transform;
-		instance.color = color.vec();
-		circleInstances.push_back(instance);
+	void Renderer2D::Context::submit(const Sprite& sprite, Texture* texture, bool circle, int layer, BlendMode blend) {
+		keys.push_back(getKey(texture, layer, blend) | (uint64_t)instances.size());
+
+		Instance& instance = instances.emplace_back();
+		instance.sprite = sprite;
+		instance.slot = 0;
+		instance.circle = circle ? 1 : 0;
+	}
+
+	uint64_t Renderer2D::Context::getKey(Texture* texture, int layer, BlendMode blend) {
+		//key: 16 bit layer, 2 bit blend mode, 14 bit texture index, 32 bit instance index
+		uint64_t layerBits = (uint64_t)(std::clamp(layer, -32768, 32767) + 32768);
+		return (layerBits << 48) | ((uint64_t)blend << 46) | ((uint64_t)getTextureIndex(texture) << 32);
+	}
+
+	//nullptr stays a valid entry here and is replaced by the default texture when the contexts are merged
+	uint32_t Renderer2D::Context::getTextureIndex(Texture* texture) {
+		if (lastTextureIndex >= 0 && texture == lastTexture) {
+			return lastTextureIndex;
+		}
+
+		auto entry = textureIndices.find(texture);
+		uint32_t index;
+		if (entry != textureIndices.end()) {
+			index = entry->second;
+		}
+		else {
+			if (textures.size() >= (1 << 14)) {
+				Log::warning("Renderer2D: more than %d textures in one frame", 1 << 14);
+				return 0;
+			}
+			index = (uint32_t)textures.size();
+			textures.push_back(texture);
+			textureIndices[texture] = index;
+		}
+		lastTexture = texture;
+		lastTextureIndex = (int)index;
+		return index;
+	}
+
+	void Renderer2D::Context::clear() {
+		instances.clear();
+		keys.clear();
+		textures.clear();
+		textureIndices.clear();
+		lastTexture = nullptr;
+		lastTextureIndex = -1;
+	}
+
+	void Renderer2D::submitQuad(glm::vec2 pos, glm::vec2 scale, float rotation, Texture* texture, Color color, int layer, BlendMode blend) {
+		getContext().submitQuad(pos, scale, rotation, texture, color, layer, blend);
+	}
+
+	void Renderer2D::submitCircle(glm::vec2 pos, glm::vec2 scale, Texture* texture, Color color, int layer, BlendMode blend) {
+		getContext().submitCircle(pos, scale, texture, color, layer, blend);
+	}
+
+	void Renderer2D::submitQuads(const Sprite* sprites, int count, Texture* texture, int layer, BlendMode blend) {
+		getContext().submitQuads(sprites, count, texture, layer, blend);
+	}
+
+	//defined here, so the thread_local cache is only accessed from this library and not from inline code in other modules
+	Renderer2D::Context& Renderer2D::getContext() {
+		if (cachedRendererId == rendererId) {
+			return *cachedContext;
+		}
+		return addContext();
+	}
+
+	Renderer2D::Context& Renderer2D::addContext() {
+		std::unique_lock<std::mutex> lock(contextMutex);
+		Context*& context = threadContexts[std::this_thread::get_id()];
+		if (!context) {
+			context = contexts.emplace_back(std::make_unique<Context>()).get();
+		}
+		cachedRendererId = rendererId;
+		cachedContext = context;
+		return *context;
+	}
+
+	void Renderer2D::mergeContexts() {
+		instances.clear();
+		keys.clear();
+		textures.clear();
+		textureIndices.clear();
+
+		std::unique_lock<std::mutex> lock(contextMutex);
+		for (auto& context : contexts) {
+			if (context->instances.empty()) {
+				continue;
+			}
+			stats.contexts++;
+
+			textureRemap.resize(context->textures.size());
+			for (size_t i = 0; i < context->textures.size(); i++) {
+				Texture* texture = context->textures[i] ? context->textures[i] : defaultTexture.get();
+				auto entry = textureIndices.find(texture);
+				if (entry != textureIndices.end()) {
+					textureRemap[i] = entry->second;
+				}
+				else if (textures.size() >= (1 << 14)) {
+					Log::warning("Renderer2D: more than %d textures in one frame", 1 << 14);
+					textureRemap[i] = 0;
+				}
+				else {
+					textureRemap[i] = (uint32_t)textures.size();
+					textureIndices[texture] = (uint32_t)textures.size();
+					textures.push_back(texture);
+				}
+			}
+
+			//the first context is taken over without copying if its texture indices did not change
+			bool identity = instances.empty();
+			for (size_t i = 0; identity && i < textureRemap.size(); i++) {
+				identity = textureRemap[i] == i;
+			}
+			if (identity) {
+				instances.swap(context->instances);
+				keys.swap(context->keys);
+			}
+			else {
+				uint64_t offset = instances.size();
+				instances.insert(instances.end(), context->instances.begin(), context->instances.end());
+				size_t begin = keys.size();
+				keys.resize(begin + context->keys.size());
+				for (size_t i = 0; i < context->keys.size(); i++) {
+					uint64_t key = context->keys[i];
+					uint64_t texture = textureRemap[(key >> 32) & 0x3fff];
+					keys[begin + i] = (key & 0xffffc00000000000) | (texture << 32) | (offset + (uint32_t)key);
+				}
+			}
+			context->clear();
+		}
+	}
+
+	void Renderer2D::sortKeys() {
+		//stable LSD radix sort of the upper 32 bits, the instance index in the lower bits is already ascending
+		sortBuffer.resize(keys.size());
+		uint64_t* source = keys.data();
+		uint64_t* target = sortBuffer.data();
+		size_t count = keys.size();
+
+		for (int shift = 32; shift < 64; shift += 8) {
+			size_t offsets[256] = {};
+			for (size_t i = 0; i < count; i++) {
+				offsets[(source[i] >> shift) & 0xff]++;
+			}
+			//all keys have the same digit
+			if (offsets[(source[0] >> shift) & 0xff] == count) {
+				continue;
+			}
+
+			size_t sum = 0;
+			for (int i = 0; i < 256; i++) {
+				size_t digitCount = offsets[i];
+				offsets[i] = sum;
+				sum += digitCount;
+			}
+			for (size_t i = 0; i < count; i++) {
+				target[offsets[(source[i] >> shift) & 0xff]++] = source[i];
+			}
+			std::swap(source, target);
+		}
+
+		if (source != keys.data()) {
+			keys.swap(sortBuffer);
+		}
 	}
 
 	void Renderer2D::begin(const glm::mat4& cameraMatrix, bool clear) {
@@ -90,33 +299,105 @@ namespace baseline {
 				frameBuffer->clear();
 			}
 		}
-		shader->set("uProjection", cameraMatrix);
+		shader->bind();
+		shader->set(projectionUniform, cameraMatrix);
 	}
 
 	void Renderer2D::end() {
-		if (circleInstances.size() != 0) {
-			shader->set("uSize", 1.0f);
-			instanceBuffer->setData(circleInstances.data(), circleInstances.size() * sizeof(Instance), 0);
-			shader->bind();
-			defaultTexture->bind(0);
-			shader->set("uTexture", 0);
-			defaultMesh->vertexArray.submit(-1, circleInstances.size());
-			circleInstances.clear();
-			defaultTexture->unbind();
-		}
-		if (quadInstances.size() != 0) {
-			shader->set("uSize", 4.0f);
-			instanceBuffer->setData(quadInstances.data(), quadInstances.size() * sizeof(Instance), 0);
+		stats = Stats();
+		mergeContexts();
+		stats.instances = (int)instances.size();
+		stats.textures = (int)textures.size();
+
+		//sorted instances are written directly into the mapped buffer
+		Instance* target = nullptr;
+		if (instances.size() != 0) {
+			target = (Instance*)instanceBuffer->mapStream(instances.size() * sizeof(Instance));
+			if (!target) {
+				Log::warning("Renderer2D: failed to map instance buffer");
+			}
+		}
+
+		if (target) {
+			sortKeys();
+			if (instanceBuffer->getCapacity() != instanceCapacity) {
+				instanceCapacity = instanceBuffer->getCapacity();
+				defaultMesh->vertexArray.updateVertexBuffers();
+			}
+
+			//split into batches when the blend mode changes or the texture slots are used up
+			batches.clear();
+			textureSlots.assign(textures.size(), -1);
+			Batch* batch = nullptr;
+			for (size_t i = 0; i < keys.size(); i++) {
+				uint64_t key = keys[i];
+				BlendMode blend = (BlendMode)((key >> 46) & 0x3);
+				Texture* texture = textures[(key >> 32) & 0x3fff];
+
+				if (!batch || batch->blend != blend) {
+					batch = &batches.emplace_back();
+					batch->begin = (int)i;
+					batch->blend = blend;
+				}
+
+				uint32_t textureIndex = (key >> 32) & 0x3fff;
+				int slot = -1;
+				for (int j = 0; j < maxTextureSlots; j++) {
+					if (batch->textures[j] == texture) {
+						slot = j;
+						break;
+					}
+				}
+				if (slot == -1) {
+					if (batch->textureCount >= maxTextureSlots) {
+						batch = &batches.emplace_back();
+						batch->begin = (int)i;
+						batch->blend = blend;
+					}
+					//keep the unit of the previous batch if possible, the texture is then still bound
+					slot = textureSlots[textureIndex];
+					if (slot < 0 || batch->textures[slot]) {
+						slot = 0;
+						while (batch->textures[slot]) {
+							slot++;
+						}
+					}
+					batch->textures[slot] = texture;
+					batch->textureCount++;
+					textureSlots[textureIndex] = slot;
+				}
+
+				Instance instance = instances[(uint32_t)key];
+				instance.slot = (uint8_t)slot;
+				target[i] = instance;
+				batch->count++;
+			}
+
+			instanceBuffer->unmapStream();
+			//batches start at a base instance, the vertex array offsets the attributes if base instances are not supported
+			int baseInstance = instanceBuffer->getStreamOffset() / sizeof(Instance);
 			shader->bind();
-			defaultTexture->bind(0);
-			shader->set("uTexture", 0);
-			defaultMesh->vertexArray.submit(-1, quadInstances.size());
-			quadInstances.clear();
-			defaultTexture->unbind();
+			for (auto& batch : batches) {
+				RenderState::get().setBlend(batch.blend);
+				for (int i = 0; i < maxTextureSlots; i++) {
+					if (batch.textures[i]) {
+						batch.textures[i]->bind(i);
+					}
+				}
+				defaultMesh->vertexArray.submit(-1, batch.count, baseInstance + batch.begin);
+				stats.drawCalls++;
+			}
+			instanceBuffer->fenceStream();
+			RenderState::get().setBlend(BlendMode::ALPHA);
 		}
+
 		if (frameBuffer) {
 			frameBuffer->unbind();
 		}
 	}
 
+	const Renderer2D::Stats& Renderer2D::getStats() {
+		return stats;
+	}
+
 }
@@ -1,4 +1,3 @@
-
 #pragma once
 
 #include "FrameBuffer.h"
@@ -6,32 +5,132 @@
 #include "VertexArray.h"
 #include "Texture.h"
 #include "Mesh.h"
+#include <unordered_map>
+#include <thread>
+#include <mutex>
 
 namespace baseline {
 
+	//instances are sorted by layer, blend mode and texture and drawn in as few draw calls as possible
+	//within a layer the submission order is only kept for instances with the same blend mode and texture
 	class Renderer2D {
 	public:
 		std::shared_ptr<FrameBuffer> frameBuffer;
 
+		//compact instance data, the transform is built in the vertex shader
+		class Sprite {
+		public:
+			glm::vec2 position = glm::vec2(0);
+			glm::vec2 scale = glm::vec2(1);
+			float rotation = 0;
+			Color color = color::white;
+		};
+
+		class Stats {
+		public:
+			int drawCalls = 0;
+			int instances = 0;
+			int textures = 0;
+			//threads that submitted
+			int contexts = 0;
+		};
+
+	private:
+		class Instance {
+		public:
+			Sprite sprite;
+			//texture slot in the batch
+			uint8_t slot;
+			uint8_t circle;
+			uint8_t padding[2];
+		};
+
+	public:
+		//submissions of one thread, filled without locks and merged in end()
+		class Context {
+		public:
+			void submitQuad(glm::vec2 pos, glm::vec2 scale, float rotation = 0, Texture* texture = nullptr, Color color = color::white, int layer = 0, BlendMode blend = BlendMode::ALPHA);
+			void submitCircle(glm::vec2 pos, glm::vec2 scale, Texture* texture = nullptr, Color color = color::white, int layer = 0, BlendMode blend = BlendMode::ALPHA);
+			//submits quads that share texture, layer and blend mode with one key and one copy per sprite
+			void submitQuads(const Sprite* sprites, int count, Texture* texture = nullptr, int layer = 0, BlendMode blend = BlendMode::ALPHA);
+
+		private:
+			friend class Renderer2D;
+			std::vector<Instance> instances;
+			//layer, blend mode and texture in the high bits, the instance index in the low bits
+			std::vector<uint64_t> keys;
+			//textures used by this context, the index is part of the sort key
+			std::vector<Texture*> textures;
+			std::unordered_map<Texture*, uint32_t> textureIndices;
+			Texture* lastTexture = nullptr;
+			int lastTextureIndex = -1;
+
+			void submit(const Sprite& sprite, Texture* texture, bool circle, int layer, BlendMode blend);
+			uint64_t getKey(Texture* texture, int layer, BlendMode blend);
+			uint32_t getTextureIndex(Texture* texture);
+			void clear();
+		};
+
+		Renderer2D();
 		void init(bool useFrameBuffer, int resolutionX = 0, int resolutionY = 0);
-		void submitQuad(glm::vec2 pos, glm::vec2 scale, float rotation = 0, Texture* texture = nullptr, Color color = color::white);
-		void submitCircle(glm::vec2 pos, glm::vec2 scale, Texture* texture = nullptr, Color color = color::white);
+		//the submit functions can be called from any thread, they use the context of the calling thread
+		void submitQuad(glm::vec2 pos, glm::vec2 scale, float rotation = 0, Texture* texture = nullptr, Color color = color::white, int layer = 0, BlendMode blend = BlendMode::ALPHA);
+		void submitCircle(glm::vec2 pos, glm::vec2 scale, Texture* texture = nullptr, Color color = color::white, int layer = 0, BlendMode blend = BlendMode::ALPHA);
+		void submitQuads(const Sprite* sprites, int count, Texture* texture = nullptr, int layer = 0, BlendMode blend = BlendMode::ALPHA);
+		//context of the calling thread, only the first call of a thread takes a lock
+		Context& getContext();
 		void begin(const glm::mat4& cameraMatrix = glm::mat4(1), bool clear = true);
+		//merges the contexts of all threads, submission has to be finished when this is called
+		//instances of different threads are ordered by the first submission of each thread
 		void end();
+		//stats of the last end()
+		const Stats& getStats();
 
 	private:
+		//size of the sampler array in the shader
+		static constexpr int maxTextureSlotCount = 16;
+
 		std::shared_ptr<Shader> shader;
+		Shader::Uniform projectionUniform;
 		std::shared_ptr<Texture> defaultTexture;
 		std::shared_ptr<Mesh> defaultMesh;
 		std::shared_ptr<Buffer> instanceBuffer;
+		//the instance buffer is recreated when it grows
+		uint32_t instanceCapacity = 0;
+		int maxTextureSlots = 1;
+		Stats stats;
 
-		class Instance {
+		uint64_t rendererId;
+		std::vector<std::unique_ptr<Context>> contexts;
+		std::unordered_map<std::thread::id, Context*> threadContexts;
+		std::mutex contextMutex;
+		static thread_local uint64_t cachedRendererId;
+		static thread_local Context* cachedContext;
+
+		//all contexts merged, the texture index in the keys refers to the merged textures
+		std::vector<Instance> instances;
+		std::vector<uint64_t> keys;
+		std::vector<uint64_t> sortBuffer;
+		std::vector<Texture*> textures;
+		std::unordered_map<Texture*, uint32_t> textureIndices;
+		std::vector<uint32_t> textureRemap;
+
+		class Batch {
 		public:
-			glm::mat4 transform;
-			glm::vec4 color;
+			int begin = 0;
+			int count = 0;
+			BlendMode blend = BlendMode::ALPHA;
+			//indexed by texture unit, units can be free
+			Texture* textures[maxTextureSlotCount] = {};
+			int textureCount = 0;
 		};
-		std::vector<Instance> quadInstances;
-		std::vector<Instance> circleInstances;
+		std::vector<Batch> batches;
+		//unit of each texture in the last batch that used it
+		std::vector<int> textureSlots;
+
+		Context& addContext();
+		void mergeContexts();
+		void sortKeys();
 	};
 
-}
\ No newline at end of file
+}
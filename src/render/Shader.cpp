@@ -4,11 +4,13 @@
 
 #include "Shader.h"
 #include "ShaderState.h"
+#include "RenderState.h"
 #include "common/Log.h"
 #include "common/strutil.h"
 #include "GL/glew.h"
 #include <fstream>
 #include <filesystem>
+#include <cstring>
 
 using namespace baseline;
 
@@ -21,17 +23,14 @@ namespace baseline {
 
     Shader::~Shader() {
         if(id != 0){
+            RenderState::get().removeProgram(id);
             glDeleteProgram(id);
             id = 0;
         }
     }
 
     void bindShader(uint32_t id){
-        static uint32_t currentId = 0;
-        if(id != currentId){
-            glUseProgram(id);
-            currentId = id;
-        }
+        RenderState::get().bindProgram(id);
     }
 
     void Shader::bind() {
@@ -190,9 +189,17 @@ namespace baseline {
             glDetachShader(programId, shaderId);
             glDeleteShader(shaderId);
         }
+        if(id != 0){
+            RenderState::get().removeProgram(id);
+            glDeleteProgram(id);
+        }
         id = programId;
         Log::trace("loaded shader %s", file.c_str());
-        locations.clear();
+        //handles stay valid, the values of the new program are not known
+        for(auto &uniform : uniforms){
+            uniform.location = glGetUniformLocation(id, uniform.name.c_str());
+            uniform.size = 0;
+        }
         bufferLocations.clear();
         return true;
     }
@@ -206,107 +213,231 @@ namespace baseline {
     }
 
     void Shader::set(const std::string &uniform, int value) {
-        glUniform1i(getLocation(uniform), value);
-        state->set(uniform, value);
+        set(getUniform(uniform), value);
     }
 
     void Shader::set(const std::string &uniform, float value) {
-        glUniform1f(getLocation(uniform), value);
-        state->set(uniform, value);
+        set(getUniform(uniform), value);
     }
 
     void Shader::set(const std::string &uniform, const glm::vec2 &value) {
-        glUniform2f(getLocation(uniform), value.x, value.y);
-        state->set(uniform, value);
+        set(getUniform(uniform), value);
     }
 
     void Shader::set(const std::string &uniform, const glm::vec3 &value) {
-        glUniform3f(getLocation(uniform), value.x, value.y, value.z);
-        state->set(uniform, value);
+        set(getUniform(uniform), value);
     }
 
     void Shader::set(const std::string &uniform, const glm::vec4 &value) {
-        glUniform4f(getLocation(uniform), value.x, value.y, value.z, value.w);
-        state->set(uniform, value);
+        set(getUniform(uniform), value);
     }
 
     void Shader::set(const std::string &uniform, const glm::mat2 &value) {
-        glUniformMatrix2fv(getLocation(uniform), 1, GL_FALSE, (float*)&value);
-        state->set(uniform, value);
+        set(getUniform(uniform), value);
     }
 
     void Shader::set(const std::string &uniform, const glm::mat3 &value) {
-        glUniformMatrix3fv(getLocation(uniform), 1, GL_FALSE, (float*)&value);
-        state->set(uniform, value);
+        set(getUniform(uniform), value);
     }
 
     void Shader::set(const std::string &uniform, const glm::mat4 &value) {
-        glUniformMatrix4fv(getLocation(uniform), 1, GL_FALSE, (float*)&value);
-        state->set(uniform, value);
+        set(getUniform(uniform), value);
     }
 
     void Shader::set(const std::string &uniform, int *values, int count) {
-        glUniform1iv(getLocation(uniform), count, values);
-        state->set(uniform, values, count);
+        set(getUniform(uniform), values, count);
     }
 
     void Shader::set(const std::string &uniform, float *values, int count) {
-        glUniform1fv(getLocation(uniform), count, values);
-        state->set(uniform, values, count);
+        set(getUniform(uniform), values, count);
     }
 
     void Shader::set(const std::string &uniform, glm::vec2 *values, int count) {
-        glUniform2fv(getLocation(uniform), count, (float*)values);
-        state->set(uniform, values, count);
+        set(getUniform(uniform), values, count);
     }
 
     void Shader::set(const std::string &uniform, glm::vec3 *values, int count) {
-        glUniform3fv(getLocation(uniform), count, (float*)values);
-        state->set(uniform, values, count);
+        set(getUniform(uniform), values, count);
     }
 
     void Shader::set(const std::string &uniform, glm::vec4 *values, int count) {
-        glUniform4fv(getLocation(uniform), count, (float*)values);
-        state->set(uniform, values, count);
+        set(getUniform(uniform), values, count);
     }
 
     void Shader::set(const std::string &uniform, glm::mat2 *values, int count) {
-        glUniformMatrix2fv(getLocation(uniform), count, GL_FALSE, (float*)values);
-        state->set(uniform, values, count);
+        set(getUniform(uniform), values, count);
     }
 
     void Shader::set(const std::string &uniform, glm::mat3 *values, int count) {
-        glUniformMatrix3fv(getLocation(uniform), count, GL_FALSE, (float*)values);
-        state->set(uniform, values, count);
+        set(getUniform(uniform), values, count);
     }
 
     void Shader::set(const std::string &uniform, glm::mat4 *values, int count) {
-        glUniformMatrix4fv(getLocation(uniform), count, GL_FALSE, (float*)values);
-        state->set(uniform, values, count);
+        set(getUniform(uniform), values, count);
     }
 
     void Shader::set(const std::string &uniform, Buffer *buffer) {
         uint32_t location = getBufferLocation(uniform);
         if (location != -1) {
             glUniformBlockBinding(id, location, location);
-            glBindBufferBase(GL_UNIFORM_BUFFER, location, buffer->getId());
+            RenderState::get().bindBufferBase(BufferType::UNIFORM_BUFFER, location, buffer->getId());
         }
     }
 
-    uint32_t Shader::getLocation(const std::string &name, bool warn) {
-        auto entry = locations.find(name);
-        if(entry != locations.end()){
-            return entry->second;
-        }else{
-            uint32_t location = glGetUniformLocation(id, name.c_str());
-            if(location == -1 && warn){
-                Log::warning("uniform %s not found in shader %s", name.c_str(), file.c_str());
-            }
-            locations[name] = location;
-            return location;
+    void Shader::set(Uniform uniform, int value) {
+        if(UniformEntry *entry = update(uniform, &value, sizeof(value))){
+            glUniform1i(entry->location, value);
+            state->set(entry->name, value);
+        }
+    }
+
+    void Shader::set(Uniform uniform, float value) {
+        if(UniformEntry *entry = update(uniform, &value, sizeof(value))){
+            glUniform1f(entry->location, value);
+            state->set(entry->name, value);
+        }
+    }
+
+    void Shader::set(Uniform uniform, const glm::vec2 &value) {
+        if(UniformEntry *entry = update(uniform, &value, sizeof(value))){
+            glUniform2f(entry->location, value.x, value.y);
+            state->set(entry->name, value);
+        }
+    }
+
+    void Shader::set(Uniform uniform, const glm::vec3 &value) {
+        if(UniformEntry *entry = update(uniform, &value, sizeof(value))){
+            glUniform3f(entry->location, value.x, value.y, value.z);
+            state->set(entry->name, value);
+        }
+    }
+
+    void Shader::set(Uniform uniform, const glm::vec4 &value) {
+        if(UniformEntry *entry = update(uniform, &value, sizeof(value))){
+            glUniform4f(entry->location, value.x, value.y, value.z, value.w);
+            state->set(entry->name, value);
+        }
+    }
+
+    void Shader::set(Uniform uniform, const glm::mat2 &value) {
+        if(UniformEntry *entry = update(uniform, &value, sizeof(value))){
+            glUniformMatrix2fv(entry->location, 1, GL_FALSE, (float*)&value);
+            state->set(entry->name, value);
+        }
+    }
+
+    void Shader::set(Uniform uniform, const glm::mat3 &value) {
+        if(UniformEntry *entry = update(uniform, &value, sizeof(value))){
+            glUniformMatrix3fv(entry->location, 1, GL_FALSE, (float*)&value);
+            state->set(entry->name, value);
+        }
+    }
+
+    void Shader::set(Uniform uniform, const glm::mat4 &value) {
+        if(UniformEntry *entry = update(uniform, &value, sizeof(value))){
+            glUniformMatrix4fv(entry->location, 1, GL_FALSE, (float*)&value);
+            state->set(entry->name, value);
+        }
+    }
+
+    void Shader::set(Uniform uniform, int *values, int count) {
+        if(UniformEntry *entry = update(uniform, values, sizeof(int) * count)){
+            glUniform1iv(entry->location, count, values);
+            state->set(entry->name, values, count);
         }
     }
 
+    void Shader::set(Uniform uniform, float *values, int count) {
+        if(UniformEntry *entry = update(uniform, values, sizeof(float) * count)){
+            glUniform1fv(entry->location, count, values);
+            state->set(entry->name, values, count);
+        }
+    }
+
+    void Shader::set(Uniform uniform, glm::vec2 *values, int count) {
+        if(UniformEntry *entry = update(uniform, values, sizeof(glm::vec2) * count)){
+            glUniform2fv(entry->location, count, (float*)values);
+            state->set(entry->name, values, count);
+        }
+    }
+
+    void Shader::set(Uniform uniform, glm::vec3 *values, int count) {
+        if(UniformEntry *entry = update(uniform, values, sizeof(glm::vec3) * count)){
+            glUniform3fv(entry->location, count, (float*)values);
+            state->set(entry->name, values, count);
+        }
+    }
+
+    void Shader::set(Uniform uniform, glm::vec4 *values, int count) {
+        if(UniformEntry *entry = update(uniform, values, sizeof(glm::vec4) * count)){
+            glUniform4fv(entry->location, count, (float*)values);
+            state->set(entry->name, values, count);
+        }
+    }
+
+    void Shader::set(Uniform uniform, glm::mat2 *values, int count) {
+        if(UniformEntry *entry = update(uniform, values, sizeof(glm::mat2) * count)){
+            glUniformMatrix2fv(entry->location, count, GL_FALSE, (float*)values);
+            state->set(entry->name, values, count);
+        }
+    }
+
+    void Shader::set(Uniform uniform, glm::mat3 *values, int count) {
+        if(UniformEntry *entry = update(uniform, values, sizeof(glm::mat3) * count)){
+            glUniformMatrix3fv(entry->location, count, GL_FALSE, (float*)values);
+            state->set(entry->name, values, count);
+        }
+    }
+
+    void Shader::set(Uniform uniform, glm::mat4 *values, int count) {
+        if(UniformEntry *entry = update(uniform, values, sizeof(glm::mat4) * count)){
+            glUniformMatrix4fv(entry->location, count, GL_FALSE, (float*)values);
+            state->set(entry->name, values, count);
+        }
+    }
+
+    Shader::UniformEntry *Shader::update(Uniform uniform, const void *data, uint32_t size) {
+        if(uniform.index >= uniforms.size()){
+            return nullptr;
+        }
+        UniformEntry &entry = uniforms[uniform.index];
+        if(entry.location == -1){
+            return nullptr;
+        }
+        if(RenderState::get().skip(entry.size == size && memcmp(uniformValues.data() + entry.offset, data, size) == 0)){
+            return nullptr;
+        }
+        if(entry.capacity < size){
+            entry.offset = uniformValues.size();
+            entry.capacity = size;
+            uniformValues.resize(uniformValues.size() + size);
+        }
+        entry.size = size;
+        memcpy(uniformValues.data() + entry.offset, data, size);
+        //uniforms are set on the bound program
+        bind();
+        return &entry;
+    }
+
+    Shader::Uniform Shader::getUniform(const std::string &name, bool warn) {
+        auto entry = uniformIndices.find(name);
+        if(entry != uniformIndices.end()){
+            return { entry->second };
+        }
+        uint32_t location = glGetUniformLocation(id, name.c_str());
+        if(location == -1 && warn){
+            Log::warning("uniform %s not found in shader %s", name.c_str(), file.c_str());
+        }
+        uint32_t index = uniforms.size();
+        uniforms.push_back({ name, location, 0, 0, 0 });
+        uniformIndices[name] = index;
+        return { index };
+    }
+
+    uint32_t Shader::getLocation(const std::string &name, bool warn) {
+        return uniforms[getUniform(name, warn).index].location;
+    }
+
     uint32_t Shader::getBufferLocation(const std::string &name, bool warn) {
         auto entry = bufferLocations.find(name);
         if(entry != bufferLocations.end()){
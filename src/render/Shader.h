@@ -9,6 +9,7 @@
 #include <unordered_map>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace baseline {
 
@@ -16,6 +17,12 @@ namespace baseline {
 
     class Shader {
     public:
+        //precomputed uniform, stays valid when the shader is loaded again
+        class Uniform {
+        public:
+            uint32_t index = -1;
+        };
+
         std::shared_ptr<ShaderState> state;
 
         Shader();
@@ -47,17 +54,50 @@ namespace baseline {
         void set(const std::string &uniform, glm::mat4 *values, int count);
         void set(const std::string &uniform, Buffer *buffer);
 
+        //look up once and use instead of the name to skip the string hashing on every set
+        Uniform getUniform(const std::string &name, bool warn = true);
+        void set(Uniform uniform, int value);
+        void set(Uniform uniform, float value);
+        void set(Uniform uniform, const glm::vec2 &value);
+        void set(Uniform uniform, const glm::vec3 &value);
+        void set(Uniform uniform, const glm::vec4 &value);
+        void set(Uniform uniform, const glm::mat2 &value);
+        void set(Uniform uniform, const glm::mat3 &value);
+        void set(Uniform uniform, const glm::mat4 &value);
+        void set(Uniform uniform, int *values, int count);
+        void set(Uniform uniform, float *values, int count);
+        void set(Uniform uniform, glm::vec2 *values, int count);
+        void set(Uniform uniform, glm::vec3 *values, int count);
+        void set(Uniform uniform, glm::vec4 *values, int count);
+        void set(Uniform uniform, glm::mat2 *values, int count);
+        void set(Uniform uniform, glm::mat3 *values, int count);
+        void set(Uniform uniform, glm::mat4 *values, int count);
+
         uint32_t getLocation(const std::string &name, bool warn = true);
         uint32_t getBufferLocation(const std::string &name, bool warn = true);
         
     private:
+        class UniformEntry {
+        public:
+            std::string name;
+            uint32_t location;
+            //last value in uniformValues, uniform values are part of the program
+            uint32_t offset;
+            uint32_t capacity;
+            uint32_t size;
+        };
+
         uint32_t id;
         std::vector<std::pair<uint32_t, std::string>> sources;
-        std::unordered_map<std::string, uint32_t> locations;
+        std::vector<UniformEntry> uniforms;
+        std::unordered_map<std::string, uint32_t> uniformIndices;
+        std::vector<uint8_t> uniformValues;
         std::unordered_map<std::string, uint32_t> bufferLocations;
         std::string file;
 
         bool loadSourceFile(const std::string& file, std::string& source);
+        //the entry to set if the uniform does not have the value yet, otherwise nullptr
+        UniformEntry *update(Uniform uniform, const void *data, uint32_t size);
     };
 
 }
@@ -0,0 +1,173 @@
+//
+// Copyright (c) 2024 Julian Hinxlage. All rights reserved.
+//
+
+#include "ShaderState.h"
+#include <algorithm>
+#include <cstring>
+
+namespace baseline {
+
+    template<typename T>
+    static void applyValue(Shader *shader, const ShaderState::Value &value, uint8_t *data) {
+        if (value.array) {
+            shader->set(value.name, (T*)data, value.count);
+        } else {
+            shader->set(value.name, *(T*)data);
+        }
+    }
+
+    template<typename T>
+    static void copyValue(ShaderState *shaderState, const ShaderState::Value &value, uint8_t *data) {
+        if (value.array) {
+            shaderState->set(value.name, (T*)data, value.count);
+        } else {
+            shaderState->set(value.name, *(T*)data);
+        }
+    }
+
+    void ShaderState::write(const std::string &uniform, ValueType type, const void *source, uint32_t size, int count, bool array) {
+        uint32_t index;
+        auto entry = indices.find(uniform);
+        if (entry == indices.end()) {
+            index = (uint32_t)values.size();
+            indices[uniform] = index;
+            values.push_back({ uniform, type, count, array, (uint32_t)data.size(), size });
+            data.resize(data.size() + size);
+        } else {
+            index = entry->second;
+            Value &value = values[index];
+            if (value.size != size) {
+                //the old bytes stay unused until clear
+                value.offset = (uint32_t)data.size();
+                value.size = size;
+                data.resize(data.size() + size);
+            }
+            value.type = type;
+            value.count = count;
+            value.array = array;
+        }
+
+        Value &value = values[index];
+        if (data.data() + value.offset != source) {
+            memcpy(data.data() + value.offset, source, size);
+        }
+
+        uint32_t begin = value.offset;
+        uint32_t end = value.offset + size;
+        if (!changes.empty() && changes.back().first <= end && changes.back().second >= begin) {
+            changes.back().first = std::min(changes.back().first, begin);
+            changes.back().second = std::max(changes.back().second, end);
+        } else {
+            if (!changes.empty() && changes.back().second > begin) {
+                changesSorted = false;
+            }
+            changes.push_back({ begin, end });
+        }
+    }
+
+    void ShaderState::apply(Shader *shader) {
+        for (auto &value : values) {
+            apply(shader, value);
+        }
+    }
+
+    void ShaderState::applyChanges(Shader *shader) {
+        if (changes.empty()) {
+            return;
+        }
+        //the shader writes into its own state, which can be this one
+        std::vector<std::pair<uint32_t, uint32_t>> ranges;
+        getChanges();
+        ranges.swap(changes);
+        clearChanges();
+        for (auto &value : values) {
+            if (isChanged(ranges, value)) {
+                apply(shader, value);
+            }
+        }
+    }
+
+    void ShaderState::apply(ShaderState *shaderState) {
+        if (shaderState == this) {
+            return;
+        }
+        for (auto &value : values) {
+            apply(shaderState, value);
+        }
+    }
+
+    const std::vector<ShaderState::Value>& ShaderState::getValues() {
+        return values;
+    }
+
+    const uint8_t *ShaderState::getData() {
+        return data.data();
+    }
+
+    const std::vector<std::pair<uint32_t, uint32_t>>& ShaderState::getChanges() {
+        if (!changesSorted) {
+            std::sort(changes.begin(), changes.end());
+            uint32_t count = 0;
+            for (auto &range : changes) {
+                if (count > 0 && changes[count - 1].second >= range.first) {
+                    changes[count - 1].second = std::max(changes[count - 1].second, range.second);
+                } else {
+                    changes[count++] = range;
+                }
+            }
+            changes.resize(count);
+            changesSorted = true;
+        }
+        return changes;
+    }
+
+    void ShaderState::clearChanges() {
+        changes.clear();
+        changesSorted = true;
+    }
+
+    void ShaderState::clear() {
+        values.clear();
+        indices.clear();
+        data.clear();
+        clearChanges();
+    }
+
+    void ShaderState::apply(Shader *shader, const Value &value) {
+        uint8_t *ptr = data.data() + value.offset;
+        switch (value.type) {
+        case ValueType::INT: applyValue<int>(shader, value, ptr); break;
+        case ValueType::FLOAT: applyValue<float>(shader, value, ptr); break;
+        case ValueType::VEC2: applyValue<glm::vec2>(shader, value, ptr); break;
+        case ValueType::VEC3: applyValue<glm::vec3>(shader, value, ptr); break;
+        case ValueType::VEC4: applyValue<glm::vec4>(shader, value, ptr); break;
+        case ValueType::MAT2: applyValue<glm::mat2>(shader, value, ptr); break;
+        case ValueType::MAT3: applyValue<glm::mat3>(shader, value, ptr); break;
+        case ValueType::MAT4: applyValue<glm::mat4>(shader, value, ptr); break;
+        }
+    }
+
+    void ShaderState::apply(ShaderState *shaderState, const Value &value) {
+        uint8_t *ptr = data.data() + value.offset;
+        switch (value.type) {
+        case ValueType::INT: copyValue<int>(shaderState, value, ptr); break;
+        case ValueType::FLOAT: copyValue<float>(shaderState, value, ptr); break;
+        case ValueType::VEC2: copyValue<glm::vec2>(shaderState, value, ptr); break;
+        case ValueType::VEC3: copyValue<glm::vec3>(shaderState, value, ptr); break;
+        case ValueType::VEC4: copyValue<glm::vec4>(shaderState, value, ptr); break;
+        case ValueType::MAT2: copyValue<glm::mat2>(shaderState, value, ptr); break;
+        case ValueType::MAT3: copyValue<glm::mat3>(shaderState, value, ptr); break;
+        case ValueType::MAT4: copyValue<glm::mat4>(shaderState, value, ptr); break;
+        }
+    }
+
+    bool ShaderState::isChanged(const std::vector<std::pair<uint32_t, uint32_t>> &ranges, const Value &value) {
+        //first range that ends after the begin of the value
+        auto range = std::upper_bound(ranges.begin(), ranges.end(), value.offset, [](uint32_t offset, const std::pair<uint32_t, uint32_t> &range) {
+            return offset < range.second;
+        });
+        return range != ranges.end() && range->first < value.offset + value.size;
+    }
+
+}
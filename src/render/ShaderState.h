@@ -8,98 +8,75 @@
 
 namespace baseline {
 
+    //uniform values stored in one flat block of bytes
+    //writes are tracked as byte ranges, so only the changed values need to be applied again
     class ShaderState {
     public:
-        template<typename T>
-        void set(const std::string& uniform, T value) {
-            for (auto& state : states) {
-                if (state && state->name == uniform) {
-                    state = std::static_pointer_cast<Base>(std::make_shared<Value<T>>(uniform, value));
-                    return;
-                }
-            }
-            states.push_back(std::static_pointer_cast<Base>(std::make_shared<Value<T>>(uniform, value)));
-        }
-
-        template<typename T>
-        void set(const std::string& uniform, T *values, int count) {
-            for (auto& state : states) {
-                if (state && state->name == uniform) {
-                    state = std::static_pointer_cast<Base>(std::make_shared<Values<T>>(uniform, values, count));
-                    return;
-                }
-            }
-            states.push_back(std::static_pointer_cast<Base>(std::make_shared<Values<T>>(uniform, values, count)));
-        }
-
-        void apply(Shader *shader) {
-            for (auto& state : states) {
-                if (state) {
-                    state->apply(shader);
-                }
-            }
-        }
+        enum class ValueType {
+            INT,
+            FLOAT,
+            VEC2,
+            VEC3,
+            VEC4,
+            MAT2,
+            MAT3,
+            MAT4,
+        };
 
-    private:
-        class Base {
+        class Value {
         public:
             std::string name;
-            virtual void apply(Shader* shader) = 0;
-            virtual void apply(ShaderState* shaderState) = 0;
-
-            virtual void* getData() = 0;
+            ValueType type;
+            int count;
+            bool array;
+            uint32_t offset;
+            uint32_t size;
         };
 
         template<typename T>
-        class Value : public Base {
-        public:
-            T value;
-
-            Value(const std::string& name, T value) {
-                this->name = name;
-                this->value = value;
-            }
-            
-            void apply(Shader* shader) override {
-                shader->set(name, value);
-            }
-
-            void apply(ShaderState* shaderState) override {
-                shaderState->set(name, value);
-            }
-
-            virtual void* getData() {
-                return &value;
-            }
-        };
+        void set(const std::string& uniform, const T &value) {
+            write(uniform, valueType((T*)nullptr), &value, sizeof(T), 1, false);
+        }
 
         template<typename T>
-        class Values : public Base {
-        public:
-            std::vector<T> values;
-
-            Values(const std::string& name, T* values, int count) {
-                this->name = name;
-                this->values.insert(this->values.begin(), values, values + count);
-            }
-
-            void apply(Shader* shader) override {
-                shader->set(name, values.data(), (int)values.size());
-            }
-
-            void apply(ShaderState* shaderState) override {
-                shaderState->set(name, values.data(), (int)values.size());
-            }
+        void set(const std::string& uniform, const T *values, int count) {
+            write(uniform, valueType((T*)nullptr), values, sizeof(T) * count, count, true);
+        }
 
-            virtual void* getData() {
-                return &values;
-            }
-        };
+        //sets all values on the shader
+        void apply(Shader *shader);
+        //sets the values written since the last call and clears the changes
+        void applyChanges(Shader *shader);
+        //copies all values into another state
+        void apply(ShaderState *shaderState);
 
-        std::vector<std::shared_ptr<Base>> states;
+        const std::vector<Value>& getValues();
+        const uint8_t *getData();
+        //sorted and merged byte ranges [begin, end) written since the last clear
+        const std::vector<std::pair<uint32_t, uint32_t>>& getChanges();
+        void clearChanges();
+        void clear();
 
-    public:
-        const std::vector<std::shared_ptr<Base>>& getValues() { return states; }
+    private:
+        std::vector<Value> values;
+        std::unordered_map<std::string, uint32_t> indices;
+        std::vector<uint8_t> data;
+        std::vector<std::pair<uint32_t, uint32_t>> changes;
+        bool changesSorted = true;
+
+        static ValueType valueType(int*) { return ValueType::INT; }
+        static ValueType valueType(float*) { return ValueType::FLOAT; }
+        static ValueType valueType(glm::vec2*) { return ValueType::VEC2; }
+        static ValueType valueType(glm::vec3*) { return ValueType::VEC3; }
+        static ValueType valueType(glm::vec4*) { return ValueType::VEC4; }
+        static ValueType valueType(glm::mat2*) { return ValueType::MAT2; }
+        static ValueType valueType(glm::mat3*) { return ValueType::MAT3; }
+        static ValueType valueType(glm::mat4*) { return ValueType::MAT4; }
+
+        void write(const std::string &uniform, ValueType type, const void *source, uint32_t size, int count, bool array);
+        void apply(Shader *shader, const Value &value);
+        void apply(ShaderState *shaderState, const Value &value);
+        static bool isChanged(const std::vector<std::pair<uint32_t, uint32_t>> &ranges, const Value &value);
     };
 
-}
\ No newline at end of file
+}
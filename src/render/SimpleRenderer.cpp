@@ -14,7 +14,10 @@ layout (location=0) in vec3 vPosition;
 layout (location=1) in vec3 vNormal;
 layout (location=2) in vec2 vTexCoords;
 
-uniform mat4 uProjection = mat4(1);
+layout (std140) uniform Frame {
+	mat4 uProjection;
+	vec3 uLightDirection;
+};
 uniform mat4 uTransform = mat4(1);
 
 out vec2 fTexCoords;
@@ -34,7 +37,10 @@ in vec3 fNormal;
 
 uniform sampler2D uTexture;
 uniform vec4 uColor = vec4(1);
-uniform vec3 uLightDirection = vec3(0.5, -0.6, 0.7);
+layout (std140) uniform Frame {
+	mat4 uProjection;
+	vec3 uLightDirection;
+};
 
 out vec4 oColor;
 
@@ -44,6 +50,15 @@ void main(){
 	oColor = texture(uTexture, fTexCoords) * uColor * attenuation;
 }
 		)");
+		textureUniform = shader->getUniform("uTexture");
+		colorUniform = shader->getUniform("uColor");
+		transformUniform = shader->getUniform("uTransform");
+
+		frame.init(shader.get(), "Frame");
+		projectionMember = frame.getMember("uProjection");
+		lightDirectionMember = frame.getMember("uLightDirection");
+		frame.set(projectionMember, glm::mat4(1));
+		frame.set(lightDirectionMember, glm::vec3(0.5, -0.6, 0.7));
 
 		defaultTexture = std::make_shared<Texture>();
 		defaultTexture->create(1, 1);
@@ -73,7 +88,7 @@ void main(){
 		}
 	}
 
-	void SimpleRenderer::submit(glm::vec3 pos, Mesh* mesh, Texture* texture, Color color) {
+	void SimpleRenderer::submit(glm::vec3 pos, Mesh* mesh, Texture* texture, Color color, int lod) {
 		if (!texture) {
 			texture = defaultTexture.get();
 		}
@@ -82,10 +97,10 @@ void main(){
 		}
 		texture->bind(0);
 		shader->bind();
-		shader->set("uTexture", 0);
-		shader->set("uColor", color.vec());
-		shader->set("uTransform", glm::translate(glm::mat4(1), pos));
-		mesh->vertexArray.submit();
+		shader->set(textureUniform, 0);
+		shader->set(colorUniform, color.vec());
+		shader->set(transformUniform, glm::translate(glm::mat4(1), pos));
+		mesh->submit(lod);
 		texture->unbind();
 	}
 
@@ -94,8 +109,10 @@ void main(){
 			frameBuffer->bind();
 			frameBuffer->clear();
 		}
-		shader->set("uProjection", cameraMatrix);
-		shader->set("uLightDirection", lightDirection);
+		//per frame values are uploaded in one call
+		frame.set(projectionMember, cameraMatrix);
+		frame.set(lightDirectionMember, lightDirection);
+		frame.bind(shader.get());
 	}
 
 	void SimpleRenderer::end() {
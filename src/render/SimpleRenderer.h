@@ -3,6 +3,7 @@
 
 #include "FrameBuffer.h"
 #include "Shader.h"
+#include "UniformBuffer.h"
 #include "VertexArray.h"
 #include "Texture.h"
 #include "Mesh.h"
@@ -14,7 +15,7 @@ namespace baseline {
 		std::shared_ptr<FrameBuffer> frameBuffer;
 
 		void init(bool useFrameBuffer, int resolutionX = 0, int resolutionY = 0);
-		void submit(glm::vec3 pos, Mesh* mesh = nullptr, Texture* texture = nullptr, Color color = color::white);
+		void submit(glm::vec3 pos, Mesh* mesh = nullptr, Texture* texture = nullptr, Color color = color::white, int lod = 0);
 		void begin(const glm::mat4& cameraMatrix = glm::mat4(1), const glm::vec3& lightDirection = glm::vec3(0, 0, 1));
 		void end();
 
@@ -22,6 +23,12 @@ namespace baseline {
 		std::shared_ptr<Shader> shader;
 		std::shared_ptr<Texture> defaultTexture;
 		std::shared_ptr<Mesh> defaultMesh;
+		Shader::Uniform textureUniform;
+		Shader::Uniform colorUniform;
+		Shader::Uniform transformUniform;
+		UniformBuffer frame;
+		UniformBuffer::Member projectionMember;
+		UniformBuffer::Member lightDirectionMember;
 	};
 
 }
\ No newline at end of file
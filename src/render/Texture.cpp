@@ -3,6 +3,7 @@
 //
 
 #include "Texture.h"
+#include "RenderState.h"
 #include "common/Log.h"
 #include <GL/glew.h>
 #include <algorithm>
@@ -29,25 +30,19 @@ namespace baseline {
 
     Texture::~Texture() {
         if(id != 0){
+            RenderState::get().removeTexture(id);
             glDeleteTextures(1, &id);
             id = 0;
         }
     }
 
     void bindTexture(uint32_t id, TextureType type) {
-        static int32_t currentId;
-        if (currentId != id) {
-            glBindTexture(internalEnum(type), id);
-            currentId = id;
-        }
+        RenderState::get().bindTexture(type, id);
     }
 
     void bindTexture(uint32_t id, int32_t slot, TextureType type){
-        static int32_t currentIds[128];
-        if(slot >= 0 && currentIds[slot] != id){
-            glActiveTexture(GL_TEXTURE0 + slot);
-            glBindTexture(internalEnum(type), id);
-            currentIds[slot] = id;
+        if(slot >= 0){
+            RenderState::get().bindTexture(type, id, slot);
         }
     }
 
@@ -99,6 +94,7 @@ namespace baseline {
 
     void Texture::create(uint32_t width, uint32_t height, TextureFormat format, bool enableMipMapping) {
         if(id != 0){
+            RenderState::get().removeTexture(id);
             glDeleteTextures(1, &id);
             glGenTextures(1, &id);
         }
@@ -244,6 +240,7 @@ namespace baseline {
 
             if(id != 0){
                 unbind();
+                RenderState::get().removeTexture(id);
                 glDeleteTextures(1, &id);
                 glGenTextures(1, &id);
             }
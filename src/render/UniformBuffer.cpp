@@ -0,0 +1,197 @@
+//
+// Copyright (c) 2024 Julian Hinxlage. All rights reserved.
+//
+
+#include "UniformBuffer.h"
+#include "common/Log.h"
+#include <GL/glew.h>
+#include <algorithm>
+#include <cstring>
+
+namespace baseline {
+
+    UniformBuffer::UniformBuffer() {
+        changedBegin = 0;
+        changedEnd = 0;
+    }
+
+    bool UniformBuffer::init(Shader *shader, const std::string &block) {
+        this->block = block;
+        members.clear();
+        memberIndices.clear();
+        data.clear();
+        changedBegin = 0;
+        changedEnd = 0;
+
+        uint32_t program = shader->getId();
+        uint32_t blockIndex = shader->getBufferLocation(block);
+        if (blockIndex == -1) {
+            return false;
+        }
+
+        GLint size = 0;
+        GLint count = 0;
+        glGetActiveUniformBlockiv(program, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+        glGetActiveUniformBlockiv(program, blockIndex, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &count);
+        std::vector<GLint> indices(count);
+        if (count > 0) {
+            glGetActiveUniformBlockiv(program, blockIndex, GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES, indices.data());
+        }
+
+        std::vector<GLint> offsets(count);
+        std::vector<GLint> arrayStrides(count);
+        std::vector<GLint> matrixStrides(count);
+        std::vector<GLint> sizes(count);
+        if (count > 0) {
+            glGetActiveUniformsiv(program, count, (GLuint*)indices.data(), GL_UNIFORM_OFFSET, offsets.data());
+            glGetActiveUniformsiv(program, count, (GLuint*)indices.data(), GL_UNIFORM_ARRAY_STRIDE, arrayStrides.data());
+            glGetActiveUniformsiv(program, count, (GLuint*)indices.data(), GL_UNIFORM_MATRIX_STRIDE, matrixStrides.data());
+            glGetActiveUniformsiv(program, count, (GLuint*)indices.data(), GL_UNIFORM_SIZE, sizes.data());
+        }
+
+        for (int i = 0; i < count; i++) {
+            char name[256];
+            GLsizei length = 0;
+            glGetActiveUniformName(program, indices[i], sizeof(name), &length, name);
+            std::string memberName(name, length);
+            //arrays are reported as name[0]
+            if (memberName.size() > 3 && memberName.compare(memberName.size() - 3, 3, "[0]") == 0) {
+                memberName.resize(memberName.size() - 3);
+            }
+            memberIndices[memberName] = (uint32_t)members.size();
+            members.push_back({ memberName, (uint32_t)offsets[i], (uint32_t)arrayStrides[i], (uint32_t)matrixStrides[i], sizes[i] });
+        }
+
+        data.resize(size);
+        buffer.init(data.data(), size, 1, BufferType::UNIFORM_BUFFER, true);
+        return true;
+    }
+
+    UniformBuffer::Member UniformBuffer::getMember(const std::string &name, bool warn) {
+        auto entry = memberIndices.find(name);
+        if (entry != memberIndices.end()) {
+            return { entry->second };
+        }
+        if (warn) {
+            Log::warning("uniform %s not found in block %s", name.c_str(), block.c_str());
+        }
+        return {};
+    }
+
+    void UniformBuffer::set(Member member, int value) {
+        write(member, &value, sizeof(value), 1, 1);
+    }
+
+    void UniformBuffer::set(Member member, float value) {
+        write(member, &value, sizeof(value), 1, 1);
+    }
+
+    void UniformBuffer::set(Member member, const glm::vec2 &value) {
+        write(member, &value, sizeof(value), 1, 1);
+    }
+
+    void UniformBuffer::set(Member member, const glm::vec3 &value) {
+        write(member, &value, sizeof(value), 1, 1);
+    }
+
+    void UniformBuffer::set(Member member, const glm::vec4 &value) {
+        write(member, &value, sizeof(value), 1, 1);
+    }
+
+    void UniformBuffer::set(Member member, const glm::mat2 &value) {
+        write(member, &value, sizeof(glm::vec2), 2, 1);
+    }
+
+    void UniformBuffer::set(Member member, const glm::mat3 &value) {
+        write(member, &value, sizeof(glm::vec3), 3, 1);
+    }
+
+    void UniformBuffer::set(Member member, const glm::mat4 &value) {
+        write(member, &value, sizeof(glm::vec4), 4, 1);
+    }
+
+    void UniformBuffer::set(Member member, const int *values, int count) {
+        write(member, values, sizeof(int), 1, count);
+    }
+
+    void UniformBuffer::set(Member member, const float *values, int count) {
+        write(member, values, sizeof(float), 1, count);
+    }
+
+    void UniformBuffer::set(Member member, const glm::vec2 *values, int count) {
+        write(member, values, sizeof(glm::vec2), 1, count);
+    }
+
+    void UniformBuffer::set(Member member, const glm::vec3 *values, int count) {
+        write(member, values, sizeof(glm::vec3), 1, count);
+    }
+
+    void UniformBuffer::set(Member member, const glm::vec4 *values, int count) {
+        write(member, values, sizeof(glm::vec4), 1, count);
+    }
+
+    void UniformBuffer::set(Member member, const glm::mat2 *values, int count) {
+        write(member, values, sizeof(glm::vec2), 2, count);
+    }
+
+    void UniformBuffer::set(Member member, const glm::mat3 *values, int count) {
+        write(member, values, sizeof(glm::vec3), 3, count);
+    }
+
+    void UniformBuffer::set(Member member, const glm::mat4 *values, int count) {
+        write(member, values, sizeof(glm::vec4), 4, count);
+    }
+
+    void UniformBuffer::update() {
+        if (changedBegin < changedEnd) {
+            buffer.setData(data.data() + changedBegin, changedEnd - changedBegin, changedBegin);
+            changedBegin = 0;
+            changedEnd = 0;
+        }
+    }
+
+    void UniformBuffer::bind(Shader *shader) {
+        update();
+        shader->set(block, &buffer);
+    }
+
+    Buffer *UniformBuffer::getBuffer() {
+        return &buffer;
+    }
+
+    void UniformBuffer::write(Member member, const void *values, uint32_t columnSize, int columns, int count) {
+        if (member.index >= members.size()) {
+            return;
+        }
+        MemberEntry &entry = members[member.index];
+        count = std::min(count, entry.count);
+        if (count <= 0) {
+            return;
+        }
+
+        //std140 pads array elements and matrix columns, so a tightly packed source is copied column by column
+        const uint8_t *source = (const uint8_t*)values;
+        uint32_t begin = entry.offset;
+        uint32_t end = begin;
+        for (int i = 0; i < count; i++) {
+            for (int c = 0; c < columns; c++) {
+                uint32_t offset = entry.offset + i * entry.arrayStride + c * entry.matrixStride;
+                if (offset + columnSize > data.size()) {
+                    break;
+                }
+                memcpy(data.data() + offset, source, columnSize);
+                source += columnSize;
+                end = std::max(end, offset + columnSize);
+            }
+        }
+
+        if (changedBegin == changedEnd) {
+            changedBegin = begin;
+            changedEnd = end;
+        } else {
+            changedBegin = std::min(changedBegin, begin);
+            changedEnd = std::max(changedEnd, end);
+        }
+    }
+
+}
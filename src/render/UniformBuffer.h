@@ -0,0 +1,71 @@
+//
+// Copyright (c) 2024 Julian Hinxlage. All rights reserved.
+//
+
+#pragma once
+
+#include "Shader.h"
+
+namespace baseline {
+
+    //cpu copy of a uniform block, the bytes changed since the last update are uploaded in one call
+    //declare the block with layout(std140) to use the same buffer in multiple shaders
+    class UniformBuffer {
+    public:
+        class Member {
+        public:
+            uint32_t index = -1;
+        };
+
+        UniformBuffer();
+
+        //reads the size and the member layout of the block from the shader
+        bool init(Shader *shader, const std::string &block);
+        Member getMember(const std::string &name, bool warn = true);
+
+        void set(Member member, int value);
+        void set(Member member, float value);
+        void set(Member member, const glm::vec2 &value);
+        void set(Member member, const glm::vec3 &value);
+        void set(Member member, const glm::vec4 &value);
+        void set(Member member, const glm::mat2 &value);
+        void set(Member member, const glm::mat3 &value);
+        void set(Member member, const glm::mat4 &value);
+        void set(Member member, const int *values, int count);
+        void set(Member member, const float *values, int count);
+        void set(Member member, const glm::vec2 *values, int count);
+        void set(Member member, const glm::vec3 *values, int count);
+        void set(Member member, const glm::vec4 *values, int count);
+        void set(Member member, const glm::mat2 *values, int count);
+        void set(Member member, const glm::mat3 *values, int count);
+        void set(Member member, const glm::mat4 *values, int count);
+
+        //uploads the changed bytes
+        void update();
+        //updates and binds the buffer to the block of the shader
+        void bind(Shader *shader);
+        Buffer *getBuffer();
+
+    private:
+        class MemberEntry {
+        public:
+            std::string name;
+            uint32_t offset;
+            uint32_t arrayStride;
+            uint32_t matrixStride;
+            int count;
+        };
+
+        std::string block;
+        std::vector<MemberEntry> members;
+        std::unordered_map<std::string, uint32_t> memberIndices;
+        std::vector<uint8_t> data;
+        uint32_t changedBegin;
+        uint32_t changedEnd;
+        Buffer buffer;
+
+        //columns of columnSize bytes per element, matrices have one column per vector
+        void write(Member member, const void *values, uint32_t columnSize, int columns, int count);
+    };
+
+}
@@ -3,6 +3,7 @@
 //
 
 #include "VertexArray.h"
+#include "RenderState.h"
 #include <GL/glew.h>
 
 namespace baseline {
@@ -19,6 +20,8 @@ namespace baseline {
         id = 0;
         nextAttribute = 0;
         primitive = Primitive::TRIANGLES;
+        baseInstanceSupported = false;
+        instanceOffset = 0;
     }
 
     VertexArray::VertexArray(const VertexArray &vertexArray) : VertexArray() {
@@ -35,11 +38,7 @@ namespace baseline {
     }
 
     void bindVertexArray(uint32_t id){
-        static uint32_t currentId = 0;
-        if(currentId != id){
-            glBindVertexArray(id);
-            currentId = id;
-        }
+        RenderState::get().bindVertexArray(id);
     }
 
     void VertexArray::bind() {
@@ -70,42 +69,86 @@ namespace baseline {
             glGenVertexArrays(1, &id);
         }
         bind();
-        vertexBuffer->unbind();
-        vertexBuffer->bind();
         this->vertexBuffer.push_back({vertexBuffer, layout, divisor});
+        setAttributes(this->vertexBuffer.back(), nextAttribute, divisor != 0 ? instanceOffset : 0);
+        if(divisor != 0){
+            baseInstanceSupported = GLEW_ARB_base_instance || GLEW_VERSION_4_2;
+        }
+        unbind();
+    }
+
+    void VertexArray::updateVertexBuffers() {
+        bind();
+        uint32_t attribute = 0;
+        for(auto &buffer : vertexBuffer){
+            setAttributes(buffer, attribute);
+        }
+        instanceOffset = 0;
+        unbind();
+    }
+
+    void VertexArray::setInstanceOffset(int baseInstance) {
+        if(baseInstance == instanceOffset){
+            return;
+        }
+        uint32_t attribute = 0;
+        for(auto &buffer : vertexBuffer){
+            if(buffer.divisor == 0){
+                attribute += (uint32_t)buffer.layout.size();
+            }else{
+                setAttributes(buffer, attribute, baseInstance);
+            }
+        }
+        instanceOffset = baseInstance;
+    }
+
+    void VertexArray::setAttributes(VBuffer &buffer, uint32_t &attribute, int baseInstance) {
+        buffer.vertexBuffer->unbind();
+        buffer.vertexBuffer->bind();
 
         int stride = 0;
-        for(auto &a : layout){
+        for(auto &a : buffer.layout){
             a.offset = stride;
             stride += a.size * a.count;
         }
 
-        for(auto &a : layout){
-            glEnableVertexAttribArray(nextAttribute);
-            glVertexAttribPointer(nextAttribute, a.count, internalEnum(a.type), a.normalized ? GL_TRUE : GL_FALSE, stride, (void*)(size_t)a.offset);
-            glVertexAttribDivisor(nextAttribute, divisor);
-            nextAttribute++;
+        //the base instance is added after the divisor, so the offset is one stride per instance
+        size_t offset = (size_t)baseInstance * stride;
+        for(auto &a : buffer.layout){
+            glEnableVertexAttribArray(attribute);
+            glVertexAttribPointer(attribute, a.count, internalEnum(a.type), a.normalized ? GL_TRUE : GL_FALSE, stride, (void*)(offset + a.offset));
+            glVertexAttribDivisor(attribute, buffer.divisor);
+            attribute++;
         }
-        unbind();
     }
 
-    void VertexArray::submit(int vertexCount, int instanceCount) {
+    void VertexArray::submit(int vertexCount, int instanceCount, int baseInstance, int firstIndex) {
         bind();
         if(vertexCount == -1){
-            vertexCount = getVertexCount();
+            vertexCount = getVertexCount() - firstIndex;
         }
+        void *offset = indexBuffer.empty() ? nullptr : (void*)((size_t)firstIndex * internalEnumSize(indexBuffer[0].type));
 
         if(instanceCount == -1) {
             if (indexBuffer.empty()) {
-                glDrawArrays(internalEnum(primitive), 0, vertexCount);
+                glDrawArrays(internalEnum(primitive), firstIndex, vertexCount);
+            } else {
+                glDrawElements(internalEnum(primitive), vertexCount, internalEnum(indexBuffer[0].type), offset);
+            }
+        }else if(baseInstance == 0 || !baseInstanceSupported){
+            //one attribute update per draw instead of the base instance
+            setInstanceOffset(baseInstanceSupported ? 0 : baseInstance);
+            if (indexBuffer.empty()) {
+                glDrawArraysInstanced(internalEnum(primitive), firstIndex, vertexCount, instanceCount);
             } else {
-                glDrawElements(internalEnum(primitive), vertexCount, internalEnum(indexBuffer[0].type), nullptr);
+                glDrawElementsInstanced(internalEnum(primitive), vertexCount, internalEnum(indexBuffer[0].type), offset, instanceCount);
             }
         }else{
+            setInstanceOffset(0);
             if (indexBuffer.empty()) {
-                glDrawArraysInstanced(internalEnum(primitive), 0, vertexCount, instanceCount);
+                glDrawArraysInstancedBaseInstance(internalEnum(primitive), firstIndex, vertexCount, instanceCount, baseInstance);
             } else {
-                glDrawElementsInstanced(internalEnum(primitive), vertexCount, internalEnum(indexBuffer[0].type), nullptr, instanceCount);
+                glDrawElementsInstancedBaseInstance(internalEnum(primitive), vertexCount, internalEnum(indexBuffer[0].type), offset, instanceCount, baseInstance);
             }
         }
         unbind();
@@ -117,10 +160,12 @@ namespace baseline {
 
     void VertexArray::clear() {
         if(id != 0){
+            RenderState::get().removeVertexArray(id);
             glDeleteVertexArrays(1, &id);
             id = 0;
         }
         nextAttribute = 0;
+        instanceOffset = 0;
         vertexBuffer.clear();
         indexBuffer.clear();
     }
@@ -35,7 +35,12 @@ namespace baseline {
 
         void addIndexBuffer(const std::shared_ptr<Buffer> &indexBuffer, Type type);
         void addVertexBuffer(const std::shared_ptr<Buffer> &vertexBuffer, std::vector<Attribute> layout, int divisor = 0);
-        void submit(int vertexCount = -1, int instanceCount = -1);
+        //sets the attributes again, needed when a buffer was recreated
+        void updateVertexBuffers();
+        //baseInstance is the first instance read from buffers with a divisor
+        //without GL 4.2 or ARB_base_instance the attributes of those buffers are offset instead
+        //firstIndex is the first element of the index buffer, used for ranges like mesh lods
+        void submit(int vertexCount = -1, int instanceCount = -1, int baseInstance = 0, int firstIndex = 0);
         void setPrimitive(Primitive primitive);
         void clear();
         int getVertexCount();
@@ -44,6 +49,9 @@ namespace baseline {
         uint32_t id;
         uint32_t nextAttribute;
         Primitive primitive;
+        bool baseInstanceSupported;
+        //base instance the attributes of buffers with a divisor currently point at
+        int instanceOffset;
 
         class IBuffer{
         public:
@@ -59,6 +67,9 @@ namespace baseline {
             int divisor;
         };
         std::vector<VBuffer> vertexBuffer;
+
+        void setAttributes(VBuffer &buffer, uint32_t &attribute, int baseInstance = 0);
+        void setInstanceOffset(int baseInstance);
     };
 
 }
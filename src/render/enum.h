@@ -64,6 +64,13 @@ namespace baseline {
         UNIFORM_BUFFER,
     };
 
+    enum class BlendMode{
+        ALPHA,
+        ADDITIVE,
+        MULTIPLY,
+        NONE,
+    };
+
     uint32_t internalEnum(Type type);
     uint32_t internalEnum(Primitive primitive);
     uint32_t internalEnum(TextureAttachment attachment);
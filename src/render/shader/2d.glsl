@@ -6,41 +6,71 @@ layout (location=0) in vec3 vPosition;
 layout (location=1) in vec3 vNormal;
 layout (location=2) in vec2 vTexCoords;
 
-layout (location=3) in mat4 iTransform;
-layout (location=7) in vec4 iColor;
+layout (location=3) in vec2 iPosition;
+layout (location=4) in vec2 iScale;
+layout (location=5) in float iRotation;
+layout (location=6) in vec4 iColor;
+layout (location=7) in vec4 iParams;
 
 uniform mat4 uProjection = mat4(1);
 
 out vec2 fTexCoords;
-out vec3 fNormal;
 out vec3 fPosition;
 out vec4 fColor;
+flat out int fTexture;
+flat out float fSize;
 
 void main(){
-	gl_Position = uProjection * iTransform * vec4(vPosition, 1.0);
+	//same as translate * scale * rotate
+	float c = cos(iRotation);
+	float s = sin(iRotation);
+	vec2 position = vec2(c * vPosition.x - s * vPosition.y, s * vPosition.x + c * vPosition.y);
+	gl_Position = uProjection * vec4(position * iScale + iPosition, 0.0, 1.0);
 	fTexCoords = vTexCoords;
 	fPosition = vPosition * 2;
-	fNormal = normalize(vec3(transpose(inverse(iTransform)) * vec4(vNormal, 0.0)));
 	fColor = iColor;
+	fTexture = int(iParams.x);
+	fSize = iParams.y != 0 ? 1 : 4;
 }
 
 #type fragment
 #version 400 core
 
 in vec2 fTexCoords;
-in vec3 fNormal;
 in vec3 fPosition;
 in vec4 fColor;
+flat in int fTexture;
+flat in float fSize;
 
-uniform sampler2D uTexture;
-uniform float uSize = 1;
+uniform sampler2D uTextures[16];
 
 out vec4 oColor;
 
+vec4 sampleTexture(int slot, vec2 texCoords){
+	switch(slot){
+		case 0: return texture(uTextures[0], texCoords);
+		case 1: return texture(uTextures[1], texCoords);
+		case 2: return texture(uTextures[2], texCoords);
+		case 3: return texture(uTextures[3], texCoords);
+		case 4: return texture(uTextures[4], texCoords);
+		case 5: return texture(uTextures[5], texCoords);
+		case 6: return texture(uTextures[6], texCoords);
+		case 7: return texture(uTextures[7], texCoords);
+		case 8: return texture(uTextures[8], texCoords);
+		case 9: return texture(uTextures[9], texCoords);
+		case 10: return texture(uTextures[10], texCoords);
+		case 11: return texture(uTextures[11], texCoords);
+		case 12: return texture(uTextures[12], texCoords);
+		case 13: return texture(uTextures[13], texCoords);
+		case 14: return texture(uTextures[14], texCoords);
+		default: return texture(uTextures[15], texCoords);
+	}
+}
+
 void main(){
-	if(fPosition.x * fPosition.x + fPosition.y * fPosition.y > uSize){
+	if(fPosition.x * fPosition.x + fPosition.y * fPosition.y > fSize){
 		discard;
 	}
-	oColor = texture(uTexture, fTexCoords) * fColor;
+	oColor = sampleTexture(fTexture, fTexCoords) * fColor;
 }
-)"
\ No newline at end of file
+)"
@@ -34,3 +34,5 @@ extern "C" void load() {
 		updateTestWindow();
 	});
 }
+
+BL_MODULE_FUNCTIONS(BL_MODULE_FUNCTION(load), BL_MODULE_FUNCTION(unload))
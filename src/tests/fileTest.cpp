@@ -0,0 +1,67 @@
+//
+// Copyright (c) 2024 Julian Hinxlage. All rights reserved.
+//
+
+#include "common/File.h"
+#include "common/strutil.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+using namespace baseline;
+
+static int failures = 0;
+
+static void check(bool condition, const char* message) {
+	if (!condition) {
+		printf("failed: %s\n", message);
+		failures++;
+	}
+}
+
+int main() {
+	std::string file = (std::filesystem::temp_directory_path() / "fileTest.txt").string();
+	std::string oldText(100000, 'a');
+	std::string newText(50000, 'b');
+
+	check(writeFile(file, oldText, true), "write");
+	check(readFile(file, true) == oldText, "read after write");
+
+	{
+		//replacing a file that is mapped, the view keeps the old content
+		FileView view;
+		check(view.open(file), "open view");
+		check(writeFile(file, newText, true), "write while mapped");
+		check(view.size() == oldText.size() && memcmp(view.data(), oldText.data(), oldText.size()) == 0, "view keeps the old content");
+		check(readFile(file, true) == newText, "read after write while mapped");
+
+		//and replacing it again while both versions are still in use
+		FileView view2;
+		check(view2.open(file), "open second view");
+		check(writeFile(file, oldText, true), "second write while mapped");
+		check(view2.view() == newText, "second view keeps its content");
+	}
+
+	{
+		FileReader reader;
+		check(reader.open(file, 4096), "open reader");
+		check(writeFile(file, newText, true), "write while read");
+		std::string text;
+		for (auto chunk = reader.read(); !chunk.empty(); chunk = reader.read()) {
+			text.append(chunk);
+		}
+		check(text == oldText, "reader keeps the old content");
+	}
+	check(readFile(file, true) == newText, "read after the views are closed");
+
+	std::error_code error;
+	std::filesystem::remove(file, error);
+	for (int i = 0; i < 16; i++) {
+		std::filesystem::remove(file + ".old" + std::to_string(i), error);
+	}
+
+	if (failures == 0) {
+		printf("file test passed\n");
+	}
+	return failures == 0 ? 0 : 1;
+}
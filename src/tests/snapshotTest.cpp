@@ -0,0 +1,128 @@
+//
+// Copyright (c) 2024 Julian Hinxlage. All rights reserved.
+//
+
+#include "core/Snapshot.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+
+using namespace baseline;
+
+class ParticleV1 {
+public:
+	float x = 0;
+	float y = 0;
+	int id = 0;
+};
+REG_TYPE_3(ParticleV1, x, y, id);
+
+//reordered, x widened to double, y removed and z added
+class ParticleV2 {
+public:
+	int id = 0;
+	double x = 0;
+	float z = 7;
+};
+REG_TYPE_3(ParticleV2, id, x, z);
+
+static int failures = 0;
+
+static void check(bool condition, const char* message) {
+	if (!condition) {
+		printf("failed: %s\n", message);
+		failures++;
+	}
+}
+
+int main() {
+	std::string file = (std::filesystem::temp_directory_path() / "snapshotTest.snap").string();
+	std::string convertedFile = file + ".converted";
+
+	std::vector<ParticleV1> particles(1000);
+	for (int i = 0; i < particles.size(); i++) {
+		particles[i] = { i * 0.5f, i * 2.0f, i };
+	}
+	std::vector<int> values = { 1, 2, 3 };
+
+	{
+		Snapshot snapshot;
+		snapshot.add("particles", particles.data(), particles.size());
+		check(snapshot.save(file), "save");
+	}
+
+	{
+		Snapshot snapshot;
+		check(snapshot.load(file), "load");
+		int count = 0;
+		ParticleV1* loaded = snapshot.get<ParticleV1>("particles", &count);
+		check(count == particles.size(), "count after load");
+		check(snapshot.isInPlace("particles", Reflection::getType<ParticleV1>()), "same layout is used in place");
+		check(loaded && memcmp(loaded, particles.data(), particles.size() * sizeof(ParticleV1)) == 0, "data after load");
+
+		ParticleV2* converted = snapshot.get<ParticleV2>("particles", &count);
+		check(!snapshot.isInPlace("particles", Reflection::getType<ParticleV2>()), "changed layout is converted");
+		bool equal = converted != nullptr;
+		for (int i = 0; equal && i < count; i++) {
+			equal = converted[i].id == i && converted[i].x == i * 0.5 && converted[i].z == 7;
+		}
+		check(equal, "data after conversion");
+
+		//the converted array is saved in its new layout
+		check(snapshot.save(convertedFile), "save converted");
+
+		//replacing the file that is still mapped
+		check(snapshot.save(file), "save over mapped file");
+		loaded = snapshot.get<ParticleV1>("particles", &count);
+		check(loaded && memcmp(loaded, particles.data(), particles.size() * sizeof(ParticleV1)) == 0, "mapping after replacing the file");
+	}
+
+	{
+		Snapshot snapshot;
+		check(snapshot.load(convertedFile), "load converted");
+		int count = 0;
+		ParticleV2* loaded = snapshot.get<ParticleV2>("particles", &count);
+		check(count == particles.size(), "count after converted load");
+		check(snapshot.isInPlace("particles", Reflection::getType<ParticleV2>()), "converted layout is used in place");
+		bool equal = loaded != nullptr;
+		for (int i = 0; equal && i < count; i++) {
+			equal = loaded[i].id == i && loaded[i].x == i * 0.5 && loaded[i].z == 7;
+		}
+		check(equal, "data after converted load");
+	}
+
+	{
+		//an element count that overflows count * elementSize has to be rejected
+		std::string data;
+		{
+			std::ifstream stream(file, std::ios::binary);
+			data.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+		}
+		//header, then the length prefixed array and type names, the element size and the count
+		size_t offset = 24;
+		for (int i = 0; i < 2; i++) {
+			uint32_t length = 0;
+			memcpy(&length, data.data() + offset, sizeof(length));
+			offset += sizeof(length) + length;
+		}
+		offset += sizeof(uint32_t);
+		uint64_t count = ~0ull / sizeof(ParticleV1) + 2;
+		memcpy(data.data() + offset, &count, sizeof(count));
+		{
+			std::ofstream stream(file, std::ios::binary);
+			stream.write(data.data(), data.size());
+		}
+		Snapshot snapshot;
+		check(!snapshot.load(file), "overflowing count is rejected");
+	}
+
+	std::error_code error;
+	std::filesystem::remove(file, error);
+	std::filesystem::remove(convertedFile, error);
+
+	if (failures == 0) {
+		printf("snapshot test passed\n");
+	}
+	return failures == 0 ? 0 : 1;
+}